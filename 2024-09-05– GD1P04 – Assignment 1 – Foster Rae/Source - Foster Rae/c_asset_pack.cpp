@@ -0,0 +1,318 @@
+﻿#include "c_asset_pack.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <unordered_set>
+#include "c_lz4.h"
+#include "c_thread_pool.h"
+
+// == Static Members ==
+const c_asset_pack* c_asset_pack::mounted_ = nullptr;
+
+// == Constructors / Destructors ==
+c_asset_pack::~c_asset_pack()
+{
+	if (mounted_ == this)
+	{
+		mounted_ = nullptr;
+	}
+}
+
+// == Public Methods ==
+bool c_asset_pack::open(const char* file_path)
+{
+	close();
+	if (!file_.open(file_path))
+	{
+		return false;
+	}
+
+	// Check the header and that the index and the path strings are inside the file.
+	const unsigned char* data = file_.get_data();
+	const uint64_t size = file_.get_size();
+	const s_asset_pack_header* header = reinterpret_cast<const s_asset_pack_header*>(data);
+	if (size < sizeof(s_asset_pack_header) || std::memcmp(header->magic, "APAK", 4) != 0 || header->version != file_version)
+	{
+		std::cout << "Not an asset pack: " << file_path << '\n';
+		file_.close();
+		return false;
+	}
+	if (header->index_offset > size || (size - header->index_offset) / sizeof(s_asset_pack_entry) < header->entry_count
+		|| header->index_offset % alignof(s_asset_pack_entry) != 0 || header->names_offset > size)
+	{
+		std::cout << "Error: Invalid index in " << file_path << '\n';
+		file_.close();
+		return false;
+	}
+
+	// Check every entry once here, so find can trust them.
+	const s_asset_pack_entry* entries = reinterpret_cast<const s_asset_pack_entry*>(data + header->index_offset);
+	const uint64_t names_size = size - header->names_offset;
+	for (uint32_t i = 0; i < header->entry_count; i++)
+	{
+		const s_asset_pack_entry& entry = entries[i];
+		if (entry.offset > size || entry.stored_size > size - entry.offset || static_cast<uint64_t>(entry.name_offset) + entry.name_length > names_size
+			|| ((entry.flags & compressed_flag) == 0 && entry.stored_size != entry.size) || (i > 0 && entries[i - 1].hash > entry.hash))
+		{
+			std::cout << "Error: Invalid entry " << i << " in " << file_path << '\n';
+			file_.close();
+			return false;
+		}
+	}
+
+	entries_ = entries;
+	names_ = reinterpret_cast<const char*>(data + header->names_offset);
+	entry_count_ = header->entry_count;
+	return true;
+}
+
+void c_asset_pack::close()
+{
+	std::lock_guard<std::mutex> lock(decompress_mutex_);
+	decompressed_.clear();
+	file_.close();
+	entries_ = nullptr;
+	names_ = nullptr;
+	entry_count_ = 0;
+}
+
+std::span<const unsigned char> c_asset_pack::find(std::string_view file_path) const
+{
+	if (entry_count_ == 0)
+	{
+		return {};
+	}
+
+	// Binary search the sorted hashes, then compare the paths in case two share a hash.
+	const std::string key = normalize(file_path);
+	const uint64_t hash = hash_path(key);
+	const s_asset_pack_entry* end = entries_ + entry_count_;
+	const s_asset_pack_entry* entry = std::lower_bound(entries_, end, hash, [](const s_asset_pack_entry& e, uint64_t h) { return e.hash < h; });
+	for (; entry != end && entry->hash == hash; entry++)
+	{
+		if (std::string_view(names_ + entry->name_offset, entry->name_length) == key)
+		{
+			break;
+		}
+	}
+	if (entry == end || entry->hash != hash)
+	{
+		return {};
+	}
+
+	// Stored files are used in place.
+	const unsigned char* data = file_.get_data() + entry->offset;
+	if ((entry->flags & compressed_flag) == 0)
+	{
+		return { data, static_cast<size_t>(entry->size) };
+	}
+
+	// Compressed files are decompressed once. The vectors never move their data, so views stay valid.
+	std::lock_guard<std::mutex> lock(decompress_mutex_);
+	const size_t index = static_cast<size_t>(entry - entries_);
+	auto found = decompressed_.find(index);
+	if (found == decompressed_.end())
+	{
+		std::vector<unsigned char> output(static_cast<size_t>(entry->size));
+		if (!c_lz4::decompress(data, static_cast<size_t>(entry->stored_size), output.data(), output.size()))
+		{
+			std::cout << "Error: Corrupt packed file: " << key << '\n';
+			return {};
+		}
+		found = decompressed_.emplace(index, std::move(output)).first;
+	}
+	return found->second;
+}
+
+std::span<const unsigned char> c_asset_pack::find_mounted(std::string_view file_path)
+{
+	return (mounted_ != nullptr) ? mounted_->find(file_path) : std::span<const unsigned char>();
+}
+
+int c_asset_pack::build(const std::vector<std::string>& sources, const char* output_path, bool compress)
+{
+	namespace fs = std::filesystem;
+
+	/**
+	 * @brief A file to pack.
+	 * @param path The path as given, used to read it.
+	 * @param name The normalized path it is stored under.
+	 * @param data The data to store, compressed or not.
+	 * @param size The size of the file.
+	 * @param flags The entry flags.
+	 */
+	struct s_packed_file {
+		std::string path;
+		std::string name;
+		std::vector<unsigned char> data;
+		uint64_t size;
+		uint32_t flags;
+	};
+
+	// Collect the files, the first source to give a path wins.
+	std::vector<s_packed_file> files;
+	std::unordered_set<std::string> names;
+	const std::string pack_name = normalize(output_path);
+	auto add_file = [&](const fs::path& path)
+	{
+		std::string name = normalize(path.generic_string());
+		if (name == pack_name || !names.insert(name).second)
+		{
+			return;
+		}
+		files.push_back({ path.string(), std::move(name), {}, 0, 0 });
+	};
+	std::error_code error;
+	for (const std::string& source : sources)
+	{
+		if (fs::is_directory(source, error))
+		{
+			for (const fs::directory_entry& entry : fs::recursive_directory_iterator(source, error))
+			{
+				if (entry.is_regular_file())
+				{
+					add_file(entry.path());
+				}
+			}
+		}
+		else if (fs::is_regular_file(source, error))
+		{
+			add_file(source);
+		}
+		else
+		{
+			std::cout << "Asset not found: " << source << '\n';
+			return -1;
+		}
+	}
+
+	// Read and compress each file on its own worker, keeping the compressed copy only if it saves an eighth.
+	std::atomic<int> failed{ 0 };
+	c_thread_pool pool;
+	for (s_packed_file& file : files)
+	{
+		pool.submit([&file, compress, &failed]()
+		{
+			// Empty files can't be mapped, they are stored as nothing.
+			std::error_code size_error;
+			if (std::filesystem::file_size(file.path, size_error) == 0 && !size_error)
+			{
+				return;
+			}
+			c_mapped_file source;
+			if (!source.open(file.path.c_str()))
+			{
+				failed++;
+				return;
+			}
+			file.size = source.get_size();
+			if (compress)
+			{
+				std::vector<unsigned char> compressed = c_lz4::compress(source.get_data(), source.get_size());
+				if (compressed.size() <= source.get_size() - source.get_size() / 8)
+				{
+					file.data = std::move(compressed);
+					file.flags = compressed_flag;
+					return;
+				}
+			}
+			file.data.assign(source.get_data(), source.get_data() + source.get_size());
+		});
+	}
+	pool.wait_idle();
+	if (failed > 0)
+	{
+		return -1;
+	}
+
+	// Header, index sorted by hash, path strings, then the aligned data.
+	std::vector<s_asset_pack_entry> entries(files.size());
+	std::string name_table;
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		entries[i] = { hash_path(files[i].name), 0, files[i].data.size(), files[i].size, static_cast<uint32_t>(name_table.size()),
+			static_cast<uint32_t>(files[i].name.size()), files[i].flags, 0 };
+		name_table += files[i].name;
+	}
+	std::vector<size_t> order(files.size());
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [&entries](size_t a, size_t b) { return entries[a].hash < entries[b].hash; });
+
+	s_asset_pack_header header = {};
+	std::memcpy(header.magic, "APAK", 4);
+	header.version = file_version;
+	header.entry_count = static_cast<uint32_t>(files.size());
+	header.index_offset = sizeof(s_asset_pack_header);
+	header.names_offset = header.index_offset + sizeof(s_asset_pack_entry) * files.size();
+	uint64_t offset = header.names_offset + name_table.size();
+	std::vector<s_asset_pack_entry> index(files.size());
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		offset = (offset + blob_alignment - 1) / blob_alignment * blob_alignment;
+		index[i] = entries[order[i]];
+		index[i].offset = offset;
+		offset += index[i].stored_size;
+	}
+
+	std::ofstream file(output_path, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "Failed to write asset pack: " << output_path << '\n';
+		return -1;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(sizeof(s_asset_pack_entry) * index.size()));
+	file.write(name_table.data(), static_cast<std::streamsize>(name_table.size()));
+	uint64_t stored_bytes = 0;
+	uint64_t total_bytes = 0;
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		// Pad up to the file's offset.
+		static const char padding[blob_alignment] = {};
+		file.write(padding, static_cast<std::streamsize>(index[i].offset - static_cast<uint64_t>(file.tellp())));
+		const std::vector<unsigned char>& data = files[order[i]].data;
+		file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+		stored_bytes += index[i].stored_size;
+		total_bytes += index[i].size;
+	}
+	if (!file)
+	{
+		std::cout << "Failed to write asset pack: " << output_path << '\n';
+		return -1;
+	}
+
+	std::cout << "Packed " << files.size() << " files into " << output_path << ", " << total_bytes / 1024 << " KB stored as " << stored_bytes / 1024 << " KB." << '\n';
+	return static_cast<int>(files.size());
+}
+
+// == Private Methods ==
+std::string c_asset_pack::normalize(std::string_view file_path)
+{
+	// Lower case with forward slashes, like the paths Windows would open.
+	std::string path(file_path);
+	std::transform(path.begin(), path.end(), path.begin(), [](unsigned char c) { return static_cast<char>((c == '\\') ? '/' : std::tolower(c)); });
+	path = std::filesystem::path(path).lexically_normal().generic_string();
+	if (path == ".")
+	{
+		path.clear();
+	}
+	return path;
+}
+
+uint64_t c_asset_pack::hash_path(std::string_view file_path)
+{
+	uint64_t hash = 14695981039346656037ull; // FNV offset basis.
+	for (const char c : file_path)
+	{
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 1099511628211ull; // FNV prime.
+	}
+	return hash;
+}
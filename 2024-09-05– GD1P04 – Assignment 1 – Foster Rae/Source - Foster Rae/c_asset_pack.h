@@ -0,0 +1,159 @@
+﻿// /***********************************************************************
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+// (c) 2024 Media Design School
+// File Name : c_asset_pack.h
+// Description : Class that builds and reads a single memory-mapped file holding every resource.
+// Author : Foster Rae
+// Mail : Foster.Rae@mds.ac.nz
+// ************************************************************************/
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "c_mapped_file.h"
+
+/**
+ * @brief The header at the start of an asset pack (.pak) file.
+ * @param magic Always "APAK".
+ * @param version The format version, files with another version are rejected.
+ * @param entry_count The number of files in the pack.
+ * @param reserved Padding, always 0.
+ * @param index_offset The byte offset of the s_asset_pack_entry table, sorted by hash.
+ * @param names_offset The byte offset of the path strings the entries point into.
+ */
+struct s_asset_pack_header {
+	char magic[4];
+	uint32_t version;
+	uint32_t entry_count;
+	uint32_t reserved;
+	uint64_t index_offset;
+	uint64_t names_offset;
+};
+
+/**
+ * @brief A file in an asset pack.
+ * @param hash The FNV-1a hash of the normalized path.
+ * @param offset The byte offset of the data from the start of the pack, 16 byte aligned.
+ * @param stored_size The size of the data in the pack.
+ * @param size The size of the file, larger than stored_size if it is compressed.
+ * @param name_offset The offset of the normalized path in the path strings.
+ * @param name_length The length of the normalized path.
+ * @param flags compressed_flag if the data is an LZ4 block.
+ * @param reserved Padding, always 0.
+ */
+struct s_asset_pack_entry {
+	uint64_t hash;
+	uint64_t offset;
+	uint64_t stored_size;
+	uint64_t size;
+	uint32_t name_offset;
+	uint32_t name_length;
+	uint32_t flags;
+	uint32_t reserved;
+};
+
+/**
+ * @class c_asset_pack
+ * @brief Maps an asset pack and hands out views of the files in it, no open, stat or read per file.
+ * @note Paths are looked up by hash with a binary search, then compared in full. They are matched without case and
+ *       with either slash, the same way Windows opens the loose file. Stored files are views straight into the
+ *       mapping. Compressed files are decompressed on first use and kept until the pack is closed.
+ *       Build a pack by running the executable with: --pack-assets [output file] [files or folders...]
+ */
+class c_asset_pack
+{
+public:
+
+	// == Constructors and Destructors ==
+	c_asset_pack() = default;
+	~c_asset_pack(); // Unmounts the pack if it is mounted.
+	c_asset_pack(const c_asset_pack&) = delete;            // Owns the mapping, no copying.
+	c_asset_pack& operator=(const c_asset_pack&) = delete;
+
+	// == Public Methods ==
+	/**
+	 * @brief Maps a pack and checks its index, closing any pack that was already open.
+	 *
+	 * @param file_path The file path to the pack.
+	 * @return True if the pack was mapped and its index is valid.
+	 */
+	bool open(const char* file_path);
+	/**
+	 * @brief Unmaps the pack, every view handed out becomes invalid.
+	 */
+	void close();
+	/**
+	 * @brief Finds a file in the pack. Safe to call from several threads.
+	 *
+	 * @param file_path The path the file was packed under, relative to the folder the pack was built from.
+	 * @return A view of the file, empty if the pack doesn't have it or it fails to decompress.
+	 */
+	std::span<const unsigned char> find(std::string_view file_path) const;
+	/**
+	 * @brief Makes a pack the one the loaders read from before falling back to loose files.
+	 * @note Mount before any loading starts, the loaders on worker threads read it without a lock.
+	 *
+	 * @param pack The pack, or nullptr to read loose files only.
+	 */
+	static void mount(const c_asset_pack* pack) { mounted_ = pack; }
+	/**
+	 * @brief Finds a file in the mounted pack.
+	 *
+	 * @param file_path The path the file was packed under.
+	 * @return A view of the file, empty if no pack is mounted or it doesn't have the file.
+	 */
+	static std::span<const unsigned char> find_mounted(std::string_view file_path);
+	/**
+	 * @brief Packs files and every file in folders into one pack, compressing them on a thread pool.
+	 * @note Files are packed under their path as given, so build from the folder the executable runs in.
+	 *
+	 * @param sources The files and folders to pack.
+	 * @param output_path The pack to write.
+	 * @param compress True to LZ4 compress the files that get smaller, false to store everything.
+	 * @return The number of files packed, or -1 if any failed.
+	 */
+	static int build(const std::vector<std::string>& sources, const char* output_path, bool compress = true);
+
+	// == Accessors ==
+	bool is_open() const { return file_.is_open(); }
+	size_t get_entry_count() const { return entry_count_; }
+	static const c_asset_pack* get_mounted() { return mounted_; }
+
+	// == Constants ==
+	static constexpr char file_extension[] = ".pak";
+	static constexpr uint32_t file_version = 1;
+	static constexpr uint64_t blob_alignment = 16; // Keeps each file aligned for SIMD reads and texture uploads.
+	static constexpr uint32_t compressed_flag = 1;
+
+private:
+
+	// == Private Methods ==
+	/**
+	 * @brief Turns a path into the form it is hashed and stored in. ("./Resources\\Textures\\A.png" to "resources/textures/a.png")
+	 * @param file_path The path.
+	 * @return The lower case path with forward slashes and no "." or ".." parts.
+	 */
+	static std::string normalize(std::string_view file_path);
+	/**
+	 * @brief Hashes a normalized path.
+	 * @param file_path The normalized path.
+	 * @return The 64 bit FNV-1a hash.
+	 */
+	static uint64_t hash_path(std::string_view file_path);
+
+	// == Private Members ==
+	c_mapped_file file_;
+	const s_asset_pack_entry* entries_ = nullptr; // Points into the mapping.
+	const char* names_ = nullptr;                 // Points into the mapping.
+	size_t entry_count_ = 0;
+	mutable std::mutex decompress_mutex_;                                           // Guards decompressed_.
+	mutable std::unordered_map<size_t, std::vector<unsigned char>> decompressed_; // Entry index to its data.
+	static const c_asset_pack* mounted_;
+};
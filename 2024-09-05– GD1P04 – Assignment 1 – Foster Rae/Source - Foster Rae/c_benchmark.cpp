@@ -0,0 +1,1008 @@
+﻿#include "c_benchmark.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+#include <ext/matrix_clip_space.hpp>
+#include <ext/matrix_transform.hpp>
+#include <stb_image.h>
+#include "c_mesh.h"
+#include "c_cube.h"
+#include "c_gl_state.h"
+#include "c_transform_store.h"
+#include "c_bvh.h"
+#include "c_static_batcher.h"
+#include "c_instanced_renderer.h"
+#include "c_block_encoder.h"
+#include "c_thread_pool.h"
+#include "c_mapped_file.h"
+#include "c_frame_constants.h"
+#include "c_sprite_atlas.h"
+#include "c_sprite_animation.h"
+#include "c_sprite_batcher.h"
+#include "c_scene.h"
+#include "c_mesh_importer.h"
+#include "c_texture_cache.h"
+
+/**
+ * @brief Times a function over a number of iterations.
+ *
+ * @param iterations The number of times to call the function.
+ * @param func The function to time.
+ * @return The average time per call in nanoseconds.
+ */
+template <typename T_func>
+static double time_per_iteration_ns(int iterations, T_func func)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < iterations; i++)
+	{
+		func(i);
+	}
+	const auto end = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+// == Public Methods ==
+int c_benchmark::run(const std::string& name)
+{
+	if (name == "uniforms")
+	{
+		return benchmark_uniforms();
+	}
+	if (name == "transforms")
+	{
+		return benchmark_transforms();
+	}
+	if (name == "bvh")
+	{
+		return benchmark_bvh();
+	}
+	if (name == "bcn")
+	{
+		return benchmark_bcn();
+	}
+	if (name == "sprites")
+	{
+		return benchmark_sprites();
+	}
+	if (name == "scene")
+	{
+		return benchmark_scene();
+	}
+	if (name == "meshes")
+	{
+		return benchmark_meshes();
+	}
+	if (name == "textures")
+	{
+		return benchmark_textures();
+	}
+
+	// Unknown benchmark, list the ones that exist.
+	std::cout << "Unknown benchmark: " << name << '\n';
+	std::cout << "Available benchmarks: uniforms, transforms, bvh, bcn, sprites, scene, meshes, textures" << '\n';
+	return -1;
+}
+
+// == Private Methods ==
+GLFWwindow* c_benchmark::create_hidden_context()
+{
+	// Same setup as the pipeline, but the window is never shown.
+	c_graphics_utils::initialize_glfw();
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* window = c_graphics_utils::create_window(64, 64, "Benchmark");
+	if (!window || c_graphics_utils::initialize_glew() != 0)
+	{
+		return nullptr;
+	}
+	return window;
+}
+
+// == Benchmarks ==
+int c_benchmark::benchmark_uniforms()
+{
+	if (!create_hidden_context())
+	{
+		return -1;
+	}
+
+	GLuint program = c_shader_loader::create_program("test.vert", "test.frag");
+	if (program == 0)
+	{
+		glfwTerminate();
+		return -1;
+	}
+	c_gl_state::use_program(program);
+
+	// Same material as the scene, the texture contents don't matter for uniform setup.
+	std::vector<s_texture> textures = { { 0, "texture_array", GL_TEXTURE_2D_ARRAY } };
+	const int iterations = 200000;
+	{
+		c_transform_store transforms;
+		c_cube cube(transforms, textures, glm::vec3(0.0f), 0.0f, glm::vec3(1.0f));
+		const c_mesh& mesh = cube.get_mesh();
+
+		// Before: every sampler is looked up by name each draw.
+		double before_ns = time_per_iteration_ns(iterations, [&](int)
+		{
+			GLuint diffuse_count = 1;
+			GLuint specular_count = 1;
+			for (GLuint i = 0; i < mesh.textures.size(); i++)
+			{
+				glActiveTexture(GL_TEXTURE0 + i);
+				std::string number;
+				std::string name = mesh.textures[i].type;
+				if (name == "texture_diffuse")
+				{
+					number = std::to_string(diffuse_count++);
+				}
+				else if (name == "texture_specular")
+				{
+					number = std::to_string(specular_count++);
+				}
+				glUniform1i(glGetUniformLocation(program, (name + number).c_str()), i);
+				glBindTexture(mesh.textures[i].target, mesh.textures[i].id);
+			}
+		});
+
+		// The old path bound textures behind the state tracker's back.
+		c_gl_state::invalidate();
+
+		// After: locations come from the reflection table, resolved once.
+		double after_ns = time_per_iteration_ns(iterations, [&](int)
+		{
+			mesh.bind_textures(program);
+		});
+
+		std::cout << "Uniform setup per draw (" << iterations << " draws, " << textures.size() << " textures)\n";
+		std::cout << "  Before (string lookups):     " << before_ns << " ns\n";
+		std::cout << "  After (pre-resolved handles): " << after_ns << " ns\n";
+		std::cout << "  Speedup: " << before_ns / after_ns << "x\n";
+	}
+
+	c_shader_loader::delete_program(program);
+	glfwTerminate();
+	return 0;
+}
+
+int c_benchmark::benchmark_transforms()
+{
+	// The old layout, one heap allocation per object reached through a pointer.
+	struct s_object {
+		glm::vec3 position;
+		float rotation;
+		glm::vec3 scale;
+		glm::mat4 model_matrix;
+	};
+
+	const int transform_count = 1000000;
+	const int frames = 20;
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position_range(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> rotation_range(0.0f, 360.0f);
+	std::uniform_real_distribution<float> scale_range(0.5f, 2.0f);
+
+	// Fill both with the same transforms.
+	std::vector<std::unique_ptr<s_object>> objects;
+	c_transform_store transforms;
+	objects.reserve(transform_count);
+	transforms.reserve(transform_count);
+	for (int i = 0; i < transform_count; i++)
+	{
+		const glm::vec3 position(position_range(random), position_range(random), position_range(random));
+		const float rotation = rotation_range(random);
+		const glm::vec3 scale(scale_range(random), scale_range(random), scale_range(random));
+		objects.push_back(std::make_unique<s_object>(s_object{ position, rotation, scale, glm::mat4(1.0f) }));
+		transforms.add(position, rotation, scale);
+	}
+	std::vector<s_instance_data> instances(transform_count);
+
+	// Before: translate * rotate * scale per object, the same calls c_cube used.
+	double before_ns = time_per_iteration_ns(frames, [&](int)
+	{
+		for (auto& object : objects)
+		{
+			object->model_matrix = glm::mat4(1.0f);
+			object->model_matrix = glm::translate(object->model_matrix, object->position);
+			object->model_matrix = glm::rotate(object->model_matrix, glm::radians(object->rotation), glm::vec3(0.0f, 0.0f, 1.0f));
+			object->model_matrix = glm::scale(object->model_matrix, object->scale);
+		}
+	});
+
+	// After: the batch kernel writing straight into instance data.
+	double after_ns = time_per_iteration_ns(frames, [&](int)
+	{
+		transforms.compute_matrices(0, transforms.get_count(), instances.data());
+	});
+
+	// Check both paths built the same matrices.
+	float max_error = 0.0f;
+	for (int i = 0; i < transform_count; i++)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			const glm::vec4 difference = glm::abs(objects[i]->model_matrix[column] - instances[i].model_matrix[column]);
+			max_error = glm::max(max_error, glm::max(glm::max(difference.x, difference.y), glm::max(difference.z, difference.w)));
+		}
+	}
+
+	std::cout << "Model matrices per frame (" << transform_count << " transforms, " << frames << " frames)\n";
+	std::cout << "  Before (heap objects, glm):  " << before_ns / 1000000.0 << " ms\n";
+	std::cout << "  After (SoA store, SSE):      " << after_ns / 1000000.0 << " ms\n";
+	std::cout << "  Speedup: " << before_ns / after_ns << "x\n";
+	std::cout << "  Max difference: " << max_error << "\n";
+	return (max_error < 1e-3f) ? 0 : -1;
+}
+
+int c_benchmark::benchmark_bvh()
+{
+	const int query_count = 1000;
+	bool results_match = true;
+	std::cout << "BVH queries vs linear scans (times per query, " << query_count << " rays and boxes)\n";
+
+	for (int cube_count : { 1000, 10000, 100000, 1000000 })
+	{
+		// Unit cubes spread through a volume that grows with the count, so the density stays the same.
+		const float half_size = std::cbrt(static_cast<float>(cube_count)) * 2.0f;
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> position_range(-half_size, half_size);
+		std::uniform_real_distribution<float> rotation_range(0.0f, 360.0f);
+		c_transform_store transforms;
+		transforms.reserve(cube_count);
+		for (int i = 0; i < cube_count; i++)
+		{
+			transforms.add(glm::vec3(position_range(random), position_range(random), position_range(random)), rotation_range(random), glm::vec3(1.0f));
+		}
+
+		// Build.
+		c_bvh bvh;
+		const double build_ms = time_per_iteration_ns(1, [&](int) { bvh.build(transforms); }) / 1000000.0;
+
+		// Frustum, a camera in the middle of the volume with the same projection as the scene.
+		const glm::mat4 view_projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f)
+			* glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		const c_frustum frustum(view_projection);
+		std::vector<int> linear_visible;
+		std::vector<int> bvh_visible;
+		const double frustum_linear_ns = time_per_iteration_ns(10, [&](int) { frustum.cull(transforms, linear_visible); });
+		const double frustum_bvh_ns = time_per_iteration_ns(10, [&](int) { bvh.query_frustum(frustum, bvh_visible); });
+		std::sort(bvh_visible.begin(), bvh_visible.end());
+		results_match = results_match && (linear_visible == bvh_visible);
+
+		// Rays from the centre and boxes at random points.
+		std::vector<glm::vec3> directions(query_count);
+		std::vector<glm::vec3> box_centers(query_count);
+		std::uniform_real_distribution<float> unit_range(-1.0f, 1.0f);
+		for (int i = 0; i < query_count; i++)
+		{
+			directions[i] = glm::vec3(unit_range(random), unit_range(random), unit_range(random));
+			box_centers[i] = glm::vec3(position_range(random), position_range(random), position_range(random));
+		}
+		const glm::vec3 box_extents(2.0f);
+
+		// Linear versions of the queries over the same bounds.
+		auto get_bounds = [&transforms](int i, glm::vec3& box_min, glm::vec3& box_max)
+		{
+			const glm::vec3 center(transforms.get_centers_x()[i], transforms.get_centers_y()[i], transforms.get_centers_z()[i]);
+			const glm::vec3 extents(transforms.get_extents_x()[i], transforms.get_extents_y()[i], transforms.get_extents_z()[i]);
+			box_min = center - extents;
+			box_max = center + extents;
+		};
+		// Hits are compared by distance, overlapping cubes can tie.
+		std::vector<float> linear_hits(query_count, FLT_MAX);
+		std::vector<float> bvh_hits(query_count, FLT_MAX);
+		const double ray_linear_ns = time_per_iteration_ns(query_count, [&](int q)
+		{
+			const glm::vec3 inverse_direction = 1.0f / directions[q];
+			float closest = FLT_MAX;
+			for (int i = 0; i < cube_count; i++)
+			{
+				glm::vec3 box_min, box_max;
+				get_bounds(i, box_min, box_max);
+				const glm::vec3 t1 = (box_min - glm::vec3(0.0f)) * inverse_direction;
+				const glm::vec3 t2 = (box_max - glm::vec3(0.0f)) * inverse_direction;
+				const glm::vec3 t_near = glm::min(t1, t2);
+				const glm::vec3 t_far = glm::max(t1, t2);
+				const float t_min = std::max(std::max(t_near.x, t_near.y), std::max(t_near.z, 0.0f));
+				const float t_max = std::min(std::min(t_far.x, t_far.y), t_far.z);
+				if (t_max >= t_min && t_min < closest)
+				{
+					closest = t_min;
+				}
+			}
+			linear_hits[q] = closest;
+		});
+		const double ray_bvh_ns = time_per_iteration_ns(query_count, [&](int q)
+		{
+			bvh.ray_cast(glm::vec3(0.0f), directions[q], FLT_MAX, &bvh_hits[q]);
+		});
+		results_match = results_match && (linear_hits == bvh_hits);
+
+		size_t linear_overlaps = 0;
+		size_t bvh_overlaps = 0;
+		std::vector<int> overlap_results;
+		const double overlap_linear_ns = time_per_iteration_ns(query_count, [&](int q)
+		{
+			const glm::vec3 query_min = box_centers[q] - box_extents;
+			const glm::vec3 query_max = box_centers[q] + box_extents;
+			for (int i = 0; i < cube_count; i++)
+			{
+				glm::vec3 box_min, box_max;
+				get_bounds(i, box_min, box_max);
+				if (glm::all(glm::lessThanEqual(query_min, box_max)) && glm::all(glm::lessThanEqual(box_min, query_max)))
+				{
+					linear_overlaps++;
+				}
+			}
+		});
+		const double overlap_bvh_ns = time_per_iteration_ns(query_count, [&](int q)
+		{
+			bvh_overlaps += bvh.query_overlap(box_centers[q] - box_extents, box_centers[q] + box_extents, overlap_results);
+		});
+		results_match = results_match && (linear_overlaps == bvh_overlaps);
+
+		std::cout << "  " << cube_count << " cubes (build " << build_ms << " ms, " << bvh.get_node_count() << " nodes)\n";
+		std::cout << "    Frustum: linear " << frustum_linear_ns / 1000.0 << " us, BVH " << frustum_bvh_ns / 1000.0 << " us (" << bvh_visible.size() << " visible)\n";
+		std::cout << "    Ray:     linear " << ray_linear_ns / 1000.0 << " us, BVH " << ray_bvh_ns / 1000.0 << " us\n";
+		std::cout << "    Overlap: linear " << overlap_linear_ns / 1000.0 << " us, BVH " << overlap_bvh_ns / 1000.0 << " us\n";
+	}
+
+	std::cout << "  Results match: " << (results_match ? "yes" : "no") << "\n";
+	return results_match ? 0 : -1;
+}
+
+int c_benchmark::benchmark_bcn()
+{
+	// Opaque diffuse textures go to BC1, sprites with alpha to BC3.
+	const char* image_paths[] = {
+		"Resources/Textures/texture_diffuse1.PNG",
+		"Resources/Textures/texture_diffuse2.png",
+		"Resources/Textures/Alien.png",
+		"Resources/Textures/Run (1).png",
+		"Resources/Textures/coin/tile000.png",
+	};
+	c_thread_pool pool;
+	std::cout << "BC1/BC3 encode speed and quality (" << pool.get_thread_count() << " worker threads)\n";
+
+	for (const char* path : image_paths)
+	{
+		int width, height, components;
+		unsigned char* pixels = stbi_load(path, &width, &height, &components, 4);
+		if (pixels == nullptr)
+		{
+			std::cout << "Failed to load image: " << path << '\n';
+			return -1;
+		}
+
+		const GLenum format = c_block_encoder::choose_format(pixels, width, height);
+		std::vector<unsigned char> blocks;
+		const double single_ms = time_per_iteration_ns(1, [&](int) { blocks = c_block_encoder::encode(pixels, width, height, format); }) / 1000000.0;
+		const double pooled_ms = time_per_iteration_ns(1, [&](int) { blocks = c_block_encoder::encode(pixels, width, height, format, &pool); }) / 1000000.0;
+
+		// PSNR over the colour of visible pixels (transparent colour is never seen), and over alpha.
+		const std::vector<unsigned char> decoded = c_block_encoder::decode(blocks.data(), width, height, format);
+		double colour_error = 0.0;
+		double alpha_error = 0.0;
+		size_t colour_samples = 0;
+		const size_t pixel_count = static_cast<size_t>(width) * height;
+		for (size_t i = 0; i < pixel_count; i++)
+		{
+			if (pixels[i * 4 + 3] > 0)
+			{
+				for (int channel = 0; channel < 3; channel++)
+				{
+					const double difference = static_cast<double>(pixels[i * 4 + channel]) - decoded[i * 4 + channel];
+					colour_error += difference * difference;
+				}
+				colour_samples += 3;
+			}
+			const double difference = static_cast<double>(pixels[i * 4 + 3]) - decoded[i * 4 + 3];
+			alpha_error += difference * difference;
+		}
+		auto psnr = [](double squared_error, size_t samples)
+		{
+			const double mse = squared_error / static_cast<double>(std::max<size_t>(samples, 1));
+			return (mse == 0.0) ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / mse);
+		};
+
+		const double megapixels = static_cast<double>(pixel_count) / 1000000.0;
+		std::cout << "  " << path << " (" << width << "x" << height << ", " << ((format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT) ? "BC3" : "BC1")
+			<< ", " << static_cast<double>(pixel_count * 4) / static_cast<double>(blocks.size()) << ":1 vs RGBA8)\n";
+		std::cout << "    Encode: 1 thread " << single_ms << " ms (" << megapixels / (single_ms / 1000.0) << " MPix/s), pool "
+			<< pooled_ms << " ms (" << megapixels / (pooled_ms / 1000.0) << " MPix/s)\n";
+		std::cout << "    PSNR:   colour " << psnr(colour_error, colour_samples) << " dB";
+		if (format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+		{
+			std::cout << ", alpha " << psnr(alpha_error, pixel_count) << " dB";
+		}
+		std::cout << '\n';
+		stbi_image_free(pixels);
+	}
+	return 0;
+}
+
+int c_benchmark::benchmark_sprites()
+{
+	GLFWwindow* window = create_hidden_context();
+	if (!window)
+	{
+		return -1;
+	}
+	glfwSwapInterval(0); // Don't wait for vsync, time the work itself.
+
+	const int sprite_count = 100000;
+	const int frame_count = 300;
+	int result = -1;
+	{
+		GLuint program = c_shader_loader::create_program("sprite.vert", "sprite.frag");
+
+		// Two atlases, so sprites have to be sorted into texture runs.
+		c_sprite_atlas characters;
+		std::vector<std::string> run_frames;
+		for (int i = 1; i <= 10; i++)
+		{
+			run_frames.push_back("Resources/Textures/Run (" + std::to_string(i) + ").png");
+		}
+		const int run_sequence = characters.add_sequence(run_frames);
+		c_sprite_atlas effects;
+		std::vector<std::string> coin_frames;
+		for (int i = 0; i <= 14; i++)
+		{
+			const std::string number = std::to_string(i);
+			coin_frames.push_back("Resources/Textures/coin/tile" + std::string(3 - number.size(), '0') + number + ".png");
+		}
+		const int coin_sequence = effects.add_sequence(coin_frames);
+
+		if (program != 0 && characters.build() && effects.build())
+		{
+			// Random sprites over a 1920x1080 screen, half of each atlas, on 4 layers.
+			const int width = 1920;
+			const int height = 1080;
+			glViewport(0, 0, 64, 64);
+			c_frame_constants frame_constants(1);
+			frame_constants.set_pass(0, glm::ortho(0.0f, static_cast<float>(width), 0.0f, static_cast<float>(height), -1.0f, 1.0f), glm::mat4(1.0f));
+			frame_constants.upload();
+			frame_constants.bind_pass(0);
+
+			std::mt19937 random(1234);
+			std::uniform_real_distribution<float> x_range(0.0f, static_cast<float>(width));
+			std::uniform_real_distribution<float> y_range(0.0f, static_cast<float>(height));
+			std::uniform_real_distribution<float> unit_range(0.0f, 1.0f);
+			std::vector<c_sprite_animation> animations;
+			std::vector<glm::vec2> positions;
+			std::vector<int> layers;
+			animations.reserve(sprite_count);
+			for (int i = 0; i < sprite_count; i++)
+			{
+				const bool is_coin = (i % 2) == 0;
+				animations.emplace_back(is_coin ? effects : characters, is_coin ? coin_sequence : run_sequence, 10.0f + unit_range(random) * 10.0f);
+				animations.back().set_frame(static_cast<int>(random() % 10));
+				positions.emplace_back(x_range(random), y_range(random));
+				layers.push_back(static_cast<int>(random() % 4));
+			}
+
+			c_sprite_batcher batcher;
+			const GLuint coin_texture = effects.get_texture_id();
+			const GLuint character_texture = characters.get_texture_id();
+			const float delta_time = 1.0f / 60.0f;
+			double cpu_ms = 0.0;
+			double frame_ms = 0.0;
+			for (int frame = 0; frame < frame_count; frame++)
+			{
+				const auto start = std::chrono::high_resolution_clock::now();
+				batcher.begin();
+				for (int i = 0; i < sprite_count; i++)
+				{
+					animations[i].update(delta_time);
+					const bool is_coin = (i % 2) == 0;
+					batcher.submit(is_coin ? coin_texture : character_texture, positions[i],
+						is_coin ? glm::vec2(16.0f) : glm::vec2(29.0f, 35.0f), animations[i].get_uv_rect(), glm::vec4(1.0f), layers[i]);
+				}
+				batcher.end(program);
+				const auto submitted = std::chrono::high_resolution_clock::now();
+				glFinish(); // Wait for the GPU so the frame time includes the draws.
+				const auto finished = std::chrono::high_resolution_clock::now();
+				cpu_ms += std::chrono::duration<double, std::milli>(submitted - start).count();
+				frame_ms += std::chrono::duration<double, std::milli>(finished - start).count();
+			}
+			cpu_ms /= frame_count;
+			frame_ms /= frame_count;
+
+			std::cout << "Sprite batcher (" << sprite_count << " animated sprites, 2 atlases, 4 layers, " << frame_count << " frames)\n";
+			std::cout << "  CPU (animate, submit, sort, upload): " << cpu_ms << " ms\n";
+			std::cout << "  Frame (with glFinish):               " << frame_ms << " ms (" << 1000.0 / frame_ms << " FPS)\n";
+			std::cout << "  Draw calls: " << batcher.get_draw_count() << "\n";
+			std::cout << "  Holds 60 FPS: " << ((frame_ms <= 1000.0 / 60.0) ? "yes" : "no") << "\n";
+			result = 0;
+		}
+		c_shader_loader::delete_program(program);
+	}
+	glfwTerminate();
+	return result;
+}
+
+int c_benchmark::benchmark_scene()
+{
+	// Cubes share the cube geometry, which needs a context to upload.
+	if (!create_hidden_context())
+	{
+		return -1;
+	}
+
+	const int object_count = 1000000;
+	const int static_count = object_count - object_count / 10; // Most of a level never moves.
+	const int loads = 5;
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position_range(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> rotation_range(0.0f, 360.0f);
+	std::uniform_real_distribution<float> scale_range(0.5f, 2.0f);
+
+	// The scene as it is built in code, exported in two groups.
+	c_transform_store source;
+	source.reserve(object_count);
+	std::vector<s_scene_export_group> groups(2);
+	groups[0] = { &source, {}, 0, 0, 0 };
+	groups[1] = { &source, {}, 0, 0, c_scene::static_flag };
+	for (int i = 0; i < object_count; i++)
+	{
+		const int handle = source.add(glm::vec3(position_range(random), position_range(random), position_range(random)), rotation_range(random),
+			glm::vec3(scale_range(random), scale_range(random), scale_range(random)));
+		groups[(i < object_count - static_count) ? 0 : 1].handles.push_back(handle);
+	}
+	const std::string file_path = (std::filesystem::temp_directory_path() / "benchmark.scene").string();
+	auto start = std::chrono::high_resolution_clock::now();
+	if (!c_scene::write(file_path.c_str(), groups, { "cube" }, { "Resources/Textures/texture_diffuse1.png" }))
+	{
+		glfwTerminate();
+		return -1;
+	}
+	const double write_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	// Before: one c_cube per object, the way initial_setup builds them.
+	const std::vector<s_texture> textures = { { 0, "texture_array", GL_TEXTURE_2D_ARRAY } };
+	double before_ms;
+	{
+		c_transform_store transforms;
+		std::vector<c_cube*> cubes;
+		start = std::chrono::high_resolution_clock::now();
+		for (const s_scene_export_group& group : groups)
+		{
+			for (int handle : group.handles)
+			{
+				cubes.push_back(new c_cube(transforms, textures, source.get_position(handle), source.get_rotation(handle), source.get_scale(handle)));
+			}
+		}
+		before_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		for (c_cube* cube : cubes)
+		{
+			delete cube;
+		}
+	}
+
+	// After: map the file and copy each group's arrays into its store, then the rest of initial_setup's load path.
+	double after_ms = 0.0;
+	double setup_ms = 0.0;
+	bool results_match = true;
+	for (int load = 0; load < loads; load++)
+	{
+		c_transform_store dynamic_transforms;
+		c_transform_store static_transforms;
+		c_scene scene;
+		start = std::chrono::high_resolution_clock::now();
+		if (!scene.open(file_path.c_str()))
+		{
+			results_match = false;
+			break;
+		}
+		for (size_t i = 0; i < scene.get_groups().size(); i++)
+		{
+			scene.load_group(i, (scene.get_groups()[i].flags & c_scene::static_flag) ? static_transforms : dynamic_transforms);
+		}
+		after_ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+		// The trees, the static regions, the instance slots and one c_cube for the active cube. The static batch meshes
+		// are built on the worker after setup returns, so only sorting the cubes into regions is timed.
+		start = std::chrono::high_resolution_clock::now();
+		{
+			c_cube active_cube(dynamic_transforms, textures, 0);
+			c_bvh dynamic_bvh;
+			c_bvh static_bvh;
+			dynamic_bvh.build(dynamic_transforms);
+			static_bvh.build(static_transforms);
+			c_static_batcher static_batcher(*active_cube.get_mesh().get_geometry(), textures);
+			for (int handle = 0; handle < static_cast<int>(static_transforms.get_count()); handle++)
+			{
+				static_batcher.add(static_transforms, handle);
+			}
+			c_instanced_renderer renderer(active_cube.get_mesh());
+			for (size_t i = 0; i < dynamic_transforms.get_count(); i++)
+			{
+				renderer.add_instance(glm::mat4(1.0f), 0);
+			}
+			dynamic_transforms.update(renderer);
+			setup_ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		}
+
+		// Check the loaded transforms against the source.
+		for (int i = 0; i < object_count && results_match; i++)
+		{
+			const bool is_static = i >= object_count - static_count;
+			const c_transform_store& loaded = is_static ? static_transforms : dynamic_transforms;
+			const int handle = is_static ? i - (object_count - static_count) : i;
+			results_match = loaded.get_position(handle) == source.get_position(i) && loaded.get_rotation(handle) == source.get_rotation(i)
+				&& loaded.get_scale(handle) == source.get_scale(i) && loaded.get_extents_x()[handle] == source.get_extents_x()[i];
+		}
+	}
+	after_ms /= loads;
+	setup_ms /= loads;
+
+	std::error_code error;
+	const double file_mb = static_cast<double>(std::filesystem::file_size(file_path, error)) / (1024.0 * 1024.0);
+	std::filesystem::remove(file_path, error);
+
+	std::cout << "Scene load (" << object_count << " cubes, " << static_count << " static, " << file_mb << " MB file, written in " << write_ms << " ms)\n";
+	std::cout << "  Before (new c_cube per object): " << before_ms << " ms\n";
+	std::cout << "  After (mapped file, bulk load): " << after_ms << " ms (" << object_count / (after_ms / 1000.0) / 1000000.0 << "M objects/s)\n";
+	std::cout << "  Speedup: " << before_ms / after_ms << "x\n";
+	std::cout << "  Full load path (bulk load, BVHs, static regions, instance slots, active cube): " << after_ms + setup_ms << " ms\n";
+	std::cout << "  Results match: " << (results_match ? "yes" : "no") << "\n";
+	glfwTerminate();
+	return results_match ? 0 : -1;
+}
+
+int c_benchmark::benchmark_meshes()
+{
+	// A wavy grid of quads with UVs and normals, close to what an exporter writes for a big scanned or sculpted model.
+	const int grid = 768;
+	const int loads = 3;
+	std::vector<s_vertex> reference(static_cast<size_t>(grid) * grid);
+	for (int z = 0; z < grid; z++)
+	{
+		for (int x = 0; x < grid; x++)
+		{
+			const float u = static_cast<float>(x) / (grid - 1);
+			const float v = static_cast<float>(z) / (grid - 1);
+			s_vertex& vertex = reference[static_cast<size_t>(z) * grid + x];
+			vertex.position = glm::vec3(u * 100.0f - 50.0f, std::sin(u * 20.0f) * std::cos(v * 20.0f) * 2.0f, v * 100.0f - 50.0f);
+			vertex.normal = glm::normalize(glm::vec3(-std::cos(u * 20.0f) * std::cos(v * 20.0f) * 0.4f, 1.0f, std::sin(u * 20.0f) * std::sin(v * 20.0f) * 0.4f));
+			vertex.tex_coords = glm::vec2(u, v);
+		}
+	}
+
+	// Write the OBJ, shortest round trip floats so the text holds the exact values.
+	std::string obj;
+	obj.reserve(static_cast<size_t>(grid) * grid * 200);
+	char number[32];
+	const auto append_floats = [&](const char* prefix, const float* values, int count)
+	{
+		obj += prefix;
+		for (int i = 0; i < count; i++)
+		{
+			obj += ' ';
+			obj.append(number, std::to_chars(number, number + sizeof(number), values[i]).ptr);
+		}
+		obj += '\n';
+	};
+	obj += "# Generated by --benchmark meshes\no grid\n";
+	for (const s_vertex& vertex : reference)
+	{
+		append_floats("v", &vertex.position.x, 3);
+	}
+	for (const s_vertex& vertex : reference)
+	{
+		append_floats("vt", &vertex.tex_coords.x, 2);
+	}
+	for (const s_vertex& vertex : reference)
+	{
+		append_floats("vn", &vertex.normal.x, 3);
+	}
+	std::vector<GLuint> reference_indices;
+	for (int z = 0; z + 1 < grid; z++)
+	{
+		for (int x = 0; x + 1 < grid; x++)
+		{
+			const GLuint quad[4] = { static_cast<GLuint>(z * grid + x), static_cast<GLuint>((z + 1) * grid + x), static_cast<GLuint>((z + 1) * grid + x + 1),
+				static_cast<GLuint>(z * grid + x + 1) };
+			obj += 'f';
+			for (GLuint corner : quad)
+			{
+				char* end = std::to_chars(number, number + sizeof(number), corner + 1).ptr;
+				obj += ' ';
+				for (int i = 0; i < 3; i++)
+				{
+					obj.append(number, end);
+					obj += (i < 2) ? '/' : ' ';
+				}
+				obj.pop_back();
+			}
+			obj += '\n';
+			reference_indices.insert(reference_indices.end(), { quad[0], quad[1], quad[2], quad[0], quad[2], quad[3] });
+		}
+	}
+
+	// The same mesh as a GLB, UVs flipped to the glTF origin.
+	std::vector<unsigned char> bin(reference.size() * sizeof(s_vertex) + reference_indices.size() * sizeof(GLuint));
+	for (size_t i = 0; i < reference.size(); i++)
+	{
+		s_vertex vertex = reference[i];
+		vertex.tex_coords.y = 1.0f - vertex.tex_coords.y;
+		std::memcpy(&bin[i * sizeof(s_vertex)], &vertex, sizeof(s_vertex));
+	}
+	std::memcpy(&bin[reference.size() * sizeof(s_vertex)], reference_indices.data(), reference_indices.size() * sizeof(GLuint));
+	const size_t vertex_bytes = reference.size() * sizeof(s_vertex);
+	std::string json = "{\"asset\":{\"version\":\"2.0\"},\"buffers\":[{\"byteLength\":" + std::to_string(bin.size()) + "}],"
+		"\"bufferViews\":[{\"buffer\":0,\"byteLength\":" + std::to_string(vertex_bytes) + ",\"byteStride\":" + std::to_string(sizeof(s_vertex)) + "},"
+		"{\"buffer\":0,\"byteOffset\":" + std::to_string(vertex_bytes) + ",\"byteLength\":" + std::to_string(bin.size() - vertex_bytes) + "}],"
+		"\"accessors\":[{\"bufferView\":0,\"componentType\":5126,\"count\":" + std::to_string(reference.size()) + ",\"type\":\"VEC3\"},"
+		"{\"bufferView\":0,\"byteOffset\":12,\"componentType\":5126,\"count\":" + std::to_string(reference.size()) + ",\"type\":\"VEC3\"},"
+		"{\"bufferView\":0,\"byteOffset\":24,\"componentType\":5126,\"count\":" + std::to_string(reference.size()) + ",\"type\":\"VEC2\"},"
+		"{\"bufferView\":1,\"componentType\":5125,\"count\":" + std::to_string(reference_indices.size()) + ",\"type\":\"SCALAR\"}],"
+		"\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"TEXCOORD_0\":2},\"indices\":3}]}]}";
+	json.resize((json.size() + 3) & ~static_cast<size_t>(3), ' ');
+	const auto write_u32 = [](std::ofstream& stream, uint32_t value) { stream.write(reinterpret_cast<const char*>(&value), 4); };
+	const std::filesystem::path directory = std::filesystem::temp_directory_path();
+	const std::string obj_path = (directory / "benchmark.obj").string();
+	const std::string glb_path = (directory / "benchmark.glb").string();
+	{
+		std::ofstream obj_file(obj_path, std::ios::binary);
+		obj_file.write(obj.data(), static_cast<std::streamsize>(obj.size()));
+		std::ofstream glb_file(glb_path, std::ios::binary);
+		glb_file.write("glTF", 4);
+		write_u32(glb_file, 2);
+		write_u32(glb_file, static_cast<uint32_t>(12 + 8 + json.size() + 8 + bin.size()));
+		write_u32(glb_file, static_cast<uint32_t>(json.size()));
+		write_u32(glb_file, 0x4E4F534Au);
+		glb_file.write(json.data(), static_cast<std::streamsize>(json.size()));
+		write_u32(glb_file, static_cast<uint32_t>(bin.size()));
+		write_u32(glb_file, 0x004E4942u);
+		glb_file.write(reinterpret_cast<const char*>(bin.data()), static_cast<std::streamsize>(bin.size()));
+		if (!obj_file || !glb_file)
+		{
+			std::cout << "Failed to write the benchmark meshes to " << directory.string() << '\n';
+			return -1;
+		}
+	}
+	const double obj_mb = static_cast<double>(obj.size()) / (1024.0 * 1024.0);
+	const double glb_mb = static_cast<double>(12 + 8 + json.size() + 8 + bin.size()) / (1024.0 * 1024.0);
+	std::string().swap(obj);
+	std::vector<unsigned char>().swap(bin);
+
+	// Every corner of an import must match the grid corner it came from.
+	const auto matches = [&](const std::vector<s_vertex>& vertices, const std::vector<GLuint>& indices)
+	{
+		if (vertices.size() != reference.size() || indices.size() != reference_indices.size())
+		{
+			return false;
+		}
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			const s_vertex& a = vertices[indices[i]];
+			const s_vertex& b = reference[reference_indices[i]];
+			if (a.position != b.position || a.normal != b.normal || glm::length(a.tex_coords - b.tex_coords) > 1e-6f)
+			{
+				return false;
+			}
+		}
+		return true;
+	};
+
+	// Before: getline and istringstream per line, corners merged through a string keyed map.
+	bool results_match = true;
+	std::vector<s_vertex> vertices;
+	std::vector<GLuint> indices;
+	auto start = std::chrono::high_resolution_clock::now();
+	{
+		std::ifstream stream(obj_path);
+		std::vector<glm::vec3> positions, normals;
+		std::vector<glm::vec2> tex_coords;
+		std::unordered_map<std::string, GLuint> corners;
+		std::string line;
+		while (std::getline(stream, line))
+		{
+			std::istringstream line_stream(line);
+			std::string type;
+			line_stream >> type;
+			if (type == "v" || type == "vn")
+			{
+				glm::vec3 value;
+				line_stream >> value.x >> value.y >> value.z;
+				((type == "v") ? positions : normals).push_back(value);
+			}
+			else if (type == "vt")
+			{
+				glm::vec2 value;
+				line_stream >> value.x >> value.y;
+				tex_coords.push_back(value);
+			}
+			else if (type == "f")
+			{
+				std::vector<GLuint> face;
+				std::string corner;
+				while (line_stream >> corner)
+				{
+					auto found = corners.find(corner);
+					if (found == corners.end())
+					{
+						int v = 0, vt = 0, vn = 0;
+						char slash;
+						std::istringstream corner_stream(corner);
+						corner_stream >> v >> slash >> vt >> slash >> vn;
+						vertices.push_back({ positions.at(v - 1), normals.at(vn - 1), tex_coords.at(vt - 1) });
+						found = corners.emplace(corner, static_cast<GLuint>(vertices.size() - 1)).first;
+					}
+					face.push_back(found->second);
+				}
+				for (size_t i = 2; i < face.size(); i++)
+				{
+					indices.insert(indices.end(), { face[0], face[i - 1], face[i] });
+				}
+			}
+		}
+	}
+	const double before_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	results_match &= matches(vertices, indices);
+
+	// After: mapped file, on this thread and then on the pool the way load() runs it.
+	double single_ms = 0.0;
+	double pool_ms = 0.0;
+	double glb_ms = 0.0;
+	c_mapped_file file;
+	c_thread_pool pool;
+	if (!file.open(obj_path.c_str()))
+	{
+		results_match = false;
+	}
+	for (int load = 0; load < loads && results_match; load++)
+	{
+		start = std::chrono::high_resolution_clock::now();
+		results_match &= c_mesh_importer::parse_obj(reinterpret_cast<const char*>(file.get_data()), file.get_size(), vertices, indices);
+		single_ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		results_match &= matches(vertices, indices);
+
+		start = std::chrono::high_resolution_clock::now();
+		results_match &= c_mesh_importer::parse_obj(reinterpret_cast<const char*>(file.get_data()), file.get_size(), vertices, indices, &pool);
+		pool_ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		results_match &= matches(vertices, indices);
+
+		start = std::chrono::high_resolution_clock::now();
+		results_match &= c_mesh_importer::load(glb_path.c_str(), vertices, indices, false);
+		glb_ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		results_match &= matches(vertices, indices);
+	}
+	single_ms /= loads;
+	pool_ms /= loads;
+	glb_ms /= loads;
+
+	file.close();
+	std::error_code error;
+	std::filesystem::remove(obj_path, error);
+	std::filesystem::remove(glb_path, error);
+
+	std::cout << "Mesh import (" << reference.size() << " vertices, " << reference_indices.size() / 3 << " triangles, " << obj_mb << " MB OBJ, " << glb_mb << " MB GLB)\n";
+	std::cout << "  Before (getline, istringstream, string keyed map): " << before_ms << " ms (" << obj_mb / (before_ms / 1000.0) << " MB/s)\n";
+	std::cout << "  After, one thread (mapped, from_chars, flat hash table): " << single_ms << " ms (" << obj_mb / (single_ms / 1000.0) << " MB/s)\n";
+	std::cout << "  After, " << pool.get_thread_count() << " threads: " << pool_ms << " ms (" << obj_mb / (pool_ms / 1000.0) << " MB/s)\n";
+	std::cout << "  GLB: " << glb_ms << " ms (" << glb_mb / (glb_ms / 1000.0) << " MB/s)\n";
+	std::cout << "  Speedup: " << before_ms / std::min(single_ms, pool_ms) << "x\n";
+	std::cout << "  Results match: " << (results_match ? "yes" : "no") << "\n";
+	return results_match ? 0 : -1;
+}
+
+int c_benchmark::benchmark_textures()
+{
+	GLFWwindow* window = create_hidden_context();
+	if (!window)
+	{
+		return -1;
+	}
+
+	// NVX_gpu_memory_info reports free VRAM in KB, other drivers only get the cache's own count.
+	auto available_vram_kb = []()
+	{
+		GLint kb = -1;
+		if (GLEW_NVX_gpu_memory_info)
+		{
+			glFinish(); // Let the driver finish deleting before asking.
+			glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &kb);
+		}
+		return kb;
+	};
+	auto elapsed_ms = [](std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	};
+
+	bool checks_pass = true;
+	{
+		c_texture_cache cache;
+		const GLint start_vram_kb = available_vram_kb();
+
+		// The same file through two spellings of its path.
+		auto start = std::chrono::high_resolution_clock::now();
+		c_texture_ref first = cache.load("Resources/Textures/texture_diffuse2.png");
+		const double miss_ms = elapsed_ms(start);
+		start = std::chrono::high_resolution_clock::now();
+		c_texture_ref second = cache.load("Resources/Textures/../Textures/texture_diffuse2.png");
+		const double hit_ms = elapsed_ms(start);
+		const bool file_shared = first.is_valid() && first.get_id() == second.get_id() && cache.get_upload_count() == 1;
+		checks_pass &= file_shared;
+		std::cout << "Texture cache\n";
+		std::cout << "  Same file loaded twice: " << cache.get_upload_count() << " upload, first load " << miss_ms << " ms, second " << hit_ms
+			<< " ms, same texture: " << (file_shared ? "yes" : "no") << "\n";
+
+		// Two atlases of the same frames, the second takes the first one's texture.
+		std::vector<std::string> coin_frames;
+		for (int i = 0; i <= 14; i++)
+		{
+			const std::string number = std::to_string(i);
+			coin_frames.push_back("Resources/Textures/coin/tile" + std::string(3 - number.size(), '0') + number + ".png");
+		}
+		GLuint atlas_texture = 0;
+		{
+			c_sprite_atlas first_atlas(&cache);
+			c_sprite_atlas second_atlas(&cache);
+			first_atlas.add_sequence(coin_frames);
+			second_atlas.add_sequence(coin_frames);
+			start = std::chrono::high_resolution_clock::now();
+			const bool first_built = first_atlas.build();
+			const double build_ms = elapsed_ms(start);
+			start = std::chrono::high_resolution_clock::now();
+			const bool second_built = second_atlas.build();
+			const double reuse_ms = elapsed_ms(start);
+			atlas_texture = first_atlas.get_texture_id();
+			const bool atlas_shared = first_built && second_built && atlas_texture == second_atlas.get_texture_id()
+				&& first_atlas.get_format() == second_atlas.get_format() && cache.get_upload_count() == 2;
+			checks_pass &= atlas_shared;
+			std::cout << "  Same atlas built twice: " << cache.get_upload_count() - 1 << " upload, first build " << build_ms << " ms, second "
+				<< reuse_ms << " ms, same texture: " << (atlas_shared ? "yes" : "no") << "\n";
+		}
+
+		// Nothing references them now, they stay resident until the budget says otherwise.
+		const GLuint file_texture = first.get_id();
+		first.reset();
+		second.reset();
+		const size_t resident_bytes = cache.get_resident_bytes();
+		const GLint loaded_vram_kb = available_vram_kb();
+		const bool kept = cache.get_unreferenced_count() == 2 && glIsTexture(file_texture) && glIsTexture(atlas_texture);
+		cache.set_budget(0);
+		const GLint evicted_vram_kb = available_vram_kb();
+		const bool evicted = cache.get_resident_bytes() == 0 && cache.get_texture_count() == 0 && !glIsTexture(file_texture) && !glIsTexture(atlas_texture);
+		checks_pass &= kept && evicted;
+		std::cout << "  Unreferenced: " << resident_bytes / 1024 << " KB resident, kept: " << (kept ? "yes" : "no") << "\n";
+		std::cout << "  Budget 0:     " << cache.get_resident_bytes() / 1024 << " KB resident, textures deleted: " << (evicted ? "yes" : "no") << "\n";
+		if (start_vram_kb >= 0)
+		{
+			std::cout << "  Driver free VRAM: " << start_vram_kb << " KB at start, " << loaded_vram_kb << " KB loaded, " << evicted_vram_kb
+				<< " KB after eviction\n";
+		}
+
+		// Released in order A, B, C with a budget that only fits C, the oldest go first.
+		cache.set_budget(c_texture_cache::default_budget);
+		const char* lru_paths[] = { "Resources/Textures/texture_diffuse3.png", "Resources/Textures/texture_diffuse4.png", "Resources/Textures/texture_diffuse6.png" };
+		GLuint lru_textures[3];
+		size_t last_bytes = 0;
+		for (int i = 0; i < 3; i++)
+		{
+			const size_t before = cache.get_resident_bytes();
+			c_texture_ref ref = cache.load(lru_paths[i]);
+			lru_textures[i] = ref.get_id();
+			last_bytes = cache.get_resident_bytes() - before;
+		}
+		cache.set_budget(last_bytes);
+		const bool lru_order = !glIsTexture(lru_textures[0]) && !glIsTexture(lru_textures[1]) && glIsTexture(lru_textures[2]) && cache.get_texture_count() == 1;
+		checks_pass &= lru_order;
+		std::cout << "  LRU: budget of one texture keeps the last released: " << (lru_order ? "yes" : "no") << "\n";
+	}
+	glfwTerminate();
+	return checks_pass ? 0 : -1;
+}
@@ -0,0 +1,98 @@
+﻿// /***********************************************************************
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+// (c) 2024 Media Design School
+// File Name : c_benchmark.h
+// Description : Class with static methods to run the performance benchmarks.
+// Author : Foster Rae
+// Mail : Foster.Rae@mds.ac.nz
+// ************************************************************************/
+#pragma once
+#include <string>
+#include "c_graphics_utils.h"
+
+/**
+ * @class c_benchmark
+ * @brief Runs the performance benchmarks from the command line.
+ * @note Run the executable with: --benchmark <name>
+ */
+class c_benchmark
+{
+public:
+
+	// == Public Methods ==
+	/**
+	 * @brief Runs the benchmark with the given name and prints the results.
+	 *
+	 * @param name The name of the benchmark to run.
+	 * @return 0 if the benchmark ran, -1 if it failed or does not exist.
+	 */
+	static int run(const std::string& name);
+
+private:
+
+	// == Constructors / Destructors ==
+	c_benchmark() = default;  // Static class.
+	~c_benchmark() = default;
+
+	// == Private Methods ==
+	/**
+	 * @brief Creates a hidden window so benchmarks that need an OpenGL context can run.
+	 *
+	 * @return A pointer to the hidden window, or nullptr if it failed.
+	 */
+	static GLFWwindow* create_hidden_context();
+
+	// == Benchmarks ==
+	/**
+	 * @brief Compares the per-draw CPU cost of string uniform lookups against pre-resolved locations.
+	 *
+	 * @return 0 if the benchmark ran, -1 if it failed.
+	 */
+	static int benchmark_uniforms();
+	/**
+	 * @brief Compares building 1M model matrices from heap-allocated objects against the SoA transform store.
+	 *
+	 * @return 0 if the benchmark ran, -1 if the results didn't match.
+	 */
+	static int benchmark_transforms();
+	/**
+	 * @brief Compares BVH frustum, ray and overlap queries against linear scans from 1k to 1M cubes.
+	 *
+	 * @return 0 if the benchmark ran, -1 if the BVH and linear results didn't match.
+	 */
+	static int benchmark_bvh();
+	/**
+	 * @brief Measures the BC1/BC3 encoder's speed and its PSNR against the source images.
+	 *
+	 * @return 0 if the benchmark ran, -1 if an image failed to load.
+	 */
+	static int benchmark_bcn();
+	/**
+	 * @brief Times 100k animated sprites from two atlases over random layers through the sprite batcher, headless.
+	 *
+	 * @return 0 if the benchmark ran, -1 if the context, shaders or atlases failed.
+	 */
+	static int benchmark_sprites();
+	/**
+	 * @brief Compares building a 1M cube scene one c_cube at a time against bulk loading it from a scene file, and times
+	 *        the rest of initial_setup's load path.
+	 *
+	 * @return 0 if the benchmark ran, -1 if the file failed or the loaded transforms didn't match.
+	 */
+	static int benchmark_scene();
+	/**
+	 * @brief Measures OBJ and GLB import throughput on a generated ~100 MB grid model against a getline/istringstream parser.
+	 *
+	 * @return 0 if the benchmark ran, -1 if a file failed or the imported meshes didn't match.
+	 */
+	static int benchmark_meshes();
+	/**
+	 * @brief Checks the texture cache shares repeated loads and atlases, and that eviction under the budget deletes the textures.
+	 *
+	 * @return 0 if every check passed, -1 otherwise.
+	 */
+	static int benchmark_textures();
+};
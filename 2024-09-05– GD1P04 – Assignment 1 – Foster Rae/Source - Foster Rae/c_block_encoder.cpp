@@ -0,0 +1,497 @@
+﻿#include "c_block_encoder.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "c_thread_pool.h"
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <xmmintrin.h>
+#define BLOCK_ENCODER_SSE
+#endif
+
+/**
+ * @brief Quantizes a colour to 5:6:5.
+ *
+ * @param colour The red, green and blue from 0 to 255.
+ * @return The packed colour.
+ */
+static uint16_t pack_565(const float* colour)
+{
+	const int r = std::clamp(static_cast<int>(colour[0] * (31.0f / 255.0f) + 0.5f), 0, 31);
+	const int g = std::clamp(static_cast<int>(colour[1] * (63.0f / 255.0f) + 0.5f), 0, 63);
+	const int b = std::clamp(static_cast<int>(colour[2] * (31.0f / 255.0f) + 0.5f), 0, 31);
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+/**
+ * @brief Expands a 5:6:5 colour to 8 bits a channel, the same way the GPU does.
+ *
+ * @param packed The packed colour.
+ * @param colour The red, green and blue from 0 to 255.
+ */
+static void unpack_565(uint16_t packed, float* colour)
+{
+	const int r = (packed >> 11) & 31;
+	const int g = (packed >> 5) & 63;
+	const int b = packed & 31;
+	colour[0] = static_cast<float>((r << 3) | (r >> 2));
+	colour[1] = static_cast<float>((g << 2) | (g >> 4));
+	colour[2] = static_cast<float>((b << 3) | (b >> 2));
+}
+
+/**
+ * @brief Picks the nearest palette colour for every pixel of a block.
+ * @note Ties go to the lower index.
+ *
+ * @param r The red of the 16 pixels.
+ * @param g The green of the 16 pixels.
+ * @param b The blue of the 16 pixels.
+ * @param palette The 4 palette colours.
+ * @param indices The chosen palette index of each pixel.
+ * @return The summed squared error of the block.
+ */
+static float select_indices(const float* r, const float* g, const float* b, const float palette[4][3], int* indices)
+{
+	float error = 0.0f;
+#ifdef BLOCK_ENCODER_SSE
+	// Four pixels at a time against each palette entry.
+	for (int i = 0; i < 16; i += 4)
+	{
+		const __m128 pixel_r = _mm_loadu_ps(r + i);
+		const __m128 pixel_g = _mm_loadu_ps(g + i);
+		const __m128 pixel_b = _mm_loadu_ps(b + i);
+		__m128 best_distance = _mm_set1_ps(FLT_MAX);
+		__m128 best_index = _mm_setzero_ps();
+		for (int p = 0; p < 4; p++)
+		{
+			const __m128 dr = _mm_sub_ps(pixel_r, _mm_set1_ps(palette[p][0]));
+			const __m128 dg = _mm_sub_ps(pixel_g, _mm_set1_ps(palette[p][1]));
+			const __m128 db = _mm_sub_ps(pixel_b, _mm_set1_ps(palette[p][2]));
+			const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+			const __m128 closer = _mm_cmplt_ps(distance, best_distance);
+			best_distance = _mm_min_ps(distance, best_distance);
+			best_index = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps(static_cast<float>(p))), _mm_andnot_ps(closer, best_index));
+		}
+
+		float distances[4];
+		float chosen[4];
+		_mm_storeu_ps(distances, best_distance);
+		_mm_storeu_ps(chosen, best_index);
+		for (int lane = 0; lane < 4; lane++)
+		{
+			indices[i + lane] = static_cast<int>(chosen[lane]);
+			error += distances[lane];
+		}
+	}
+#else
+	for (int i = 0; i < 16; i++)
+	{
+		float best_distance = FLT_MAX;
+		for (int p = 0; p < 4; p++)
+		{
+			const float dr = r[i] - palette[p][0];
+			const float dg = g[i] - palette[p][1];
+			const float db = b[i] - palette[p][2];
+			const float distance = dr * dr + dg * dg + db * db;
+			if (distance < best_distance)
+			{
+				best_distance = distance;
+				indices[i] = p;
+			}
+		}
+		error += best_distance;
+	}
+#endif
+	return error;
+}
+
+/**
+ * @brief Quantizes a pair of endpoints and finds the indices and error they give.
+ *
+ * @param start The first endpoint from 0 to 255.
+ * @param end The second endpoint from 0 to 255.
+ * @param r The red of the 16 pixels.
+ * @param g The green of the 16 pixels.
+ * @param b The blue of the 16 pixels.
+ * @param colour0 The packed endpoint with the larger value.
+ * @param colour1 The packed endpoint with the smaller value.
+ * @param indices The palette index of each pixel.
+ * @return The summed squared error of the block.
+ */
+static float evaluate_endpoints(const float* start, const float* end, const float* r, const float* g, const float* b, uint16_t& colour0, uint16_t& colour1, int* indices)
+{
+	// colour0 > colour1 selects the four colour mode.
+	colour0 = pack_565(start);
+	colour1 = pack_565(end);
+	if (colour0 < colour1)
+	{
+		std::swap(colour0, colour1);
+	}
+
+	float palette[4][3];
+	unpack_565(colour0, palette[0]);
+	unpack_565(colour1, palette[1]);
+	for (int channel = 0; channel < 3; channel++)
+	{
+		palette[2][channel] = (2.0f * palette[0][channel] + palette[1][channel]) / 3.0f;
+		palette[3][channel] = (palette[0][channel] + 2.0f * palette[1][channel]) / 3.0f;
+	}
+	// Equal endpoints are the three colour mode where index 3 is black, the tie rule keeps every pixel on index 0.
+	return select_indices(r, g, b, palette, indices);
+}
+
+// == Public Methods ==
+GLenum c_block_encoder::choose_format(const unsigned char* pixels, int width, int height)
+{
+	const size_t pixel_count = static_cast<size_t>(width) * height;
+	for (size_t i = 0; i < pixel_count; i++)
+	{
+		if (pixels[i * 4 + 3] != 255)
+		{
+			return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		}
+	}
+	return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+}
+
+std::vector<unsigned char> c_block_encoder::encode(const unsigned char* pixels, int width, int height, GLenum format, c_thread_pool* pool)
+{
+	const int blocks_x = (width + 3) / 4;
+	const int blocks_y = (height + 3) / 4;
+	std::vector<unsigned char> blocks(static_cast<size_t>(blocks_x) * blocks_y * get_block_size(format));
+	if (pool == nullptr || blocks_y < 2)
+	{
+		encode_rows(pixels, width, height, format, 0, blocks_y, blocks.data());
+		return blocks;
+	}
+
+	// A few bands per worker so an uneven band doesn't leave the rest waiting.
+	const int band_rows = std::max(1, blocks_y / (pool->get_thread_count() * 4));
+	for (int first_row = 0; first_row < blocks_y; first_row += band_rows)
+	{
+		const int last_row = std::min(blocks_y, first_row + band_rows);
+		unsigned char* output = blocks.data();
+		pool->submit([=]() { encode_rows(pixels, width, height, format, first_row, last_row, output); });
+	}
+	pool->wait_idle();
+	return blocks;
+}
+
+std::vector<unsigned char> c_block_encoder::decode(const unsigned char* blocks, int width, int height, GLenum format)
+{
+	const int blocks_x = (width + 3) / 4;
+	const int blocks_y = (height + 3) / 4;
+	const size_t block_size = get_block_size(format);
+	std::vector<unsigned char> pixels(static_cast<size_t>(width) * height * 4);
+	unsigned char block[64];
+	for (int by = 0; by < blocks_y; by++)
+	{
+		for (int bx = 0; bx < blocks_x; bx++)
+		{
+			const unsigned char* input = blocks + (static_cast<size_t>(by) * blocks_x + bx) * block_size;
+			if (format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+			{
+				decode_colour_block(input + 8, true, block);
+				decode_alpha_block(input, block);
+			}
+			else
+			{
+				decode_colour_block(input, false, block);
+			}
+
+			// Drop the pixels past the edge of the image.
+			for (int y = 0; y < 4 && by * 4 + y < height; y++)
+			{
+				for (int x = 0; x < 4 && bx * 4 + x < width; x++)
+				{
+					std::memcpy(&pixels[(static_cast<size_t>(by * 4 + y) * width + bx * 4 + x) * 4], &block[(y * 4 + x) * 4], 4);
+				}
+			}
+		}
+	}
+	return pixels;
+}
+
+// == Private Methods ==
+void c_block_encoder::encode_colour_block(const unsigned char* block, unsigned char* output)
+{
+	float r[16], g[16], b[16];
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++)
+	{
+		r[i] = block[i * 4 + 0];
+		g[i] = block[i * 4 + 1];
+		b[i] = block[i * 4 + 2];
+		mean[0] += r[i];
+		mean[1] += g[i];
+		mean[2] += b[i];
+	}
+	for (float& channel : mean)
+	{
+		channel /= 16.0f;
+	}
+
+	// Covariance of the colours, the principal axis is the line the endpoints should sit on.
+	float covariance[6] = {}; // rr, rg, rb, gg, gb, bb
+	for (int i = 0; i < 16; i++)
+	{
+		const float dr = r[i] - mean[0];
+		const float dg = g[i] - mean[1];
+		const float db = b[i] - mean[2];
+		covariance[0] += dr * dr;
+		covariance[1] += dr * dg;
+		covariance[2] += dr * db;
+		covariance[3] += dg * dg;
+		covariance[4] += dg * db;
+		covariance[5] += db * db;
+	}
+
+	// Power iteration, a handful of steps is plenty for a 3x3 matrix.
+	float axis[3] = { 1.0f, 1.0f, 1.0f };
+	for (int step = 0; step < 8; step++)
+	{
+		const float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+		const float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+		const float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+		const float largest = std::max(std::fabs(x), std::max(std::fabs(y), std::fabs(z)));
+		if (largest < FLT_EPSILON)
+		{
+			break; // A flat block, any axis works.
+		}
+		axis[0] = x / largest;
+		axis[1] = y / largest;
+		axis[2] = z / largest;
+	}
+
+	// The pixels furthest along the axis are the first guess at the endpoints.
+	int min_pixel = 0;
+	int max_pixel = 0;
+	float min_projection = FLT_MAX;
+	float max_projection = -FLT_MAX;
+	for (int i = 0; i < 16; i++)
+	{
+		const float projection = r[i] * axis[0] + g[i] * axis[1] + b[i] * axis[2];
+		if (projection < min_projection)
+		{
+			min_projection = projection;
+			min_pixel = i;
+		}
+		if (projection > max_projection)
+		{
+			max_projection = projection;
+			max_pixel = i;
+		}
+	}
+	const float start[3] = { r[max_pixel], g[max_pixel], b[max_pixel] };
+	const float end[3] = { r[min_pixel], g[min_pixel], b[min_pixel] };
+	uint16_t colour0, colour1;
+	int indices[16];
+	float error = evaluate_endpoints(start, end, r, g, b, colour0, colour1, indices);
+
+	// Refit the endpoints to the chosen indices with least squares, keep it if it is better.
+	if (colour0 != colour1)
+	{
+		static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f }; // Weight of colour0 for each index.
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[3] = {}, bx[3] = {};
+		for (int i = 0; i < 16; i++)
+		{
+			const float alpha = weights[indices[i]];
+			const float beta = 1.0f - alpha;
+			const float pixel[3] = { r[i], g[i], b[i] };
+			aa += alpha * alpha;
+			ab += alpha * beta;
+			bb += beta * beta;
+			for (int channel = 0; channel < 3; channel++)
+			{
+				ax[channel] += alpha * pixel[channel];
+				bx[channel] += beta * pixel[channel];
+			}
+		}
+
+		const float determinant = aa * bb - ab * ab;
+		if (std::fabs(determinant) > FLT_EPSILON)
+		{
+			float refit_start[3], refit_end[3];
+			for (int channel = 0; channel < 3; channel++)
+			{
+				refit_start[channel] = (ax[channel] * bb - bx[channel] * ab) / determinant;
+				refit_end[channel] = (bx[channel] * aa - ax[channel] * ab) / determinant;
+			}
+			uint16_t refit_colour0, refit_colour1;
+			int refit_indices[16];
+			const float refit_error = evaluate_endpoints(refit_start, refit_end, r, g, b, refit_colour0, refit_colour1, refit_indices);
+			if (refit_error < error)
+			{
+				colour0 = refit_colour0;
+				colour1 = refit_colour1;
+				std::memcpy(indices, refit_indices, sizeof(indices));
+			}
+		}
+	}
+
+	// Endpoints little endian, then 2 bits a pixel with the first pixel lowest.
+	uint32_t packed_indices = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		packed_indices |= static_cast<uint32_t>(indices[i]) << (i * 2);
+	}
+	output[0] = static_cast<unsigned char>(colour0 & 0xFF);
+	output[1] = static_cast<unsigned char>(colour0 >> 8);
+	output[2] = static_cast<unsigned char>(colour1 & 0xFF);
+	output[3] = static_cast<unsigned char>(colour1 >> 8);
+	for (int i = 0; i < 4; i++)
+	{
+		output[4 + i] = static_cast<unsigned char>(packed_indices >> (i * 8));
+	}
+}
+
+void c_block_encoder::encode_alpha_block(const unsigned char* block, unsigned char* output)
+{
+	unsigned char min_alpha = 255;
+	unsigned char max_alpha = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		min_alpha = std::min(min_alpha, block[i * 4 + 3]);
+		max_alpha = std::max(max_alpha, block[i * 4 + 3]);
+	}
+
+	// alpha0 > alpha1 selects the 8 value mode, 6 evenly spaced steps between the two.
+	output[0] = max_alpha;
+	output[1] = min_alpha;
+	uint64_t packed_indices = 0;
+	if (max_alpha != min_alpha)
+	{
+		const float scale = 7.0f / static_cast<float>(max_alpha - min_alpha);
+		for (int i = 0; i < 16; i++)
+		{
+			// Position 0 is alpha1 (index 1), 7 is alpha0 (index 0), the steps between run down from index 7.
+			const int position = static_cast<int>(static_cast<float>(block[i * 4 + 3] - min_alpha) * scale + 0.5f);
+			const int index = (position == 7) ? 0 : (position == 0) ? 1 : 8 - position;
+			packed_indices |= static_cast<uint64_t>(index) << (i * 3);
+		}
+	}
+	for (int i = 0; i < 6; i++)
+	{
+		output[2 + i] = static_cast<unsigned char>(packed_indices >> (i * 8));
+	}
+}
+
+void c_block_encoder::encode_rows(const unsigned char* pixels, int width, int height, GLenum format, int first_row, int last_row, unsigned char* output)
+{
+	const int blocks_x = (width + 3) / 4;
+	const size_t block_size = get_block_size(format);
+	unsigned char block[64];
+	for (int by = first_row; by < last_row; by++)
+	{
+		for (int bx = 0; bx < blocks_x; bx++)
+		{
+			// Gather the block, clamping at the edges.
+			for (int y = 0; y < 4; y++)
+			{
+				const int source_y = std::min(by * 4 + y, height - 1);
+				for (int x = 0; x < 4; x++)
+				{
+					const int source_x = std::min(bx * 4 + x, width - 1);
+					std::memcpy(&block[(y * 4 + x) * 4], &pixels[(static_cast<size_t>(source_y) * width + source_x) * 4], 4);
+				}
+			}
+
+			unsigned char* destination = output + (static_cast<size_t>(by) * blocks_x + bx) * block_size;
+			if (format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+			{
+				encode_alpha_block(block, destination);
+
+				// The colour of invisible pixels is never seen, copy a visible one over it so it doesn't pull the endpoints.
+				const unsigned char* visible = nullptr;
+				for (int i = 0; i < 16 && visible == nullptr; i++)
+				{
+					visible = (block[i * 4 + 3] > 0) ? &block[i * 4] : nullptr;
+				}
+				for (int i = 0; i < 16 && visible != nullptr; i++)
+				{
+					if (block[i * 4 + 3] == 0)
+					{
+						std::memcpy(&block[i * 4], visible, 3);
+					}
+				}
+				encode_colour_block(block, destination + 8);
+			}
+			else
+			{
+				encode_colour_block(block, destination);
+			}
+		}
+	}
+}
+
+void c_block_encoder::decode_colour_block(const unsigned char* input, bool always_four_colours, unsigned char* block)
+{
+	const uint16_t colour0 = static_cast<uint16_t>(input[0] | (input[1] << 8));
+	const uint16_t colour1 = static_cast<uint16_t>(input[2] | (input[3] << 8));
+	float palette[4][4];
+	unpack_565(colour0, palette[0]);
+	unpack_565(colour1, palette[1]);
+	palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255.0f;
+	for (int channel = 0; channel < 3; channel++)
+	{
+		if (always_four_colours || colour0 > colour1)
+		{
+			palette[2][channel] = (2.0f * palette[0][channel] + palette[1][channel]) / 3.0f;
+			palette[3][channel] = (palette[0][channel] + 2.0f * palette[1][channel]) / 3.0f;
+		}
+		else
+		{
+			palette[2][channel] = (palette[0][channel] + palette[1][channel]) / 2.0f;
+			palette[3][channel] = 0.0f;
+		}
+	}
+	if (!always_four_colours && colour0 <= colour1)
+	{
+		palette[3][3] = 0.0f; // Transparent black.
+	}
+
+	const uint32_t packed_indices = static_cast<uint32_t>(input[4]) | (input[5] << 8) | (input[6] << 16) | (static_cast<uint32_t>(input[7]) << 24);
+	for (int i = 0; i < 16; i++)
+	{
+		const float* colour = palette[(packed_indices >> (i * 2)) & 3];
+		for (int channel = 0; channel < 4; channel++)
+		{
+			block[i * 4 + channel] = static_cast<unsigned char>(colour[channel] + 0.5f);
+		}
+	}
+}
+
+void c_block_encoder::decode_alpha_block(const unsigned char* input, unsigned char* block)
+{
+	const int alpha0 = input[0];
+	const int alpha1 = input[1];
+	int values[8] = { alpha0, alpha1 };
+	if (alpha0 > alpha1)
+	{
+		for (int i = 2; i < 8; i++)
+		{
+			values[i] = ((8 - i) * alpha0 + (i - 1) * alpha1 + 3) / 7;
+		}
+	}
+	else
+	{
+		for (int i = 2; i < 6; i++)
+		{
+			values[i] = ((6 - i) * alpha0 + (i - 1) * alpha1 + 2) / 5;
+		}
+		values[6] = 0;
+		values[7] = 255;
+	}
+
+	uint64_t packed_indices = 0;
+	for (int i = 0; i < 6; i++)
+	{
+		packed_indices |= static_cast<uint64_t>(input[2 + i]) << (i * 8);
+	}
+	for (int i = 0; i < 16; i++)
+	{
+		block[i * 4 + 3] = static_cast<unsigned char>(values[(packed_indices >> (i * 3)) & 7]);
+	}
+}
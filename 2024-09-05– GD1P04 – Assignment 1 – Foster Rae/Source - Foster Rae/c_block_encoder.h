@@ -0,0 +1,111 @@
+﻿// /***********************************************************************
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+// (c) 2024 Media Design School
+// File Name : c_block_encoder.h
+// Description : Class with static methods that compress images to BC1 and BC3 blocks.
+// Author : Foster Rae
+// Mail : Foster.Rae@mds.ac.nz
+// ************************************************************************/
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <glew.h>
+
+class c_thread_pool;
+
+/**
+ * @class c_block_encoder
+ * @brief Compresses RGBA8 images to BC1 (opaque, 8 bytes a block) or BC3 (alpha, 16 bytes a block) 4x4 blocks.
+ * @note The colour endpoints follow the principal axis of the block, then are refit with least squares.
+ *       The palette search tests four pixels at a time with SSE. Slow next to a GPU encoder, it is meant for cooking.
+ */
+class c_block_encoder
+{
+public:
+
+	// == Public Methods ==
+	/**
+	 * @brief Picks the format for an image, BC3 if any pixel is not fully opaque, otherwise BC1.
+	 *
+	 * @param pixels The RGBA8 pixels.
+	 * @param width The width of the image.
+	 * @param height The height of the image.
+	 * @return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT or GL_COMPRESSED_RGB_S3TC_DXT1_EXT.
+	 */
+	static GLenum choose_format(const unsigned char* pixels, int width, int height);
+	/**
+	 * @brief Compresses an image. Edge blocks of sizes that aren't a multiple of 4 repeat the last row and column.
+	 * @note Don't pass a pool from inside one of its own jobs, the encode waits for the pool to go idle.
+	 *
+	 * @param pixels The RGBA8 pixels.
+	 * @param width The width of the image.
+	 * @param height The height of the image.
+	 * @param format GL_COMPRESSED_RGB_S3TC_DXT1_EXT or GL_COMPRESSED_RGBA_S3TC_DXT5_EXT.
+	 * @param pool Optional pool to spread the block rows over, nullptr to encode on this thread.
+	 * @return The blocks, row by row.
+	 */
+	static std::vector<unsigned char> encode(const unsigned char* pixels, int width, int height, GLenum format, c_thread_pool* pool = nullptr);
+	/**
+	 * @brief Decompresses an image, used to measure the quality of the encoder.
+	 *
+	 * @param blocks The blocks, row by row.
+	 * @param width The width of the image.
+	 * @param height The height of the image.
+	 * @param format GL_COMPRESSED_RGB_S3TC_DXT1_EXT or GL_COMPRESSED_RGBA_S3TC_DXT5_EXT.
+	 * @return The RGBA8 pixels.
+	 */
+	static std::vector<unsigned char> decode(const unsigned char* blocks, int width, int height, GLenum format);
+	/**
+	 * @brief Gets the size of one 4x4 block.
+	 * @param format GL_COMPRESSED_RGB_S3TC_DXT1_EXT or GL_COMPRESSED_RGBA_S3TC_DXT5_EXT.
+	 * @return 8 for BC1, 16 for BC3.
+	 */
+	static size_t get_block_size(GLenum format) { return (format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT) ? 16 : 8; }
+
+private:
+
+	// == Constructors / Destructors ==
+	c_block_encoder() = default;  // Static class.
+	~c_block_encoder() = default;
+
+	// == Private Methods ==
+	/**
+	 * @brief Encodes the colour of a block.
+	 * @param block The 16 RGBA8 pixels of the block, row by row.
+	 * @param output The 8 byte BC1 block.
+	 */
+	static void encode_colour_block(const unsigned char* block, unsigned char* output);
+	/**
+	 * @brief Encodes the alpha of a block as the 8 value interpolated BC3 alpha block.
+	 * @param block The 16 RGBA8 pixels of the block, row by row.
+	 * @param output The 8 byte alpha block.
+	 */
+	static void encode_alpha_block(const unsigned char* block, unsigned char* output);
+	/**
+	 * @brief Encodes the blocks of some block rows.
+	 * @param pixels The RGBA8 pixels.
+	 * @param width The width of the image.
+	 * @param height The height of the image.
+	 * @param format The block format.
+	 * @param first_row The first block row.
+	 * @param last_row One past the last block row.
+	 * @param output The start of the output blocks for the whole image.
+	 */
+	static void encode_rows(const unsigned char* pixels, int width, int height, GLenum format, int first_row, int last_row, unsigned char* output);
+	/**
+	 * @brief Decodes the colour of a block.
+	 * @param input The 8 byte BC1 block.
+	 * @param always_four_colours True for the colour half of BC3, which ignores the endpoint order.
+	 * @param block The 16 RGBA8 pixels of the block, alpha is 0 for the transparent index of BC1.
+	 */
+	static void decode_colour_block(const unsigned char* input, bool always_four_colours, unsigned char* block);
+	/**
+	 * @brief Decodes a BC3 alpha block into the alpha of the pixels.
+	 * @param input The 8 byte alpha block.
+	 * @param block The 16 RGBA8 pixels of the block, only alpha is written.
+	 */
+	static void decode_alpha_block(const unsigned char* input, unsigned char* block);
+};
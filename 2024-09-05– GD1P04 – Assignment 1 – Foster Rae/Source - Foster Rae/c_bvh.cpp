@@ -0,0 +1,427 @@
+﻿#include "c_bvh.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+/**
+ * @brief Gets half the surface area of a box, enough to compare SAH costs.
+ *
+ * @param box_min The minimum corner.
+ * @param box_max The maximum corner.
+ * @return The half surface area, 0 for an empty box.
+ */
+static float half_area(const glm::vec3& box_min, const glm::vec3& box_max)
+{
+	const glm::vec3 size = box_max - box_min;
+	if (size.x < 0.0f)
+	{
+		return 0.0f;
+	}
+	return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+/**
+ * @brief Tests a ray against a box with the slab method.
+ *
+ * @param origin The start of the ray.
+ * @param inverse_direction 1 / the ray direction.
+ * @param box_min The minimum corner.
+ * @param box_max The maximum corner.
+ * @return The distance to the box (0 if the origin is inside), or FLT_MAX if it misses.
+ */
+static float intersect_ray_box(const glm::vec3& origin, const glm::vec3& inverse_direction, const glm::vec3& box_min, const glm::vec3& box_max)
+{
+	const glm::vec3 t1 = (box_min - origin) * inverse_direction;
+	const glm::vec3 t2 = (box_max - origin) * inverse_direction;
+	const glm::vec3 t_near = glm::min(t1, t2);
+	const glm::vec3 t_far = glm::max(t1, t2);
+	const float t_min = std::max(std::max(t_near.x, t_near.y), std::max(t_near.z, 0.0f));
+	const float t_max = std::min(std::min(t_far.x, t_far.y), t_far.z);
+	return (t_max >= t_min) ? t_min : FLT_MAX;
+}
+
+/**
+ * @brief How a box sits relative to a frustum.
+ */
+enum class e_frustum_test { outside, intersecting, inside };
+
+/**
+ * @brief Classifies a box against the frustum planes.
+ *
+ * @param frustum The frustum.
+ * @param box_min The minimum corner.
+ * @param box_max The maximum corner.
+ * @return Whether the box is outside, crossing a plane or fully inside.
+ */
+static e_frustum_test classify_box(const c_frustum& frustum, const glm::vec3& box_min, const glm::vec3& box_max)
+{
+	const glm::vec3 center = (box_min + box_max) * 0.5f;
+	const glm::vec3 extents = (box_max - box_min) * 0.5f;
+	e_frustum_test result = e_frustum_test::inside;
+	for (int p = 0; p < c_frustum::plane_count; p++)
+	{
+		const glm::vec4& plane = frustum.get_plane(p);
+		const float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+		const float radius = glm::dot(glm::abs(glm::vec3(plane)), extents);
+		if (distance + radius < 0.0f)
+		{
+			return e_frustum_test::outside;
+		}
+		if (distance - radius < 0.0f)
+		{
+			result = e_frustum_test::intersecting;
+		}
+	}
+	return result;
+}
+
+// == Public Methods ==
+void c_bvh::build(const c_transform_store& transforms)
+{
+	const int count = static_cast<int>(transforms.get_count());
+	nodes_.clear();
+	items_.resize(count);
+	bounds_.resize(count);
+	item_leaf_.assign(count, 0);
+	if (count == 0)
+	{
+		return;
+	}
+
+	// Gather the bounds once, the build only reads these.
+	for (int i = 0; i < count; i++)
+	{
+		items_[i] = i;
+		bounds_[i] = get_item_bounds(transforms, i);
+	}
+
+	// A binary tree with n leaves has at most 2n - 1 nodes, reserve so references stay valid while splitting.
+	nodes_.reserve(static_cast<size_t>(count) * 2);
+	nodes_.push_back({ glm::vec3(0.0f), 0, glm::vec3(0.0f), count, -1 });
+	fit_leaf(nodes_[0]);
+	subdivide(0, 0);
+
+	// Remember which leaf holds each item for single item refits.
+	for (int n = 0; n < static_cast<int>(nodes_.size()); n++)
+	{
+		const s_node& node = nodes_[n];
+		for (int i = 0; i < node.count; i++)
+		{
+			item_leaf_[items_[node.left_first + i]] = n;
+		}
+	}
+}
+
+void c_bvh::refit(const c_transform_store& transforms)
+{
+	for (int i = 0; i < static_cast<int>(bounds_.size()); i++)
+	{
+		bounds_[i] = get_item_bounds(transforms, i);
+	}
+
+	// Children are stored after their parents, so going backwards fits the children first.
+	for (int n = static_cast<int>(nodes_.size()) - 1; n >= 0; n--)
+	{
+		(nodes_[n].count > 0) ? fit_leaf(nodes_[n]) : fit_internal(n);
+	}
+}
+
+void c_bvh::refit(const c_transform_store& transforms, int handle)
+{
+	bounds_[handle] = get_item_bounds(transforms, handle);
+
+	// Fit the leaf then walk up to the root.
+	int node_index = item_leaf_[handle];
+	fit_leaf(nodes_[node_index]);
+	for (node_index = nodes_[node_index].parent; node_index >= 0; node_index = nodes_[node_index].parent)
+	{
+		fit_internal(node_index);
+	}
+}
+
+int c_bvh::query_frustum(const c_frustum& frustum, std::vector<int>& results) const
+{
+	results.clear();
+	if (nodes_.empty())
+	{
+		return 0;
+	}
+
+	// Each entry is a node and whether it is already known to be fully inside.
+	int stack[max_depth + 1];
+	bool stack_inside[max_depth + 1];
+	int stack_size = 0;
+	stack[stack_size] = 0;
+	stack_inside[stack_size++] = false;
+	while (stack_size > 0)
+	{
+		stack_size--;
+		const s_node& node = nodes_[stack[stack_size]];
+		bool inside = stack_inside[stack_size];
+		if (!inside)
+		{
+			const e_frustum_test test = classify_box(frustum, node.bounds_min, node.bounds_max);
+			if (test == e_frustum_test::outside)
+			{
+				continue;
+			}
+			inside = (test == e_frustum_test::inside);
+		}
+
+		if (node.count > 0)
+		{
+			// Leaf, items only need testing if the leaf crosses a plane.
+			for (int i = 0; i < node.count; i++)
+			{
+				const int item = items_[node.left_first + i];
+				if (inside || classify_box(frustum, bounds_[item].bounds_min, bounds_[item].bounds_max) != e_frustum_test::outside)
+				{
+					results.push_back(item);
+				}
+			}
+			continue;
+		}
+		stack[stack_size] = node.left_first + 1;
+		stack_inside[stack_size++] = inside;
+		stack[stack_size] = node.left_first;
+		stack_inside[stack_size++] = inside;
+	}
+	return static_cast<int>(results.size());
+}
+
+int c_bvh::ray_cast(const glm::vec3& origin, const glm::vec3& direction, float max_distance, float* hit_distance) const
+{
+	if (nodes_.empty())
+	{
+		return -1;
+	}
+
+	const glm::vec3 inverse_direction = 1.0f / direction;
+	float closest = max_distance;
+	int closest_item = -1;
+
+	int stack[max_depth + 1];
+	int stack_size = 0;
+	stack[stack_size++] = 0;
+	while (stack_size > 0)
+	{
+		const s_node& node = nodes_[stack[--stack_size]];
+		if (intersect_ray_box(origin, inverse_direction, node.bounds_min, node.bounds_max) >= closest)
+		{
+			continue;
+		}
+
+		if (node.count > 0)
+		{
+			for (int i = 0; i < node.count; i++)
+			{
+				const int item = items_[node.left_first + i];
+				const float distance = intersect_ray_box(origin, inverse_direction, bounds_[item].bounds_min, bounds_[item].bounds_max);
+				if (distance < closest)
+				{
+					closest = distance;
+					closest_item = item;
+				}
+			}
+			continue;
+		}
+
+		// Visit the nearer child first so the further one is more likely to be skipped.
+		int near_child = node.left_first;
+		int far_child = node.left_first + 1;
+		const float near_distance = intersect_ray_box(origin, inverse_direction, nodes_[near_child].bounds_min, nodes_[near_child].bounds_max);
+		const float far_distance = intersect_ray_box(origin, inverse_direction, nodes_[far_child].bounds_min, nodes_[far_child].bounds_max);
+		if (far_distance < near_distance)
+		{
+			std::swap(near_child, far_child);
+		}
+		stack[stack_size++] = far_child;
+		stack[stack_size++] = near_child;
+	}
+
+	if (closest_item >= 0 && hit_distance != nullptr)
+	{
+		*hit_distance = closest;
+	}
+	return closest_item;
+}
+
+int c_bvh::query_overlap(const glm::vec3& box_min, const glm::vec3& box_max, std::vector<int>& results) const
+{
+	results.clear();
+	if (nodes_.empty())
+	{
+		return 0;
+	}
+
+	// Boxes overlap if they overlap on every axis.
+	auto overlaps = [&box_min, &box_max](const glm::vec3& other_min, const glm::vec3& other_max)
+	{
+		return glm::all(glm::lessThanEqual(box_min, other_max)) && glm::all(glm::lessThanEqual(other_min, box_max));
+	};
+
+	int stack[max_depth + 1];
+	int stack_size = 0;
+	stack[stack_size++] = 0;
+	while (stack_size > 0)
+	{
+		const s_node& node = nodes_[stack[--stack_size]];
+		if (!overlaps(node.bounds_min, node.bounds_max))
+		{
+			continue;
+		}
+
+		if (node.count > 0)
+		{
+			for (int i = 0; i < node.count; i++)
+			{
+				const int item = items_[node.left_first + i];
+				if (overlaps(bounds_[item].bounds_min, bounds_[item].bounds_max))
+				{
+					results.push_back(item);
+				}
+			}
+			continue;
+		}
+		stack[stack_size++] = node.left_first + 1;
+		stack[stack_size++] = node.left_first;
+	}
+	return static_cast<int>(results.size());
+}
+
+// == Private Methods ==
+void c_bvh::subdivide(int node_index, int depth)
+{
+	// Small enough, or deep enough that another level could overflow the traversal stacks.
+	const int first = nodes_[node_index].left_first;
+	const int count = nodes_[node_index].count;
+	if (count <= max_leaf_items || depth >= max_depth - 1)
+	{
+		return;
+	}
+
+	// Bin on the centroids, not the bounds, so big items can't stretch the bins.
+	glm::vec3 centroid_min(FLT_MAX);
+	glm::vec3 centroid_max(-FLT_MAX);
+	for (int i = 0; i < count; i++)
+	{
+		const glm::vec3& centroid = bounds_[items_[first + i]].centroid;
+		centroid_min = glm::min(centroid_min, centroid);
+		centroid_max = glm::max(centroid_max, centroid);
+	}
+
+	// Find the cheapest split over every axis and bin boundary.
+	float best_cost = FLT_MAX;
+	int best_axis = -1;
+	int best_split = 0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		const float extent = centroid_max[axis] - centroid_min[axis];
+		if (extent <= 0.0f)
+		{
+			continue;
+		}
+
+		// Fill the bins.
+		int bin_items[bin_count] = {};
+		glm::vec3 bin_min[bin_count];
+		glm::vec3 bin_max[bin_count];
+		std::fill(bin_min, bin_min + bin_count, glm::vec3(FLT_MAX));
+		std::fill(bin_max, bin_max + bin_count, glm::vec3(-FLT_MAX));
+		const float scale = bin_count / extent;
+		for (int i = 0; i < count; i++)
+		{
+			const s_build_item& item = bounds_[items_[first + i]];
+			const int bin = std::min(bin_count - 1, static_cast<int>((item.centroid[axis] - centroid_min[axis]) * scale));
+			bin_items[bin]++;
+			bin_min[bin] = glm::min(bin_min[bin], item.bounds_min);
+			bin_max[bin] = glm::max(bin_max[bin], item.bounds_max);
+		}
+
+		// Sweep from both sides to get the area and count left and right of each boundary.
+		float left_area[bin_count - 1];
+		int left_count[bin_count - 1];
+		glm::vec3 sweep_min(FLT_MAX);
+		glm::vec3 sweep_max(-FLT_MAX);
+		int sweep_count = 0;
+		for (int b = 0; b < bin_count - 1; b++)
+		{
+			sweep_count += bin_items[b];
+			sweep_min = glm::min(sweep_min, bin_min[b]);
+			sweep_max = glm::max(sweep_max, bin_max[b]);
+			left_count[b] = sweep_count;
+			left_area[b] = half_area(sweep_min, sweep_max);
+		}
+		sweep_min = glm::vec3(FLT_MAX);
+		sweep_max = glm::vec3(-FLT_MAX);
+		sweep_count = 0;
+		for (int b = bin_count - 1; b > 0; b--)
+		{
+			sweep_count += bin_items[b];
+			sweep_min = glm::min(sweep_min, bin_min[b]);
+			sweep_max = glm::max(sweep_max, bin_max[b]);
+			const float cost = left_count[b - 1] * left_area[b - 1] + sweep_count * half_area(sweep_min, sweep_max);
+			if (left_count[b - 1] > 0 && sweep_count > 0 && cost < best_cost)
+			{
+				best_cost = cost;
+				best_axis = axis;
+				best_split = b;
+			}
+		}
+	}
+
+	// Keep the leaf if no split is cheaper than testing every item.
+	const float leaf_cost = count * half_area(nodes_[node_index].bounds_min, nodes_[node_index].bounds_max);
+	if (best_axis < 0 || best_cost >= leaf_cost)
+	{
+		return;
+	}
+
+	// Partition the items around the split.
+	const float scale = bin_count / (centroid_max[best_axis] - centroid_min[best_axis]);
+	int* middle = std::partition(&items_[first], &items_[first] + count, [&](int item)
+	{
+		const int bin = std::min(bin_count - 1, static_cast<int>((bounds_[item].centroid[best_axis] - centroid_min[best_axis]) * scale));
+		return bin < best_split;
+	});
+	const int left_items = static_cast<int>(middle - &items_[first]);
+
+	// Create the children, the node becomes internal.
+	const int left_index = static_cast<int>(nodes_.size());
+	nodes_.push_back({ glm::vec3(0.0f), first, glm::vec3(0.0f), left_items, node_index });
+	nodes_.push_back({ glm::vec3(0.0f), first + left_items, glm::vec3(0.0f), count - left_items, node_index });
+	nodes_[node_index].left_first = left_index;
+	nodes_[node_index].count = 0;
+	fit_leaf(nodes_[left_index]);
+	fit_leaf(nodes_[left_index + 1]);
+	subdivide(left_index, depth + 1);
+	subdivide(left_index + 1, depth + 1);
+}
+
+void c_bvh::fit_leaf(s_node& node) const
+{
+	node.bounds_min = glm::vec3(FLT_MAX);
+	node.bounds_max = glm::vec3(-FLT_MAX);
+	for (int i = 0; i < node.count; i++)
+	{
+		const s_build_item& item = bounds_[items_[node.left_first + i]];
+		node.bounds_min = glm::min(node.bounds_min, item.bounds_min);
+		node.bounds_max = glm::max(node.bounds_max, item.bounds_max);
+	}
+}
+
+void c_bvh::fit_internal(int node_index)
+{
+	s_node& node = nodes_[node_index];
+	const s_node& left = nodes_[node.left_first];
+	const s_node& right = nodes_[node.left_first + 1];
+	node.bounds_min = glm::min(left.bounds_min, right.bounds_min);
+	node.bounds_max = glm::max(left.bounds_max, right.bounds_max);
+}
+
+c_bvh::s_build_item c_bvh::get_item_bounds(const c_transform_store& transforms, int handle)
+{
+	const glm::vec3 center(transforms.get_centers_x()[handle], transforms.get_centers_y()[handle], transforms.get_centers_z()[handle]);
+	const glm::vec3 extents(transforms.get_extents_x()[handle], transforms.get_extents_y()[handle], transforms.get_extents_z()[handle]);
+	return { center - extents, center + extents, center };
+}
@@ -0,0 +1,145 @@
+﻿// /***********************************************************************
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+// (c) 2024 Media Design School
+// File Name : c_bvh.h
+// Description : Class that builds a bounding volume hierarchy over the transform store for scene queries.
+// Author : Foster Rae
+// Mail : Foster.Rae@mds.ac.nz
+// ************************************************************************/
+#pragma once
+#include <vector>
+#include "Dependencies/GLM/glm.hpp"
+#include "c_transform_store.h"
+#include "c_frustum.h"
+
+/**
+ * @class c_bvh
+ * @brief A binary AABB tree over the bounds in a c_transform_store, built with the binned surface area heuristic.
+ * @note Items are transform handles. After a transform moves call refit for that handle, the tree shape is kept
+ *       so the quality slowly drops if objects move far, call build again when that matters.
+ */
+class c_bvh
+{
+public:
+
+	// == Public Methods ==
+	/**
+	 * @brief Builds the tree over every transform in the store.
+	 * @param transforms The transform store to read the bounds from.
+	 */
+	void build(const c_transform_store& transforms);
+	/**
+	 * @brief Refits every node bottom up after many transforms have changed.
+	 * @param transforms The transform store the tree was built from.
+	 */
+	void refit(const c_transform_store& transforms);
+	/**
+	 * @brief Refits the leaf holding a transform and its parents after it has moved.
+	 * @param transforms The transform store the tree was built from.
+	 * @param handle The transform that moved.
+	 */
+	void refit(const c_transform_store& transforms, int handle);
+	/**
+	 * @brief Finds every item whose bounds are at least partly inside a frustum.
+	 * @note Nodes fully inside the frustum add their items without testing them.
+	 *
+	 * @param frustum The frustum to test against.
+	 * @param results Cleared and filled with the handles, in tree order.
+	 * @return The number of items found.
+	 */
+	int query_frustum(const c_frustum& frustum, std::vector<int>& results) const;
+	/**
+	 * @brief Finds the closest item whose bounds a ray hits.
+	 *
+	 * @param origin The start of the ray.
+	 * @param direction The direction of the ray, doesn't need to be normalised.
+	 * @param max_distance The furthest hit to accept, in multiples of direction.
+	 * @param hit_distance Set to the distance of the hit if there is one. Can be nullptr.
+	 * @return The handle of the closest item hit, or -1 if nothing was hit.
+	 */
+	int ray_cast(const glm::vec3& origin, const glm::vec3& direction, float max_distance, float* hit_distance = nullptr) const;
+	/**
+	 * @brief Finds every item whose bounds overlap a box.
+	 *
+	 * @param box_min The minimum corner of the box.
+	 * @param box_max The maximum corner of the box.
+	 * @param results Cleared and filled with the handles.
+	 * @return The number of items found.
+	 */
+	int query_overlap(const glm::vec3& box_min, const glm::vec3& box_max, std::vector<int>& results) const;
+
+	// == Accessors ==
+	size_t get_node_count() const { return nodes_.size(); }
+
+private:
+
+	/**
+	 * @brief A node of the tree.
+	 * @param bounds_min The minimum corner of the node's bounds.
+	 * @param left_first The index of the left child (right is left_first + 1), or the first item for leaves.
+	 * @param bounds_max The maximum corner of the node's bounds.
+	 * @param count The number of items for leaves, 0 for internal nodes.
+	 * @param parent The index of the parent node, -1 for the root.
+	 *
+	 * @note Children are always stored after their parent, so walking the nodes backwards visits children first.
+	 */
+	struct s_node {
+		glm::vec3 bounds_min;
+		int left_first;
+		glm::vec3 bounds_max;
+		int count;
+		int parent;
+	};
+
+	/**
+	 * @brief An item's bounds while building.
+	 * @param bounds_min The minimum corner.
+	 * @param bounds_max The maximum corner.
+	 * @param centroid The centre of the bounds, used for binning.
+	 */
+	struct s_build_item {
+		glm::vec3 bounds_min;
+		glm::vec3 bounds_max;
+		glm::vec3 centroid;
+	};
+
+	// == Private Methods ==
+	/**
+	 * @brief Splits a node with the binned SAH, recursing until splitting no longer lowers the cost.
+	 * @param node_index The node to split.
+	 * @param depth The depth of the node, splitting stops before the traversal stack would overflow.
+	 */
+	void subdivide(int node_index, int depth);
+	/**
+	 * @brief Sets a node's bounds to cover its items.
+	 * @param node The node, must be a leaf.
+	 */
+	void fit_leaf(s_node& node) const;
+	/**
+	 * @brief Sets an internal node's bounds to cover its children.
+	 * @param node_index The node.
+	 */
+	void fit_internal(int node_index);
+	/**
+	 * @brief Gets the world-space bounds of an item from the store.
+	 *
+	 * @param transforms The transform store.
+	 * @param handle The transform.
+	 * @return The bounds and centroid.
+	 */
+	static s_build_item get_item_bounds(const c_transform_store& transforms, int handle);
+
+	// == Constants ==
+	static constexpr int bin_count = 12;     // Candidate split positions per axis.
+	static constexpr int max_leaf_items = 4; // Leaves are never split below this.
+	static constexpr int max_depth = 64;     // Traversal stack size.
+
+	// == Private Members ==
+	std::vector<s_node> nodes_;
+	std::vector<int> items_;                // Handles, each leaf owns a contiguous range.
+	std::vector<s_build_item> bounds_;      // Bounds of each handle, indexed by handle.
+	std::vector<int> item_leaf_;            // Leaf node holding each handle, for single item refits.
+};
@@ -13,6 +13,7 @@
 #include "c_camera.h"
 #include "Dependencies/GLM/glm.hpp"
 #include "c_mesh.h"
+#include "c_transform_store.h"
 
 class c_cube {
 public:
@@ -20,12 +21,20 @@ public:
 	// == Constructors and Destructors ==
 	/**
 	 * @brief Construct a new c_cube object.
+	 * @param transforms The transform store that holds the cube's position, rotation and scale.
 	 * @param textures A vector of textures to apply to the cube.
 	 * @param pos The position of the cube in the world relative to the origin.
 	 * @param rot The rotation of the cube in degrees.
 	 * @param scl The scale of the cube.
 	 */
-	c_cube(const std::vector<s_texture>& textures, glm::vec3 pos, float rot, glm::vec3 scl);
+	c_cube(c_transform_store& transforms, const std::vector<s_texture>& textures, glm::vec3 pos, float rot, glm::vec3 scl);
+	/**
+	 * @brief Construct a c_cube object around a transform already in the store, e.g. one bulk loaded from a c_scene.
+	 * @param transforms The transform store that holds the cube's position, rotation and scale.
+	 * @param textures A vector of textures to apply to the cube.
+	 * @param transform_handle The cube's transform in the store.
+	 */
+	c_cube(c_transform_store& transforms, const std::vector<s_texture>& textures, int transform_handle);
 
 	// == Public Methods ==
 	/**
@@ -34,11 +43,6 @@ public:
 	 *  @param active_texture_index The index of the texture to use.
 	 */
 	void draw(GLuint shader_program, int active_texture_index);
-	/**
-	 * @brief Updates the model matrix of the cube ready to be sent to the shader.
-	 * @note Call in the main update loop.
-	 */
-	void update_model_matrix();
 	/**
 	 * @brief Moves the cube in the direction relative to the camera.
 	 * @param camera The camera object to get the direction from.
@@ -47,25 +51,35 @@ public:
 	void move(const c_camera& camera, const glm::vec3& direction);
 
 	// == Transformation Methods ==
-	void set_position(glm::vec3 pos) { position_ = pos; } 		    // Set the position of the cube.
-	void set_rotation(float rot) { rotation_ = rot; } 			    // Set the rotation of the cube.
-	void set_scale(glm::vec3 scl) { scale_ = scl; } 			    // Set the scale of the cube.
+	// The transform lives in the store, the setters mark it dirty so it is rebuilt on the store's next update.
+	void set_position(glm::vec3 pos) { transforms_->set_position(transform_handle_, pos); } // Set the position of the cube.
+	void set_rotation(float rot) { transforms_->set_rotation(transform_handle_, rot); }     // Set the rotation of the cube.
+	void set_scale(glm::vec3 scl) { transforms_->set_scale(transform_handle_, scl); }       // Set the scale of the cube.
 	void set_active_cube(bool active) { is_active_cube_ = active; } // Set the cube to be controlled by the user.
 	void set_speed(float speed) { speed_ = speed; }                 // Set the movement speed of the cube.
 
-	glm::vec3 get_position() const { return position_; }
-	float get_rotation() const { return rotation_; }
-	glm::vec3 get_scale() const { return scale_; }
+	glm::vec3 get_position() const { return transforms_->get_position(transform_handle_); }
+	float get_rotation() const { return transforms_->get_rotation(transform_handle_); }
+	glm::vec3 get_scale() const { return transforms_->get_scale(transform_handle_); }
 	bool get_active_cube() const { return is_active_cube_; }
 	std::vector<s_texture> get_textures() const { return mesh_.textures; }
+	glm::mat4 get_model_matrix() const { return transforms_->get_model_matrix(transform_handle_); }
+	int get_transform_handle() const { return transform_handle_; }
+	const c_transform_store& get_transforms() const { return *transforms_; }
+	const c_mesh& get_mesh() const { return mesh_; }
 
 private:
+	// == Private Methods ==
+	/**
+	 * @brief Gets the cube geometry from the geometry cache, uploading it on first use.
+	 * @return A shared handle to the cube geometry.
+	 */
+	static std::shared_ptr<c_geometry> get_shared_geometry();
+
 	// == Private Members ==
 	c_mesh mesh_; // The mesh of the cube. Holds the vertices, indices, and textures.
-	glm::vec3 position_;
-	float rotation_;
-	glm::vec3 scale_;
-	glm::mat4 model_matrix_ = glm::mat4(1.0f);
+	c_transform_store* transforms_; // The store holding the cube's transform.
+	int transform_handle_;          // The cube's transform in the store.
 	bool is_active_cube_ = false; // Flag to determine if the cube is the cube being controlled by the user.
 	float speed_ = 0.1f; 		  // The speed the cube moves at.
 };
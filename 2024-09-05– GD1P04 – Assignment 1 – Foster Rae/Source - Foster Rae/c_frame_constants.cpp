@@ -0,0 +1,60 @@
+﻿#include "c_frame_constants.h"
+#include <cstring>
+
+c_frame_constants::c_frame_constants(int pass_count)
+	: passes_(pass_count)
+{
+	// Each pass has to start on an offset the driver can bind, so pad the stride.
+	GLint alignment = 256; // Largest alignment in practice, used if the query fails.
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	pass_stride_ = ((sizeof(s_frame_constants) + alignment - 1) / alignment) * alignment;
+	staging_.resize(pass_stride_ * pass_count);
+
+	// Create the buffer, it is rewritten every frame.
+	glGenBuffers(1, &ubo_);
+	glBindBuffer(GL_UNIFORM_BUFFER, ubo_);
+	glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(staging_.size()), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+c_frame_constants::~c_frame_constants()
+{
+	glDeleteBuffers(1, &ubo_);
+}
+
+void c_frame_constants::set_pass(int pass, const glm::mat4& projection, const glm::mat4& view)
+{
+	s_frame_constants& constants = passes_[pass];
+	constants.projection = projection;
+	constants.view = view;
+	constants.view_projection = projection * view; // Done once here instead of per vertex.
+}
+
+void c_frame_constants::set_frame(float time, float delta_time, int width, int height)
+{
+	for (s_frame_constants& constants : passes_)
+	{
+		constants.time = time;
+		constants.delta_time = delta_time;
+		constants.resolution = glm::vec2(static_cast<float>(width), static_cast<float>(height));
+	}
+}
+
+void c_frame_constants::upload()
+{
+	// Pack the passes at their aligned offsets.
+	for (size_t i = 0; i < passes_.size(); i++)
+	{
+		std::memcpy(&staging_[i * pass_stride_], &passes_[i], sizeof(s_frame_constants));
+	}
+
+	// Upload every pass in one call.
+	glBindBuffer(GL_UNIFORM_BUFFER, ubo_);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, static_cast<GLsizeiptr>(staging_.size()), staging_.data());
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void c_frame_constants::bind_pass(int pass) const
+{
+	glBindBufferRange(GL_UNIFORM_BUFFER, binding_point, ubo_, pass * pass_stride_, sizeof(s_frame_constants));
+}
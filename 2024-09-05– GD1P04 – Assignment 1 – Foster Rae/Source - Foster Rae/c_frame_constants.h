@@ -0,0 +1,101 @@
+﻿// /***********************************************************************
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+// (c) 2024 Media Design School
+// File Name : c_frame_constants.h
+// Description : Class to handle the per-frame camera uniform buffer.
+// Author : Foster Rae
+// Mail : Foster.Rae@mds.ac.nz
+// ************************************************************************/
+#pragma once
+#include <vector>
+#include <glew.h>
+#include <glm.hpp>
+#include "c_camera.h"
+
+/**
+ * @brief The frame constants block as laid out in the shaders. (std140)
+ * @param projection The projection matrix.
+ * @param view The view matrix.
+ * @param view_projection The projection matrix multiplied by the view matrix.
+ * @param resolution The window size in pixels.
+ * @param time The time since the program started in seconds.
+ * @param delta_time The time between frames in seconds.
+ *
+ * @note Stored in memory as:\n
+ * [ projection (0), view (64), view_projection (128), resolution (192), time (200), delta_time (204) ]
+ */
+struct s_frame_constants {
+	glm::mat4 projection;
+	glm::mat4 view;
+	glm::mat4 view_projection;
+	glm::vec2 resolution;
+	float time;
+	float delta_time;
+};
+static_assert(sizeof(s_frame_constants) == 208, "s_frame_constants must match the std140 frame_constants block.");
+
+/**
+ * @class c_frame_constants
+ * @brief Uploads the camera matrices, time and resolution once per frame into a uniform buffer.
+ * @note Holds one block per render pass (e.g. world and UI) in one buffer, each pass binds its range.
+ */
+class c_frame_constants
+{
+public:
+
+	// == Constructors and Destructors ==
+	/**
+	 * @brief Construct a new c_frame_constants object.
+	 * @param pass_count The number of render passes that need their own camera.
+	 */
+	explicit c_frame_constants(int pass_count);
+	~c_frame_constants();
+	c_frame_constants(const c_frame_constants&) = delete;            // Owns GL objects, no copying.
+	c_frame_constants& operator=(const c_frame_constants&) = delete;
+
+	// == Public Methods ==
+	/**
+	 * @brief Sets the camera matrices for a pass.
+	 * @param pass The index of the pass.
+	 * @param projection The projection matrix.
+	 * @param view The view matrix.
+	 */
+	void set_pass(int pass, const glm::mat4& projection, const glm::mat4& view);
+	/**
+	 * @brief Sets the camera matrices for a pass from a camera.
+	 * @param pass The index of the pass.
+	 * @param camera The camera to get the view and projection matrices from.
+	 */
+	void set_pass(int pass, const c_camera& camera) { set_pass(pass, camera.get_projection_matrix(), camera.get_view_matrix()); }
+	/**
+	 * @brief Sets the time and resolution shared by every pass.
+	 * @param time The time since the program started in seconds.
+	 * @param delta_time The time between frames in seconds.
+	 * @param width The window width in pixels.
+	 * @param height The window height in pixels.
+	 */
+	void set_frame(float time, float delta_time, int width, int height);
+	/**
+	 * @brief Uploads every pass in one call. Call once per frame after setting the passes.
+	 */
+	void upload();
+	/**
+	 * @brief Binds a pass's block to the frame constants binding point.
+	 * @param pass The index of the pass.
+	 */
+	void bind_pass(int pass) const;
+
+	// == Constants ==
+	static constexpr GLuint binding_point = 0; // Must match the binding of the frame_constants block in the shaders.
+
+private:
+
+	// == Private Members ==
+	std::vector<s_frame_constants> passes_; // CPU copy of each pass.
+	std::vector<unsigned char> staging_;    // Passes padded to the offset alignment, ready to upload.
+	GLsizeiptr pass_stride_ = 0;            // Size of one pass rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT.
+	GLuint ubo_ = 0;                        // The uniform buffer.
+};
@@ -0,0 +1,123 @@
+﻿#include "c_frustum.h"
+#include <cmath>
+
+// Same check as c_transform_store, SSE is on every x86 and x64 target.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define FRUSTUM_SSE
+#include <xmmintrin.h>
+#endif
+
+// == Public Methods ==
+void c_frustum::extract(const glm::mat4& view_projection)
+{
+	// glm is column-major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i]).
+	const glm::mat4& m = view_projection;
+	const glm::vec4 row_0(m[0][0], m[1][0], m[2][0], m[3][0]);
+	const glm::vec4 row_1(m[0][1], m[1][1], m[2][1], m[3][1]);
+	const glm::vec4 row_2(m[0][2], m[1][2], m[2][2], m[3][2]);
+	const glm::vec4 row_3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+	planes_[0] = row_3 + row_0; // Left
+	planes_[1] = row_3 - row_0; // Right
+	planes_[2] = row_3 + row_1; // Bottom
+	planes_[3] = row_3 - row_1; // Top
+	planes_[4] = row_3 + row_2; // Near (OpenGL clip space z is -w to w)
+	planes_[5] = row_3 - row_2; // Far
+
+	// Normalise so the distances are in world units.
+	for (glm::vec4& plane : planes_)
+	{
+		plane /= glm::length(glm::vec3(plane));
+	}
+}
+
+bool c_frustum::is_box_visible(const glm::vec3& center, const glm::vec3& extents) const
+{
+	for (const glm::vec4& plane : planes_)
+	{
+		// Distance from the plane to the box centre, plus the box's projected radius onto the plane normal.
+		const float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+		const float radius = glm::dot(glm::abs(glm::vec3(plane)), extents);
+		if (distance + radius < 0.0f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int c_frustum::cull(const c_transform_store& transforms, std::vector<int>& visible) const
+{
+	visible.clear();
+	const size_t count = transforms.get_count();
+	const float* center_x = transforms.get_centers_x();
+	const float* center_y = transforms.get_centers_y();
+	const float* center_z = transforms.get_centers_z();
+	const float* extent_x = transforms.get_extents_x();
+	const float* extent_y = transforms.get_extents_y();
+	const float* extent_z = transforms.get_extents_z();
+
+	size_t i = 0;
+#ifdef FRUSTUM_SSE
+	// Broadcast each plane once, then test four boxes against it per instruction.
+	__m128 normal_x[plane_count], normal_y[plane_count], normal_z[plane_count], distance[plane_count];
+	__m128 abs_x[plane_count], abs_y[plane_count], abs_z[plane_count];
+	for (int p = 0; p < plane_count; p++)
+	{
+		normal_x[p] = _mm_set1_ps(planes_[p].x);
+		normal_y[p] = _mm_set1_ps(planes_[p].y);
+		normal_z[p] = _mm_set1_ps(planes_[p].z);
+		distance[p] = _mm_set1_ps(planes_[p].w);
+		abs_x[p] = _mm_set1_ps(std::abs(planes_[p].x));
+		abs_y[p] = _mm_set1_ps(std::abs(planes_[p].y));
+		abs_z[p] = _mm_set1_ps(std::abs(planes_[p].z));
+	}
+	const __m128 zero = _mm_setzero_ps();
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 cx = _mm_loadu_ps(center_x + i);
+		const __m128 cy = _mm_loadu_ps(center_y + i);
+		const __m128 cz = _mm_loadu_ps(center_z + i);
+		const __m128 ex = _mm_loadu_ps(extent_x + i);
+		const __m128 ey = _mm_loadu_ps(extent_y + i);
+		const __m128 ez = _mm_loadu_ps(extent_z + i);
+
+		// A box is outside if it is fully behind any plane.
+		__m128 outside = zero;
+		for (int p = 0; p < plane_count; p++)
+		{
+			__m128 d = _mm_add_ps(_mm_mul_ps(normal_x[p], cx), distance[p]);
+			d = _mm_add_ps(d, _mm_mul_ps(normal_y[p], cy));
+			d = _mm_add_ps(d, _mm_mul_ps(normal_z[p], cz));
+			d = _mm_add_ps(d, _mm_mul_ps(abs_x[p], ex));
+			d = _mm_add_ps(d, _mm_mul_ps(abs_y[p], ey));
+			d = _mm_add_ps(d, _mm_mul_ps(abs_z[p], ez));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(d, zero));
+		}
+
+		// One bit per box, push the ones that are in.
+		const int outside_mask = _mm_movemask_ps(outside);
+		if (outside_mask == 0xF)
+		{
+			continue;
+		}
+		for (int n = 0; n < 4; n++)
+		{
+			if ((outside_mask & (1 << n)) == 0)
+			{
+				visible.push_back(static_cast<int>(i) + n);
+			}
+		}
+	}
+#endif
+
+	// Remaining boxes one at a time.
+	for (; i < count; i++)
+	{
+		if (is_box_visible(glm::vec3(center_x[i], center_y[i], center_z[i]), glm::vec3(extent_x[i], extent_y[i], extent_z[i])))
+		{
+			visible.push_back(static_cast<int>(i));
+		}
+	}
+	return static_cast<int>(visible.size());
+}
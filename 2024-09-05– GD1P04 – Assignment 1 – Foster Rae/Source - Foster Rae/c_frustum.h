@@ -0,0 +1,67 @@
+﻿// /***********************************************************************
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+// (c) 2024 Media Design School
+// File Name : c_frustum.h
+// Description : Class that holds the camera frustum planes and culls bounding boxes against them.
+// Author : Foster Rae
+// Mail : Foster.Rae@mds.ac.nz
+// ************************************************************************/
+#pragma once
+#include <vector>
+#include "Dependencies/GLM/glm.hpp"
+#include "c_transform_store.h"
+
+/**
+ * @class c_frustum
+ * @brief The six planes of a view-projection frustum, used to skip objects that are off screen.
+ * @note Planes point inwards, a point is inside if dot(plane.xyz, point) + plane.w >= 0 for every plane.
+ */
+class c_frustum
+{
+public:
+
+	// == Constructors and Destructors ==
+	c_frustum() = default;
+	/**
+	 * @brief Construct a frustum from a view-projection matrix.
+	 * @param view_projection The camera's projection * view matrix.
+	 */
+	explicit c_frustum(const glm::mat4& view_projection) { extract(view_projection); }
+
+	// == Public Methods ==
+	/**
+	 * @brief Extracts and normalises the planes from a view-projection matrix. (Gribb-Hartmann)
+	 * @param view_projection The camera's projection * view matrix.
+	 */
+	void extract(const glm::mat4& view_projection);
+	/**
+	 * @brief Tests an axis-aligned bounding box against the frustum.
+	 *
+	 * @param center The centre of the box.
+	 * @param extents The half extents of the box.
+	 * @return False if the box is completely outside, true otherwise. (conservative)
+	 */
+	bool is_box_visible(const glm::vec3& center, const glm::vec3& extents) const;
+	/**
+	 * @brief Tests every bounding box in a transform store, four boxes at a time with SSE.
+	 *
+	 * @param transforms The transform store holding the boxes.
+	 * @param visible Cleared and filled with the handles of the boxes that are at least partly inside, in order.
+	 * @return The number of visible boxes.
+	 */
+	int cull(const c_transform_store& transforms, std::vector<int>& visible) const;
+
+	// == Accessors ==
+	const glm::vec4& get_plane(int index) const { return planes_[index]; }
+
+	// == Constants ==
+	static constexpr int plane_count = 6; // Left, right, bottom, top, near, far.
+
+private:
+
+	// == Private Members ==
+	glm::vec4 planes_[plane_count] = {}; // xyz = normal, w = distance.
+};
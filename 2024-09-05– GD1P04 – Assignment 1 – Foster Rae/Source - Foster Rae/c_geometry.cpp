@@ -0,0 +1,143 @@
+﻿#include "c_geometry.h"
+#include <algorithm>
+#include <cmath>
+#include <gtc/packing.hpp>
+#include "c_gl_state.h"
+
+c_geometry::c_geometry(const std::vector<s_vertex>& vertices, const std::vector<GLuint>& indices, bool packed)
+	: vertices_(vertices), indices_(indices), packed_(packed)
+{
+	// Upload the geometry.
+	setup_buffers();
+}
+
+c_geometry::~c_geometry()
+{
+	// Delete the GPU buffers.
+	c_gl_state::forget_vertex_array(vao_);
+	glDeleteVertexArrays(1, &vao_);
+	glDeleteBuffers(1, &vbo_);
+	glDeleteBuffers(1, &ebo_);
+}
+
+void c_geometry::setup_vertex_attributes() const
+{
+	// Bind the VBO and EBO to the current VAO.
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+
+	// Set the vertex attribute pointers.
+	if (packed_)
+	{
+		// Positions are normalized to -1 - 1 and scaled back in the shader, normals are normalized 10:10:10:2.
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, sizeof(s_packed_vertex), reinterpret_cast<void*>(offsetof(s_packed_vertex, position)));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(s_packed_vertex), reinterpret_cast<void*>(offsetof(s_packed_vertex, normal)));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(s_packed_vertex), reinterpret_cast<void*>(offsetof(s_packed_vertex, tex_coords)));
+		return;
+	}
+	// Vertex Positions.
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(s_vertex), static_cast<void*>(nullptr));
+	// Vertex Normals.
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(s_vertex), reinterpret_cast<void*>(offsetof(s_vertex, normal)));
+	// Vertex Texture Coords.
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(s_vertex), reinterpret_cast<void*>(offsetof(s_vertex, tex_coords)));
+}
+
+std::vector<s_packed_vertex> c_geometry::pack_vertices(const std::vector<s_vertex>& vertices, glm::vec3& position_scale, glm::vec3& position_offset)
+{
+	// The bounds map to -1 - 1 on each axis.
+	glm::vec3 bounds_min(0.0f), bounds_max(0.0f);
+	if (!vertices.empty())
+	{
+		bounds_min = bounds_max = vertices.front().position;
+	}
+	for (const s_vertex& vertex : vertices)
+	{
+		bounds_min = glm::min(bounds_min, vertex.position);
+		bounds_max = glm::max(bounds_max, vertex.position);
+	}
+	position_offset = (bounds_min + bounds_max) * 0.5f;
+	position_scale = (bounds_max - bounds_min) * 0.5f;
+	const glm::vec3 inverse_scale(position_scale.x > 0.0f ? 1.0f / position_scale.x : 0.0f, position_scale.y > 0.0f ? 1.0f / position_scale.y : 0.0f,
+		position_scale.z > 0.0f ? 1.0f / position_scale.z : 0.0f);
+
+	std::vector<s_packed_vertex> packed(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		const s_vertex& vertex = vertices[i];
+		const glm::vec3 position = glm::clamp((vertex.position - position_offset) * inverse_scale, -1.0f, 1.0f);
+		for (int axis = 0; axis < 3; axis++)
+		{
+			packed[i].position[axis] = static_cast<int16_t>(std::lround(position[axis] * 32767.0f));
+		}
+		packed[i].position[3] = 0;
+		packed[i].normal = glm::packSnorm3x10_1x2(glm::vec4(vertex.normal, 0.0f));
+		const uint32_t tex_coords = glm::packHalf2x16(vertex.tex_coords);
+		packed[i].tex_coords[0] = static_cast<uint16_t>(tex_coords & 0xFFFF);
+		packed[i].tex_coords[1] = static_cast<uint16_t>(tex_coords >> 16);
+	}
+	return packed;
+}
+
+s_vertex c_geometry::unpack_vertex(const s_packed_vertex& vertex, const glm::vec3& position_scale, const glm::vec3& position_offset)
+{
+	// Normalized shorts map -32768 and -32767 both to -1, as GL does.
+	s_vertex unpacked = {};
+	for (int axis = 0; axis < 3; axis++)
+	{
+		unpacked.position[axis] = std::max(static_cast<float>(vertex.position[axis]) / 32767.0f, -1.0f);
+	}
+	unpacked.position = unpacked.position * position_scale + position_offset;
+	unpacked.normal = glm::vec3(glm::unpackSnorm3x10_1x2(vertex.normal));
+	unpacked.tex_coords = glm::unpackHalf2x16(static_cast<uint32_t>(vertex.tex_coords[0]) | (static_cast<uint32_t>(vertex.tex_coords[1]) << 16));
+	return unpacked;
+}
+
+void c_geometry::setup_buffers()
+{
+	// Generate the buffers.
+	glGenVertexArrays(1, &vao_);
+	glGenBuffers(1, &vbo_);
+	glGenBuffers(1, &ebo_);
+
+	// Bind the VAO.
+	c_gl_state::bind_vertex_array(vao_);
+
+	// Upload the vertex and index data.
+	glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+	if (packed_)
+	{
+		const std::vector<s_packed_vertex> packed = pack_vertices(vertices_, position_scale_, position_offset_);
+		glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(s_packed_vertex), packed.data(), GL_STATIC_DRAW);
+	}
+	else
+	{
+		glBufferData(GL_ARRAY_BUFFER, vertices_.size() * sizeof(s_vertex), vertices_.data(), GL_STATIC_DRAW);
+	}
+
+	// Half the index bandwidth when every index fits in 16 bits.
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+	if (vertices_.size() <= max_short_index_vertices)
+	{
+		const std::vector<GLushort> short_indices(indices_.begin(), indices_.end());
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, short_indices.size() * sizeof(GLushort), short_indices.data(), GL_STATIC_DRAW);
+		index_type_ = GL_UNSIGNED_SHORT;
+	}
+	else
+	{
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices_.size() * sizeof(GLuint), indices_.data(), GL_STATIC_DRAW);
+		index_type_ = GL_UNSIGNED_INT;
+	}
+
+	// Set the vertex attribute pointers.
+	setup_vertex_attributes();
+
+	// Unbind the VAO so later buffer binds can't change it.
+	c_gl_state::bind_vertex_array(0);
+}
@@ -0,0 +1,96 @@
+﻿// /***********************************************************************
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+// (c) 2024 Media Design School
+// File Name : c_geometry.h
+// Description : Class that owns the GPU buffers for a set of vertices and indices.
+// Author : Foster Rae
+// Mail : Foster.Rae@mds.ac.nz
+// ************************************************************************/
+#pragma once
+#include <vector>
+#include <glew.h>
+#include <glm.hpp>
+#include "c_structs.h"
+
+/**
+ * @class c_geometry
+ * @brief Holds the vertex and index data of a mesh and its VAO, VBO and EBO.
+ * @note Shared between meshes through c_geometry_cache, so identical geometry is only uploaded once.
+ *       Packed geometry uploads s_packed_vertex instead of s_vertex, the shader rebuilds the positions from the
+ *       scale and offset c_mesh passes in. Indices are uploaded as 16 bits when every vertex fits.
+ */
+class c_geometry
+{
+public:
+
+	// == Constructors and Destructors ==
+	/**
+	 * @brief Construct a new c_geometry object and upload it to the GPU.
+	 * @param vertices The vertices of the geometry.
+	 * @param indices The indices of the geometry.
+	 * @param packed True to upload the vertices as s_packed_vertex, 16 bytes instead of 32.
+	 */
+	c_geometry(const std::vector<s_vertex>& vertices, const std::vector<GLuint>& indices, bool packed = false);
+	~c_geometry(); // Deletes the GPU buffers.
+	c_geometry(const c_geometry&) = delete;            // Owns GL objects, no copying.
+	c_geometry& operator=(const c_geometry&) = delete;
+
+	// == Public Methods ==
+	/**
+	 * @brief Attaches the VBO, EBO and vertex attributes to the currently bound VAO.
+	 * @note Lets other VAOs (e.g. instanced ones) share the buffers without re-uploading them.
+	 */
+	void setup_vertex_attributes() const;
+	/**
+	 * @brief Quantizes vertices to their bounds, the way packed geometry is uploaded.
+	 *
+	 * @param vertices The vertices to pack.
+	 * @param position_scale Set to half the bounds size.
+	 * @param position_offset Set to the bounds centre.
+	 * @return The packed vertices.
+	 */
+	static std::vector<s_packed_vertex> pack_vertices(const std::vector<s_vertex>& vertices, glm::vec3& position_scale, glm::vec3& position_offset);
+	/**
+	 * @brief Expands a packed vertex the way the vertex attributes and test.vert read it, to measure what packing loses.
+	 *
+	 * @param vertex The packed vertex.
+	 * @param position_scale The scale pack_vertices returned.
+	 * @param position_offset The offset pack_vertices returned.
+	 * @return The vertex as the shader sees it.
+	 */
+	static s_vertex unpack_vertex(const s_packed_vertex& vertex, const glm::vec3& position_scale, const glm::vec3& position_offset);
+
+	// == Accessors ==
+	GLuint get_vao() const { return vao_; }
+	GLsizei get_index_count() const { return static_cast<GLsizei>(indices_.size()); }
+	const std::vector<s_vertex>& get_vertices() const { return vertices_; }
+	const std::vector<GLuint>& get_indices() const { return indices_; }
+	GLenum get_index_type() const { return index_type_; } // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, pass to glDrawElements.
+	bool is_packed() const { return packed_; }
+	const glm::vec3& get_position_scale() const { return position_scale_; }   // Half the bounds size, 1 if not packed.
+	const glm::vec3& get_position_offset() const { return position_offset_; } // Bounds centre, 0 if not packed.
+
+	// == Constants ==
+	static constexpr size_t max_short_index_vertices = 65536; // Up to this many vertices use 16 bit indices.
+
+private:
+
+	// == Private Methods ==
+	/**
+	 * @brief Creates the buffers and uploads the vertex and index data.
+	 * @note This is called in the constructor.
+	 */
+	void setup_buffers();
+
+	// == Private Members ==
+	std::vector<s_vertex> vertices_;
+	std::vector<GLuint> indices_;
+	GLuint vao_ = 0, vbo_ = 0, ebo_ = 0;
+	GLenum index_type_ = GL_UNSIGNED_INT;
+	bool packed_;
+	glm::vec3 position_scale_ = glm::vec3(1.0f);
+	glm::vec3 position_offset_ = glm::vec3(0.0f);
+};
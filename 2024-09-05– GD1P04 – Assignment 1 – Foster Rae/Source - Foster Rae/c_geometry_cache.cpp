@@ -0,0 +1,56 @@
+﻿#include "c_geometry_cache.h"
+
+// == Static Members ==
+std::unordered_map<std::string, std::weak_ptr<c_geometry>> c_geometry_cache::entries_;
+
+// == Public Methods ==
+std::shared_ptr<c_geometry> c_geometry_cache::acquire(const std::string& key, const std::vector<s_vertex>& vertices, const std::vector<GLuint>& indices, bool packed)
+{
+	// Reuse the geometry if something is still holding it, in the same layout.
+	std::shared_ptr<c_geometry> geometry = find(key, packed);
+	if (geometry)
+	{
+		return geometry;
+	}
+
+	// Upload it and keep a weak reference so it is freed when the last user lets go.
+	geometry = std::make_shared<c_geometry>(vertices, indices, packed);
+	entries_[make_key(key, packed)] = geometry;
+	return geometry;
+}
+
+std::shared_ptr<c_geometry> c_geometry_cache::find(const std::string& key, bool packed)
+{
+	auto it = entries_.find(make_key(key, packed));
+	if (it == entries_.end())
+	{
+		return nullptr;
+	}
+
+	// Drop the entry if the geometry has been freed.
+	std::shared_ptr<c_geometry> geometry = it->second.lock();
+	if (!geometry)
+	{
+		entries_.erase(it);
+	}
+	return geometry;
+}
+
+size_t c_geometry_cache::get_live_count()
+{
+	size_t count = 0;
+	for (const auto& entry : entries_)
+	{
+		if (!entry.second.expired())
+		{
+			count++;
+		}
+	}
+	return count;
+}
+
+// == Private Methods ==
+std::string c_geometry_cache::make_key(const std::string& key, bool packed)
+{
+	return packed ? key + "#packed" : key;
+}
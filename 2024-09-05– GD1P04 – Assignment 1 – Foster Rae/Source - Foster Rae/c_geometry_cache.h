@@ -0,0 +1,72 @@
+﻿// /***********************************************************************
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+// (c) 2024 Media Design School
+// File Name : c_geometry_cache.h
+// Description : Registry of shared geometry so identical meshes are uploaded once.
+// Author : Foster Rae
+// Mail : Foster.Rae@mds.ac.nz
+// ************************************************************************/
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "c_geometry.h"
+
+/**
+ * @class c_geometry_cache
+ * @brief Hands out reference-counted handles to geometry keyed by mesh name and layout.
+ * @note The cache only holds weak references, the geometry is freed when the last handle goes away.
+ *       Packed and unpacked geometry of the same mesh are separate entries.
+ */
+class c_geometry_cache
+{
+public:
+
+	// == Public Methods ==
+	/**
+	 * @brief Gets the geometry for a key, uploading it if no one is using it yet.
+	 *
+	 * @param key The name of the mesh. (e.g. "cube")
+	 * @param vertices The vertices to upload if the geometry is not cached.
+	 * @param indices The indices to upload if the geometry is not cached.
+	 * @param packed True to upload the vertices packed if the geometry is not cached, see c_geometry.
+	 * @return A shared handle to the geometry.
+	 */
+	static std::shared_ptr<c_geometry> acquire(const std::string& key, const std::vector<s_vertex>& vertices, const std::vector<GLuint>& indices, bool packed = false);
+	/**
+	 * @brief Gets the geometry for a key if it is still alive.
+	 *
+	 * @param key The name of the mesh.
+	 * @param packed True to find the packed geometry.
+	 * @return A shared handle to the geometry, or nullptr if it is not cached.
+	 */
+	static std::shared_ptr<c_geometry> find(const std::string& key, bool packed = false);
+	/**
+	 * @brief Gets the number of geometries currently alive in the cache.
+	 *
+	 * @return The number of live geometries.
+	 */
+	static size_t get_live_count();
+
+private:
+
+	// == Constructors / Destructors ==
+	c_geometry_cache() = default;  // Static class.
+	~c_geometry_cache() = default;
+
+	// == Private Methods ==
+	/**
+	 * @brief Builds the entry key for a mesh name and layout.
+	 *
+	 * @param key The name of the mesh.
+	 * @param packed True for the packed layout.
+	 * @return The name, with "#packed" after it for the packed layout.
+	 */
+	static std::string make_key(const std::string& key, bool packed);
+
+	// == Private Members ==
+	static std::unordered_map<std::string, std::weak_ptr<c_geometry>> entries_; // Key and layout -> geometry.
+};
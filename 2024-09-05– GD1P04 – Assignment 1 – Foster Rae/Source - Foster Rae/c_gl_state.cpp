@@ -0,0 +1,216 @@
+﻿#include "c_gl_state.h"
+
+// == Static Members ==
+GLuint c_gl_state::program_ = unknown;
+GLuint c_gl_state::vao_ = unknown;
+GLuint c_gl_state::active_texture_unit_ = unknown;
+GLuint c_gl_state::textures_[max_texture_units][texture_target_count];
+GLuint c_gl_state::blend_enabled_ = unknown;
+GLuint c_gl_state::depth_test_enabled_ = unknown;
+GLuint c_gl_state::cull_face_enabled_ = unknown;
+GLuint c_gl_state::blend_source_ = unknown;
+GLuint c_gl_state::blend_destination_ = unknown;
+GLuint c_gl_state::depth_func_ = unknown;
+GLuint c_gl_state::cull_face_ = unknown;
+GLuint c_gl_state::front_face_ = unknown;
+GLuint c_gl_state::polygon_mode_ = unknown;
+int c_gl_state::issued_ = 0;
+int c_gl_state::elided_ = 0;
+int c_gl_state::last_frame_issued_ = 0;
+int c_gl_state::last_frame_elided_ = 0;
+
+// == Public Methods ==
+void c_gl_state::use_program(GLuint program)
+{
+	if (changed(program_, program))
+	{
+		glUseProgram(program);
+	}
+}
+
+void c_gl_state::bind_vertex_array(GLuint vao)
+{
+	if (changed(vao_, vao))
+	{
+		glBindVertexArray(vao);
+	}
+}
+
+void c_gl_state::bind_texture(GLuint unit, GLenum target, GLuint texture)
+{
+	// Targets or units that aren't shadowed are always issued.
+	const int slot = get_target_slot(target);
+	if (slot < 0 || unit >= max_texture_units)
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(target, texture);
+		active_texture_unit_ = unit;
+		issued_ += 2;
+		return;
+	}
+
+	// Only switch the active unit if there is something to bind on it.
+	if (textures_[unit][slot] == texture)
+	{
+		elided_++;
+		return;
+	}
+	if (changed(active_texture_unit_, unit))
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+	}
+	textures_[unit][slot] = texture;
+	glBindTexture(target, texture);
+	issued_++;
+}
+
+void c_gl_state::bind_texture_for_update(GLenum target, GLuint texture)
+{
+	// The unit always has to be active, whether or not the texture is already bound on it.
+	if (changed(active_texture_unit_, update_texture_unit))
+	{
+		glActiveTexture(GL_TEXTURE0 + update_texture_unit);
+	}
+	const int slot = get_target_slot(target);
+	if (slot >= 0)
+	{
+		if (textures_[update_texture_unit][slot] == texture)
+		{
+			elided_++;
+			return;
+		}
+		textures_[update_texture_unit][slot] = texture;
+	}
+	glBindTexture(target, texture);
+	issued_++;
+}
+
+void c_gl_state::set_capability(GLenum capability, bool enabled)
+{
+	// Get the shadow for the capability.
+	GLuint* current = nullptr;
+	switch (capability)
+	{
+	case GL_BLEND: current = &blend_enabled_; break;
+	case GL_DEPTH_TEST: current = &depth_test_enabled_; break;
+	case GL_CULL_FACE: current = &cull_face_enabled_; break;
+	default: break;
+	}
+
+	// Unshadowed capabilities are always issued.
+	if (current == nullptr)
+	{
+		issued_++;
+	}
+	else if (!changed(*current, enabled ? GL_TRUE : GL_FALSE))
+	{
+		return;
+	}
+	(enabled) ? glEnable(capability) : glDisable(capability);
+}
+
+void c_gl_state::set_blend_func(GLenum source, GLenum destination)
+{
+	// Both factors are one call, so count it once.
+	if (blend_source_ == source && blend_destination_ == destination)
+	{
+		elided_++;
+		return;
+	}
+	blend_source_ = source;
+	blend_destination_ = destination;
+	glBlendFunc(source, destination);
+	issued_++;
+}
+
+void c_gl_state::set_depth_func(GLenum func)
+{
+	if (changed(depth_func_, func))
+	{
+		glDepthFunc(func);
+	}
+}
+
+void c_gl_state::set_cull_face(GLenum face)
+{
+	if (changed(cull_face_, face))
+	{
+		glCullFace(face);
+	}
+}
+
+void c_gl_state::set_front_face(GLenum mode)
+{
+	if (changed(front_face_, mode))
+	{
+		glFrontFace(mode);
+	}
+}
+
+void c_gl_state::set_polygon_mode(GLenum mode)
+{
+	if (changed(polygon_mode_, mode))
+	{
+		glPolygonMode(GL_FRONT_AND_BACK, mode);
+	}
+}
+
+void c_gl_state::invalidate()
+{
+	program_ = vao_ = active_texture_unit_ = unknown;
+	for (auto& unit : textures_)
+	{
+		for (GLuint& texture : unit)
+		{
+			texture = unknown;
+		}
+	}
+	blend_enabled_ = depth_test_enabled_ = cull_face_enabled_ = unknown;
+	blend_source_ = blend_destination_ = unknown;
+	depth_func_ = cull_face_ = front_face_ = polygon_mode_ = unknown;
+}
+
+void c_gl_state::forget_texture(GLuint texture)
+{
+	for (auto& unit : textures_)
+	{
+		for (GLuint& bound : unit)
+		{
+			if (bound == texture)
+			{
+				bound = unknown;
+			}
+		}
+	}
+}
+
+void c_gl_state::begin_frame()
+{
+	last_frame_issued_ = issued_;
+	last_frame_elided_ = elided_;
+	issued_ = 0;
+	elided_ = 0;
+}
+
+// == Private Methods ==
+bool c_gl_state::changed(GLuint& current, GLuint value)
+{
+	if (current == value)
+	{
+		elided_++;
+		return false;
+	}
+	current = value;
+	issued_++;
+	return true;
+}
+
+int c_gl_state::get_target_slot(GLenum target)
+{
+	switch (target)
+	{
+	case GL_TEXTURE_2D: return 0;
+	case GL_TEXTURE_2D_ARRAY: return 1;
+	default: return -1;
+	}
+}
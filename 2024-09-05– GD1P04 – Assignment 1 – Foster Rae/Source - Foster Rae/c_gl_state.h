@@ -0,0 +1,120 @@
+﻿// /***********************************************************************
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+// (c) 2024 Media Design School
+// File Name : c_gl_state.h
+// Description : Class with static methods that filter out redundant OpenGL state changes.
+// Author : Foster Rae
+// Mail : Foster.Rae@mds.ac.nz
+// ************************************************************************/
+#pragma once
+#include <glew.h>
+
+/**
+ * @class c_gl_state
+ * @brief Shadows the OpenGL state and only issues calls that actually change it.
+ * @note Every bind or state change in the pipeline must go through here, otherwise the shadow copy goes stale.
+ *       Call invalidate() after code that changes state behind its back.
+ */
+class c_gl_state
+{
+public:
+
+	// == Public Methods ==
+	/**
+	 * @brief Uses a shader program.
+	 * @param program The shader program to use.
+	 */
+	static void use_program(GLuint program);
+	/**
+	 * @brief Binds a vertex array object.
+	 * @param vao The VAO to bind.
+	 */
+	static void bind_vertex_array(GLuint vao);
+	/**
+	 * @brief Binds a texture to a texture unit, only switching the active unit if it needs to bind.
+	 * @param unit The texture unit index. (0 for GL_TEXTURE0)
+	 * @param target The texture target. (GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, etc.)
+	 * @param texture The texture to bind.
+	 */
+	static void bind_texture(GLuint unit, GLenum target, GLuint texture);
+	/**
+	 * @brief Binds a texture to edit it, making the update unit active even if the texture is already bound there.
+	 * @note Use before glTex* and glGenerateMipmap calls, they act on the active unit. bind_texture can leave another
+	 *       unit active when the texture is already bound, so the edit would hit that unit's texture.
+	 * @param target The texture target. (GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, etc.)
+	 * @param texture The texture to edit.
+	 */
+	static void bind_texture_for_update(GLenum target, GLuint texture);
+	/**
+	 * @brief Enables or disables a capability. (GL_BLEND, GL_DEPTH_TEST or GL_CULL_FACE)
+	 * @param capability The capability to change.
+	 * @param enabled True to enable, false to disable.
+	 */
+	static void set_capability(GLenum capability, bool enabled);
+	static void set_blend_func(GLenum source, GLenum destination); // Filtered glBlendFunc.
+	static void set_depth_func(GLenum func);                       // Filtered glDepthFunc.
+	static void set_cull_face(GLenum face);                        // Filtered glCullFace.
+	static void set_front_face(GLenum mode);                       // Filtered glFrontFace.
+	static void set_polygon_mode(GLenum mode);                     // Filtered glPolygonMode for GL_FRONT_AND_BACK.
+	/**
+	 * @brief Forgets the shadowed state so the next call of each kind is issued.
+	 */
+	static void invalidate();
+	// Call before deleting a GL object, deleting a bound object rebinds 0 and the name can be reused.
+	static void forget_program(GLuint program) { if (program_ == program) program_ = unknown; }
+	static void forget_vertex_array(GLuint vao) { if (vao_ == vao) vao_ = unknown; }
+	static void forget_texture(GLuint texture);
+	/**
+	 * @brief Stores the counts of the finished frame and resets them. Call at the start of each frame.
+	 */
+	static void begin_frame();
+
+	// == Accessors ==
+	static int get_issued_count() { return last_frame_issued_; } // Calls sent to the driver last frame.
+	static int get_elided_count() { return last_frame_elided_; } // Redundant calls dropped last frame.
+
+private:
+
+	// == Constructors / Destructors ==
+	c_gl_state() = default;  // Static class.
+	~c_gl_state() = default;
+
+	// == Private Methods ==
+	/**
+	 * @brief Compares a shadowed value with a new one, updating it and counting the result.
+	 * @param current The shadowed value.
+	 * @param value The new value.
+	 * @return True if the value changed and the call must be issued.
+	 */
+	static bool changed(GLuint& current, GLuint value);
+	/**
+	 * @brief Gets the shadow slot index for a texture target.
+	 * @param target The texture target.
+	 * @return The slot index, or -1 if the target is not shadowed.
+	 */
+	static int get_target_slot(GLenum target);
+
+	// == Constants ==
+	static constexpr GLuint unknown = 0xFFFFFFFFu; // Shadow value for state that has not been set yet.
+	static constexpr GLuint max_texture_units = 32;
+	static constexpr GLuint update_texture_unit = 0; // Unit textures are bound to for editing.
+	static constexpr int texture_target_count = 2;  // GL_TEXTURE_2D and GL_TEXTURE_2D_ARRAY.
+
+	// == Private Members ==
+	static GLuint program_;
+	static GLuint vao_;
+	static GLuint active_texture_unit_;
+	static GLuint textures_[max_texture_units][texture_target_count]; // Starts as 0, the GL default binding.
+	static GLuint blend_enabled_, depth_test_enabled_, cull_face_enabled_;
+	static GLuint blend_source_, blend_destination_;
+	static GLuint depth_func_;
+	static GLuint cull_face_;
+	static GLuint front_face_;
+	static GLuint polygon_mode_;
+	// Call counts.
+	static int issued_, elided_;
+	static int last_frame_issued_, last_frame_elided_;
+};
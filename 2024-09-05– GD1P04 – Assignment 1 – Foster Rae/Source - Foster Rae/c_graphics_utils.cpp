@@ -1,5 +1,9 @@
 ﻿#include "c_graphics_utils.h"
 #include <stb_image.h>
+#include "c_asset_pack.h"
+#include "c_gl_state.h"
+#include "c_mapped_file.h"
+#include "c_texture_cooker.h"
 
 // == Public Methods ==
 void c_graphics_utils::initialize_glfw()
@@ -48,7 +52,7 @@ GLuint c_graphics_utils::load_image(const char* file_path)
 {
 	// Get the data, and variables for the image.
 	int width, height, components;
-	unsigned char* image_data = stbi_load(file_path, &width, &height, &components, 0);
+	unsigned char* image_data = decode_image(file_path, width, height, components, 0);
 
 	// Checks.
 	if (image_data == nullptr)
@@ -64,7 +68,7 @@ GLuint c_graphics_utils::load_image(const char* file_path)
 	GLuint texture;
 	// Generate texture object and bind to GLuint .
 	glGenTextures(1, &texture);
-	glBindTexture(GL_TEXTURE_2D, texture);
+	c_gl_state::bind_texture_for_update(GL_TEXTURE_2D, texture);
 	// set the texture wrapping parameters.
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	// set texture wrapping to GL_REPEAT (default wrapping method)
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -81,4 +85,77 @@ GLuint c_graphics_utils::load_image(const char* file_path)
 
 	stbi_image_free(image_data); // Free the image data.
 	return texture;				 // Return the texture.
-}
\ No newline at end of file
+}
+
+GLuint c_graphics_utils::load_cooked_image(const char* file_path)
+{
+	// Upload straight out of the asset pack if it has the texture, otherwise map the loose file.
+	const std::span<const unsigned char> packed = c_asset_pack::find_mounted(file_path);
+	if (!packed.empty())
+	{
+		return upload_cooked_image(packed.data(), packed.size(), file_path);
+	}
+	c_mapped_file file;
+	if (!file.open(file_path))
+	{
+		return 0;
+	}
+	return upload_cooked_image(file.get_data(), file.get_size(), file_path);
+}
+
+unsigned char* c_graphics_utils::decode_image(const char* file_path, int& width, int& height, int& components, int desired_components)
+{
+	const std::span<const unsigned char> packed = c_asset_pack::find_mounted(file_path);
+	if (!packed.empty())
+	{
+		return stbi_load_from_memory(packed.data(), static_cast<int>(packed.size()), &width, &height, &components, desired_components);
+	}
+	return stbi_load(file_path, &width, &height, &components, desired_components);
+}
+
+bool c_graphics_utils::read_image_info(const char* file_path, int& width, int& height, int& components)
+{
+	const std::span<const unsigned char> packed = c_asset_pack::find_mounted(file_path);
+	if (!packed.empty())
+	{
+		return stbi_info_from_memory(packed.data(), static_cast<int>(packed.size()), &width, &height, &components) != 0;
+	}
+	return stbi_info(file_path, &width, &height, &components) != 0;
+}
+
+// == Private Methods ==
+GLuint c_graphics_utils::upload_cooked_image(const unsigned char* data, size_t size, const char* file_path)
+{
+	// Checks.
+	const s_cooked_texture_header* header = c_texture_cooker::read_header(data, size, file_path);
+	if (header == nullptr)
+	{
+		return 0;
+	}
+	const s_cooked_mip* mips = reinterpret_cast<const s_cooked_mip*>(header + 1);
+
+	GLuint texture;
+	glGenTextures(1, &texture);
+	c_gl_state::bind_texture_for_update(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// Upload every level straight from the mapping, the pages are read in as the driver copies them.
+	glTexStorage2D(GL_TEXTURE_2D, static_cast<GLsizei>(header->mip_count), header->internal_format, static_cast<GLsizei>(header->width), static_cast<GLsizei>(header->height));
+	for (uint32_t level = 0; level < header->mip_count; level++)
+	{
+		const s_cooked_mip& mip = mips[level];
+		if (header->format == 0)
+		{
+			// Block compressed, the blocks go to the GPU as they are.
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), 0, 0, static_cast<GLsizei>(mip.width), static_cast<GLsizei>(mip.height), header->internal_format, static_cast<GLsizei>(mip.size), data + mip.offset);
+		}
+		else
+		{
+			glTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), 0, 0, static_cast<GLsizei>(mip.width), static_cast<GLsizei>(mip.height), header->format, header->type, data + mip.offset);
+		}
+	}
+	return texture;
+}
@@ -46,9 +46,53 @@ public:
 	// == Image Loading ==
 	/**
 	 * @brief Loads an image from the file path provided.
+	 * @note The caller owns the texture and must delete it. Use c_texture_cache::load for textures that are shared.
 	 *
 	 * @param file_path The file path to the image.
 	 * @return The ID of the loaded image.
 	 */
 	static GLuint load_image(const char* file_path);
+	/**
+	 * @brief Loads a texture cooked by c_texture_cooker, uploading every level straight from the mapped file.
+	 * @note Nothing is decoded and no mipmaps are generated, the file already holds them.
+	 *
+	 * @param file_path The file path to the .ctex file.
+	 * @return The ID of the loaded texture, or 0 if the file is missing or invalid.
+	 */
+	static GLuint load_cooked_image(const char* file_path);
+	/**
+	 * @brief Decodes an image with stb_image, from the mounted asset pack if it has the file, otherwise from disk.
+	 * @note Free the pixels with stbi_image_free. Safe to call from worker threads.
+	 *
+	 * @param file_path The file path to the image.
+	 * @param width Set to the width of the image.
+	 * @param height Set to the height of the image.
+	 * @param components Set to the number of components in the file.
+	 * @param desired_components The components to decode to, 0 to keep the file's.
+	 * @return The pixels, or nullptr if the image is missing or invalid.
+	 */
+	static unsigned char* decode_image(const char* file_path, int& width, int& height, int& components, int desired_components);
+	/**
+	 * @brief Reads the size of an image without decoding it, from the mounted asset pack or from disk.
+	 *
+	 * @param file_path The file path to the image.
+	 * @param width Set to the width of the image.
+	 * @param height Set to the height of the image.
+	 * @param components Set to the number of components in the file.
+	 * @return True if the image header was read.
+	 */
+	static bool read_image_info(const char* file_path, int& width, int& height, int& components);
+
+private:
+
+	// == Private Methods ==
+	/**
+	 * @brief Checks a cooked texture in memory and uploads every level.
+	 *
+	 * @param data The .ctex file contents.
+	 * @param size The size of the file.
+	 * @param file_path The file path, for errors.
+	 * @return The ID of the loaded texture, or 0 if the file is invalid.
+	 */
+	static GLuint upload_cooked_image(const unsigned char* data, size_t size, const char* file_path);
 };
@@ -0,0 +1,190 @@
+﻿#include "c_instanced_renderer.h"
+#include <algorithm>
+#include "c_gl_state.h"
+
+c_instanced_renderer::c_instanced_renderer(const c_mesh& mesh)
+	: mesh_(mesh)
+{
+	// Set up the instance VAO.
+	setup_instance_vao();
+}
+
+c_instanced_renderer::~c_instanced_renderer()
+{
+	// Delete the GL objects. The mesh buffers are owned by the shared geometry.
+	glDeleteBuffers(1, &instance_vbo_);
+	c_gl_state::forget_vertex_array(vao_);
+	glDeleteVertexArrays(1, &vao_);
+}
+
+void c_instanced_renderer::clear()
+{
+	// Keep the memory, only reset the count.
+	instances_.clear();
+	dirty_begin_ = dirty_end_ = 0;
+}
+
+int c_instanced_renderer::add_instance(const glm::mat4& model_matrix, int texture_index)
+{
+	instances_.push_back({ model_matrix, texture_index });
+	mark_dirty(instances_.size() - 1);
+	return static_cast<int>(instances_.size()) - 1;
+}
+
+void c_instanced_renderer::set_instance_transform(int slot, const glm::mat4& model_matrix)
+{
+	instances_[slot].model_matrix = model_matrix;
+	mark_dirty(slot);
+}
+
+void c_instanced_renderer::set_instance_texture(int slot, int texture_index)
+{
+	// Skip the upload if it hasn't changed.
+	if (instances_[slot].texture_index == texture_index)
+	{
+		return;
+	}
+	instances_[slot].texture_index = texture_index;
+	mark_dirty(slot);
+}
+
+s_instance_data* c_instanced_renderer::write_instances(size_t first, size_t count)
+{
+	mark_dirty(first);
+	mark_dirty(first + count - 1);
+	return &instances_[first];
+}
+
+void c_instanced_renderer::draw(GLuint program_id)
+{
+	// Nothing to draw.
+	if (instances_.empty())
+	{
+		return;
+	}
+
+	// The buffer holds a packed subset from a culled draw, so every slot needs uploading again.
+	if (buffer_packed_)
+	{
+		buffer_packed_ = false;
+		mark_dirty(0);
+		mark_dirty(instances_.size() - 1);
+	}
+
+	// Upload the changed instances and draw them all in one call.
+	upload_instances();
+	mesh_.draw_instanced(program_id, vao_, static_cast<GLsizei>(instances_.size()));
+}
+
+void c_instanced_renderer::draw(GLuint program_id, const std::vector<int>& visible_slots)
+{
+	// Every slot is visible, draw order doesn't matter so the normal path matches.
+	if (visible_slots.size() == instances_.size())
+	{
+		draw(program_id);
+		return;
+	}
+	if (visible_slots.empty())
+	{
+		return;
+	}
+
+	// Repack only if the visible set or any instance data changed.
+	const bool data_changed = dirty_begin_ != dirty_end_;
+	if (!buffer_packed_ || data_changed || visible_slots != packed_slots_)
+	{
+		packed_.clear();
+		for (int slot : visible_slots)
+		{
+			packed_.push_back(instances_[slot]);
+		}
+
+		// Every visible instance fits, the buffer is at least as big as the instance count.
+		glBindBuffer(GL_ARRAY_BUFFER, instance_vbo_);
+		if (instances_.size() > instance_capacity_)
+		{
+			instance_capacity_ = instances_.size() * 2;
+			glBufferData(GL_ARRAY_BUFFER, instance_capacity_ * sizeof(s_instance_data), nullptr, GL_DYNAMIC_DRAW);
+		}
+		glBufferSubData(GL_ARRAY_BUFFER, 0, packed_.size() * sizeof(s_instance_data), packed_.data());
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		// The dirty range is in the packed upload, the full buffer is rebuilt when culling stops.
+		dirty_begin_ = dirty_end_ = 0;
+		packed_slots_ = visible_slots;
+		buffer_packed_ = true;
+	}
+
+	mesh_.draw_instanced(program_id, vao_, static_cast<GLsizei>(visible_slots.size()));
+}
+
+void c_instanced_renderer::setup_instance_vao()
+{
+	// Generate the buffers.
+	glGenVertexArrays(1, &vao_);
+	glGenBuffers(1, &instance_vbo_);
+
+	// Bind the VAO and attach the mesh VBO, EBO and vertex attributes.
+	c_gl_state::bind_vertex_array(vao_);
+	mesh_.setup_vertex_attributes();
+
+	// Set the instance attribute pointers.
+	glBindBuffer(GL_ARRAY_BUFFER, instance_vbo_);
+	// Model matrix, a mat4 attribute takes 4 locations, one per column.
+	for (GLuint i = 0; i < 4; i++)
+	{
+		const GLuint location = c_mesh::instance_transform_location + i;
+		glEnableVertexAttribArray(location);
+		glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(s_instance_data),
+			reinterpret_cast<void*>(offsetof(s_instance_data, model_matrix) + sizeof(glm::vec4) * i));
+		glVertexAttribDivisor(location, 1); // Advance once per instance.
+	}
+	// Texture index, integer attribute so use the I pointer.
+	glEnableVertexAttribArray(c_mesh::instance_texture_location);
+	glVertexAttribIPointer(c_mesh::instance_texture_location, 1, GL_INT, sizeof(s_instance_data),
+		reinterpret_cast<void*>(offsetof(s_instance_data, texture_index)));
+	glVertexAttribDivisor(c_mesh::instance_texture_location, 1);
+
+	// Unbind the VAO so later buffer binds can't change it.
+	c_gl_state::bind_vertex_array(0);
+}
+
+void c_instanced_renderer::upload_instances()
+{
+	// Nothing changed since the last upload.
+	if (dirty_begin_ == dirty_end_)
+	{
+		return;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, instance_vbo_);
+
+	// Grow the buffer if the instances no longer fit, the new buffer is empty so everything is uploaded.
+	if (instances_.size() > instance_capacity_)
+	{
+		instance_capacity_ = instances_.size() * 2; // Double to avoid reallocating every time an instance is added.
+		glBufferData(GL_ARRAY_BUFFER, instance_capacity_ * sizeof(s_instance_data), nullptr, GL_DYNAMIC_DRAW);
+		dirty_begin_ = 0;
+		dirty_end_ = instances_.size();
+	}
+
+	// Upload only the range that changed.
+	glBufferSubData(GL_ARRAY_BUFFER, dirty_begin_ * sizeof(s_instance_data),
+		(dirty_end_ - dirty_begin_) * sizeof(s_instance_data), &instances_[dirty_begin_]);
+	dirty_begin_ = dirty_end_ = 0;
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void c_instanced_renderer::mark_dirty(size_t slot)
+{
+	// Grow the range to cover the slot, one contiguous upload is cheaper than many small ones.
+	if (dirty_begin_ == dirty_end_)
+	{
+		dirty_begin_ = slot;
+		dirty_end_ = slot + 1;
+		return;
+	}
+	dirty_begin_ = std::min(dirty_begin_, slot);
+	dirty_end_ = std::max(dirty_end_, slot + 1);
+}
@@ -0,0 +1,117 @@
+﻿// /***********************************************************************
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+// (c) 2024 Media Design School
+// File Name : c_instanced_renderer.h
+// Description : Class to draw many copies of a mesh with one instanced draw call.
+// Author : Foster Rae
+// Mail : Foster.Rae@mds.ac.nz
+// ************************************************************************/
+#pragma once
+#include <vector>
+#include <glew.h>
+#include "c_mesh.h"
+#include "c_structs.h"
+
+/**
+ * @class c_instanced_renderer
+ * @brief Batches every object that shares a mesh and material into one glDrawElementsInstanced call.
+ * @note Per-object model matrices and texture indices are packed into a single instance buffer.
+ *       Instances keep their slot between frames, only slots that changed are re-uploaded.
+ */
+class c_instanced_renderer
+{
+public:
+
+	// == Constructors and Destructors ==
+	/**
+	 * @brief Construct a new instanced renderer for a mesh.
+	 * @param mesh The mesh (geometry and textures) every instance shares.
+	 */
+	explicit c_instanced_renderer(const c_mesh& mesh);
+	~c_instanced_renderer();
+	c_instanced_renderer(const c_instanced_renderer&) = delete;            // Owns GL objects, no copying.
+	c_instanced_renderer& operator=(const c_instanced_renderer&) = delete;
+
+	// == Public Methods ==
+	/**
+	 * @brief Removes every instance.
+	 */
+	void clear();
+	/**
+	 * @brief Adds an instance to the batch.
+	 * @param model_matrix The model matrix of the instance.
+	 * @param texture_index The index of the texture the instance samples.
+	 * @return The slot of the instance, used to update it later.
+	 */
+	int add_instance(const glm::mat4& model_matrix, int texture_index);
+	/**
+	 * @brief Updates the model matrix of an instance and marks it for upload.
+	 * @param slot The slot returned by add_instance.
+	 * @param model_matrix The new model matrix.
+	 */
+	void set_instance_transform(int slot, const glm::mat4& model_matrix);
+	/**
+	 * @brief Updates the texture index of an instance and marks it for upload.
+	 * @param slot The slot returned by add_instance.
+	 * @param texture_index The new texture index.
+	 */
+	void set_instance_texture(int slot, int texture_index);
+	/**
+	 * @brief Gets a range of instances to write to directly and marks it for upload.
+	 * @note Used by c_transform_store to build matrices straight into the instance data.
+	 *
+	 * @param first The first slot.
+	 * @param count The number of slots, first + count must not be more than the instance count.
+	 * @return A pointer to the first instance.
+	 */
+	s_instance_data* write_instances(size_t first, size_t count);
+	/**
+	 * @brief Uploads the changed instances and draws every instance in one call.
+	 * @param program_id The shader program to use.
+	 */
+	void draw(GLuint program_id);
+	/**
+	 * @brief Draws only some of the instances in one call, e.g. the ones that passed frustum culling.
+	 * @note The visible instances are packed into the front of the instance buffer. The packed upload is
+	 *       skipped if the visible slots and the instance data are the same as last frame.
+	 *
+	 * @param program_id The shader program to use.
+	 * @param visible_slots The slots to draw, each slot at most once.
+	 */
+	void draw(GLuint program_id, const std::vector<int>& visible_slots);
+
+	// == Accessors ==
+	size_t get_instance_count() const { return instances_.size(); }
+
+private:
+
+	// == Private Methods ==
+	/**
+	 * @brief Creates the instance VAO sharing the mesh buffers and attaches the instance attributes.
+	 */
+	void setup_instance_vao();
+	/**
+	 * @brief Uploads the dirty range of the instance data, growing the instance buffer if needed.
+	 */
+	void upload_instances();
+	/**
+	 * @brief Adds a slot to the range that needs uploading.
+	 * @param slot The changed slot.
+	 */
+	void mark_dirty(size_t slot);
+
+	// == Private Members ==
+	c_mesh mesh_;                            // The mesh, holds a handle to the shared geometry.
+	std::vector<s_instance_data> instances_; // CPU copy of the instance data.
+	GLuint vao_ = 0;                         // VAO with the mesh and instance attributes.
+	GLuint instance_vbo_ = 0;                // Buffer holding the instance data.
+	size_t instance_capacity_ = 0;           // Number of instances the instance buffer can hold.
+	size_t dirty_begin_ = 0;                 // First slot that needs uploading.
+	size_t dirty_end_ = 0;                   // One past the last slot that needs uploading, equal to dirty_begin_ if clean.
+	bool buffer_packed_ = false;             // The buffer holds a packed visible subset rather than every slot.
+	std::vector<int> packed_slots_;          // The slots in the packed buffer, in order.
+	std::vector<s_instance_data> packed_;    // Staging for the packed upload.
+};
@@ -0,0 +1,174 @@
+﻿#include "c_lz4.h"
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @brief Reads 4 bytes without caring about alignment.
+ *
+ * @param data The bytes to read.
+ * @return The bytes as a 32 bit value.
+ */
+static uint32_t read_32(const unsigned char* data)
+{
+	uint32_t value;
+	std::memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+// == Public Methods ==
+std::vector<unsigned char> c_lz4::compress(const unsigned char* data, size_t size)
+{
+	std::vector<unsigned char> output;
+	output.reserve(size + size / 255 + 16); // Worst case, all literals.
+
+	// Last position seen for each hash of 4 bytes. -1 for none.
+	std::vector<int64_t> table(size_t(1) << hash_bits, -1);
+	size_t anchor = 0; // Start of the literals not written yet.
+	size_t position = 0;
+	while (size >= match_limit && position + match_limit <= size)
+	{
+		// Look up the last place these 4 bytes were seen.
+		const uint32_t sequence = read_32(data + position);
+		const uint32_t hash = (sequence * 2654435761u) >> (32 - hash_bits);
+		const int64_t candidate = table[hash];
+		table[hash] = static_cast<int64_t>(position);
+		if (candidate < 0 || position - static_cast<size_t>(candidate) > max_offset || read_32(data + candidate) != sequence)
+		{
+			position++;
+			continue;
+		}
+
+		// Extend the match, keeping clear of the last literals.
+		size_t match_length = min_match;
+		while (position + match_length < size - last_literals && data[candidate + match_length] == data[position + match_length])
+		{
+			match_length++;
+		}
+
+		// Token, then the literals, the offset and the rest of the match length.
+		const size_t literal_length = position - anchor;
+		const size_t match_extra = match_length - min_match;
+		output.push_back(static_cast<unsigned char>(((literal_length < 15 ? literal_length : 15) << 4) | (match_extra < 15 ? match_extra : 15)));
+		if (literal_length >= 15)
+		{
+			write_length(output, literal_length - 15);
+		}
+		output.insert(output.end(), data + anchor, data + position);
+		const size_t offset = position - static_cast<size_t>(candidate);
+		output.push_back(static_cast<unsigned char>(offset & 0xFF));
+		output.push_back(static_cast<unsigned char>(offset >> 8));
+		if (match_extra >= 15)
+		{
+			write_length(output, match_extra - 15);
+		}
+
+		position += match_length;
+		anchor = position;
+	}
+
+	// The rest goes as a final literal run with no match.
+	const size_t literal_length = size - anchor;
+	output.push_back(static_cast<unsigned char>((literal_length < 15 ? literal_length : 15) << 4));
+	if (literal_length >= 15)
+	{
+		write_length(output, literal_length - 15);
+	}
+	output.insert(output.end(), data + anchor, data + size);
+	return output;
+}
+
+bool c_lz4::decompress(const unsigned char* source, size_t source_size, unsigned char* destination, size_t destination_size)
+{
+	const unsigned char* input = source;
+	const unsigned char* input_end = source + source_size;
+	unsigned char* output = destination;
+	unsigned char* output_end = destination + destination_size;
+	while (input < input_end)
+	{
+		// Literal run.
+		const unsigned char token = *input++;
+		size_t literal_length = token >> 4;
+		if (literal_length == 15)
+		{
+			unsigned char extra;
+			do
+			{
+				if (input == input_end)
+				{
+					return false;
+				}
+				extra = *input++;
+				literal_length += extra;
+			} while (extra == 255);
+		}
+		if (literal_length > static_cast<size_t>(input_end - input) || literal_length > static_cast<size_t>(output_end - output))
+		{
+			return false;
+		}
+		std::memcpy(output, input, literal_length);
+		input += literal_length;
+		output += literal_length;
+
+		// The last sequence has no match.
+		if (input == input_end)
+		{
+			break;
+		}
+
+		// Match, copied a byte at a time since it can overlap what it writes. (an offset of 1 repeats a byte)
+		if (input_end - input < 2)
+		{
+			return false;
+		}
+		const size_t offset = input[0] | (static_cast<size_t>(input[1]) << 8);
+		input += 2;
+		if (offset == 0 || offset > static_cast<size_t>(output - destination))
+		{
+			return false;
+		}
+		size_t match_length = token & 0x0F;
+		if (match_length == 15)
+		{
+			unsigned char extra;
+			do
+			{
+				if (input == input_end)
+				{
+					return false;
+				}
+				extra = *input++;
+				match_length += extra;
+			} while (extra == 255);
+		}
+		match_length += min_match;
+		if (match_length > static_cast<size_t>(output_end - output))
+		{
+			return false;
+		}
+		const unsigned char* match = output - offset;
+		if (offset >= match_length)
+		{
+			std::memcpy(output, match, match_length);
+		}
+		else
+		{
+			for (size_t i = 0; i < match_length; i++)
+			{
+				output[i] = match[i];
+			}
+		}
+		output += match_length;
+	}
+	return output == output_end;
+}
+
+// == Private Methods ==
+void c_lz4::write_length(std::vector<unsigned char>& output, size_t length)
+{
+	while (length >= 255)
+	{
+		output.push_back(255);
+		length -= 255;
+	}
+	output.push_back(static_cast<unsigned char>(length));
+}
@@ -0,0 +1,68 @@
+﻿// /***********************************************************************
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+// (c) 2024 Media Design School
+// File Name : c_lz4.h
+// Description : Class with static methods that compress and decompress LZ4 blocks.
+// Author : Foster Rae
+// Mail : Foster.Rae@mds.ac.nz
+// ************************************************************************/
+#pragma once
+#include <cstddef>
+#include <vector>
+
+/**
+ * @class c_lz4
+ * @brief Reads and writes the LZ4 block format, the raw sequences without the frame header or checksums.
+ * @note Decompressing is a byte copy loop, fast enough to do on load. The compressor is a single pass greedy match
+ *       finder, it doesn't search as hard as the reference library but its output is readable by it.
+ */
+class c_lz4
+{
+public:
+
+	// == Public Methods ==
+	/**
+	 * @brief Compresses data into one LZ4 block.
+	 *
+	 * @param data The data to compress.
+	 * @param size The size of the data in bytes.
+	 * @return The block. Can be larger than the data if it doesn't compress.
+	 */
+	static std::vector<unsigned char> compress(const unsigned char* data, size_t size);
+	/**
+	 * @brief Decompresses one LZ4 block, checking every length and offset against the buffers.
+	 *
+	 * @param source The block.
+	 * @param source_size The size of the block in bytes.
+	 * @param destination The buffer to write the data to.
+	 * @param destination_size The size of the data, the block must fill it exactly.
+	 * @return True if the block was valid and filled the buffer.
+	 */
+	static bool decompress(const unsigned char* source, size_t source_size, unsigned char* destination, size_t destination_size);
+
+	// == Constants ==
+	static constexpr size_t min_match = 4;        // Shortest match a sequence can hold.
+	static constexpr size_t last_literals = 5;    // The last bytes of a block are always literals.
+	static constexpr size_t match_limit = 12;     // The last match has to start this far before the end.
+	static constexpr size_t max_offset = 65535;   // Matches are found within this window.
+
+private:
+
+	// == Constructors / Destructors ==
+	c_lz4() = default;  // Static class.
+	~c_lz4() = default;
+
+	// == Private Methods ==
+	/**
+	 * @brief Writes the extra bytes of a literal or match length that didn't fit in the token.
+	 * @param output The block being written.
+	 * @param length The length minus the 15 already in the token.
+	 */
+	static void write_length(std::vector<unsigned char>& output, size_t length);
+
+	// == Constants ==
+	static constexpr int hash_bits = 12; // 4096 entry match table, small enough to stay in L1.
+};
@@ -0,0 +1,129 @@
+﻿#include "c_mapped_file.h"
+#include <iostream>
+#include <utility>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+c_mapped_file::~c_mapped_file()
+{
+	close();
+}
+
+c_mapped_file::c_mapped_file(c_mapped_file&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+c_mapped_file& c_mapped_file::operator=(c_mapped_file&& other) noexcept
+{
+	if (this != &other)
+	{
+		close();
+		std::swap(data_, other.data_);
+		std::swap(size_, other.size_);
+#ifdef _WIN32
+		std::swap(file_, other.file_);
+		std::swap(mapping_, other.mapping_);
+#endif
+	}
+	return *this;
+}
+
+// == Public Methods ==
+bool c_mapped_file::open(const char* file_path)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(file_path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		std::cout << "Failed to open file: " << file_path << '\n';
+		return false;
+	}
+
+	// An empty file can't be mapped.
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		std::cout << "Failed to map empty file: " << file_path << '\n';
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void* view = (mapping != nullptr) ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (view == nullptr)
+	{
+		std::cout << "Failed to map file: " << file_path << '\n';
+		if (mapping != nullptr)
+		{
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+		return false;
+	}
+
+	file_ = file;
+	mapping_ = mapping;
+	data_ = static_cast<const unsigned char*>(view);
+	size_ = static_cast<size_t>(size.QuadPart);
+#else
+	const int file = ::open(file_path, O_RDONLY);
+	if (file < 0)
+	{
+		std::cout << "Failed to open file: " << file_path << '\n';
+		return false;
+	}
+
+	// An empty file can't be mapped.
+	struct stat info;
+	if (fstat(file, &info) != 0 || info.st_size == 0)
+	{
+		std::cout << "Failed to map empty file: " << file_path << '\n';
+		::close(file);
+		return false;
+	}
+
+	// The mapping keeps its own reference, so the descriptor can go straight away.
+	void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file);
+	if (view == MAP_FAILED)
+	{
+		std::cout << "Failed to map file: " << file_path << '\n';
+		return false;
+	}
+
+	data_ = static_cast<const unsigned char*>(view);
+	size_ = static_cast<size_t>(info.st_size);
+#endif
+	return true;
+}
+
+void c_mapped_file::close()
+{
+	if (data_ == nullptr)
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile(data_);
+	CloseHandle(static_cast<HANDLE>(mapping_));
+	CloseHandle(static_cast<HANDLE>(file_));
+	file_ = nullptr;
+	mapping_ = nullptr;
+#else
+	munmap(const_cast<unsigned char*>(data_), size_);
+#endif
+	data_ = nullptr;
+	size_ = 0;
+}
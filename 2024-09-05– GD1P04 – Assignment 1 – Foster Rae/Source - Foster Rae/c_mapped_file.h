@@ -0,0 +1,59 @@
+﻿// /***********************************************************************
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+// (c) 2024 Media Design School
+// File Name : c_mapped_file.h
+// Description : Class that maps a file into memory read-only.
+// Author : Foster Rae
+// Mail : Foster.Rae@mds.ac.nz
+// ************************************************************************/
+#pragma once
+#include <cstddef>
+
+/**
+ * @class c_mapped_file
+ * @brief Maps a whole file into memory read-only, so it can be read in place without copying it into a buffer.
+ * @note The OS pages the file in as it is touched. Pointers into the data are only valid while the file is open.
+ */
+class c_mapped_file
+{
+public:
+
+	// == Constructors and Destructors ==
+	c_mapped_file() = default;
+	~c_mapped_file(); // Unmaps the file.
+	c_mapped_file(const c_mapped_file&) = delete;            // Owns the mapping, no copying.
+	c_mapped_file& operator=(const c_mapped_file&) = delete;
+	c_mapped_file(c_mapped_file&& other) noexcept;
+	c_mapped_file& operator=(c_mapped_file&& other) noexcept;
+
+	// == Public Methods ==
+	/**
+	 * @brief Maps a file, closing any file that was already open.
+	 *
+	 * @param file_path The file path to map.
+	 * @return True if the file was mapped, false if it is missing or empty.
+	 */
+	bool open(const char* file_path);
+	/**
+	 * @brief Unmaps the file. Does nothing if no file is open.
+	 */
+	void close();
+
+	// == Accessors ==
+	const unsigned char* get_data() const { return data_; }
+	size_t get_size() const { return size_; }
+	bool is_open() const { return data_ != nullptr; }
+
+private:
+
+	// == Private Members ==
+	const unsigned char* data_ = nullptr;
+	size_t size_ = 0;
+#ifdef _WIN32
+	void* file_ = nullptr;    // File handle, kept as void* so the header doesn't pull in windows.h.
+	void* mapping_ = nullptr; // File mapping handle.
+#endif
+};
@@ -1,25 +1,71 @@
 ﻿#include "c_mesh.h"
 #include "c_shader_loader.h"
+#include "c_gl_state.h"
 
-c_mesh::c_mesh(const std::vector<s_vertex>& vertices, const std::vector<GLuint>& indices, const std::vector<s_texture>& textures)
-	: vertices(vertices), indices(indices), textures(textures){
-	// Set up the mesh data.
-	setup_mesh();
+c_mesh::c_mesh(const std::vector<s_vertex>& vertices, const std::vector<GLuint>& indices, const std::vector<s_texture>& textures, bool packed)
+	: textures(textures), geometry_(std::make_shared<c_geometry>(vertices, indices, packed)){
+}
+
+c_mesh::c_mesh(std::shared_ptr<c_geometry> geometry, const std::vector<s_texture>& textures)
+	: textures(textures), geometry_(std::move(geometry)){
 }
 
 void c_mesh::draw(GLuint program_id, int active_texture_index) const
 {
-	// Set the texture count.
-	GLuint diffuse_count = 1;
-	GLuint specular_count = 1;
+	// Bind the textures.
+	bind_textures(program_id);
+
+	// Set the active texture for changing textures on click.
+	// The mesh VAO has no instance buffer, so the constant attribute value is used instead.
+	glVertexAttribI1i(instance_texture_location, active_texture_index);
+	set_position_decode();
+
+	// Draw the mesh. The VAO stays bound, the next draw skips the bind if it uses the same one.
+	c_gl_state::bind_vertex_array(geometry_->get_vao());
+	glDrawElements(GL_TRIANGLES, geometry_->get_index_count(), geometry_->get_index_type(), nullptr);
+}
+
+void c_mesh::draw_instanced(GLuint program_id, GLuint instance_vao, GLsizei instance_count) const
+{
+	// Bind the textures.
+	bind_textures(program_id);
+
+	// Draw every instance in one call.
+	set_position_decode();
+	c_gl_state::bind_vertex_array(instance_vao);
+	glDrawElementsInstanced(GL_TRIANGLES, geometry_->get_index_count(), geometry_->get_index_type(), nullptr, instance_count);
+}
+
+void c_mesh::bind_textures(GLuint program_id) const
+{
+	// Resolve the sampler locations if the program or textures changed.
+	if (program_id != sampler_program_ || sampler_locations_.size() != textures.size())
+	{
+		resolve_sampler_locations(program_id);
+	}
 
 	// Bind the textures.
 	// TODO: Change back to mixing the diffuse and specular textures after project.
 	for (GLuint i = 0; i < textures.size(); i++)
 	{
-		glActiveTexture(GL_TEXTURE0 + i); // Activate the texture unit first before binding.
+		// Set the sampler to the correct texture unit.
+		c_shader_loader::set_int(sampler_locations_[i], static_cast<int>(i));
+		c_gl_state::bind_texture(i, textures[i].target, textures[i].id);
+	}
+}
+
+void c_mesh::resolve_sampler_locations(GLuint program_id) const
+{
+	// Set the texture count.
+	GLuint diffuse_count = 1;
+	GLuint specular_count = 1;
+
+	sampler_program_ = program_id;
+	sampler_locations_.clear();
+	for (const s_texture& texture : textures)
+	{
 		std::string number;
-		std::string name = textures[i].type;
+		const std::string& name = texture.type;
 
 		// Get the texture number and increment the count.
 		if (name == "texture_diffuse")
@@ -31,51 +77,14 @@ void c_mesh::draw(GLuint program_id, int active_texture_index) const
 			number = std::to_string(specular_count++);
 		}
 
-		// Set the sampler to the correct texture unit.
-		glUniform1i(glGetUniformLocation(program_id, (name + number).c_str()), i); // Concat to get the uniform name.
-		glBindTexture(GL_TEXTURE_2D, textures[i].id);
+		// Concat to get the uniform name.
+		sampler_locations_.push_back(c_shader_loader::get_uniform_location(program_id, name + number));
 	}
-
-	// Set the active texture uniform for changing textures on click.
-	glUniform1i(glGetUniformLocation(program_id, "active_texture"), active_texture_index);
-
-	// Draw the mesh.
-	glBindVertexArray(vao);
-	glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, nullptr);
-	glBindVertexArray(0);
-
-	// Reset the active texture.
-	glActiveTexture(GL_TEXTURE0);
 }
 
-void c_mesh::setup_mesh()
+void c_mesh::set_position_decode() const
 {
-	// Generate the buffers.
-	glGenVertexArrays(1, &vao);
-	glGenBuffers(1, &vbo_);
-	glGenBuffers(1, &ebo_);
-
-	// Bind the VAO.
-	glBindVertexArray(vao);
-
-	// Bind the VBO and EBO.
-	glBindBuffer(GL_ARRAY_BUFFER, vbo_);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(s_vertex), vertices.data(), GL_STATIC_DRAW);
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
-
-	// Set the vertex attribute pointers.
-	// Vertex Positions.
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(s_vertex), static_cast<void*>(nullptr));
-	// Vertex Normals.
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(s_vertex), reinterpret_cast<void*>(offsetof(s_vertex, normal)));
-	// Vertex Texture Coords.
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(s_vertex), reinterpret_cast<void*>(offsetof(s_vertex, tex_coords)));
-
-	// Unbind the VAO.
-	glBindVertexArray(0);
-}
\ No newline at end of file
+	// Constant attributes like the texture index, no VAO enables these locations.
+	glVertexAttrib3fv(position_scale_location, &geometry_->get_position_scale()[0]);
+	glVertexAttrib3fv(position_offset_location, &geometry_->get_position_offset()[0]);
+}
@@ -10,8 +10,10 @@
 // Mail : Foster.Rae@mds.ac.nz
 // ************************************************************************/
 #pragma once
+#include <memory>
 #include <vector>
 #include <glew.h>
+#include "c_geometry.h"
 #include "c_structs.h"
 
 class c_mesh
@@ -20,34 +22,69 @@ public:
 
 	// == Constructors and Destructors ==
 	c_mesh() = default; // Default constructor
-	c_mesh(const std::vector<s_vertex>& vertices, const std::vector<GLuint>& indices, const std::vector<s_texture>& textures);
+	c_mesh(const std::vector<s_vertex>& vertices, const std::vector<GLuint>& indices, const std::vector<s_texture>& textures, bool packed = false); // Unshared geometry.
+	c_mesh(std::shared_ptr<c_geometry> geometry, const std::vector<s_texture>& textures); // Shared geometry, see c_geometry_cache.
 
 	// == Public Methods ==
 	/**
 	 * @brief Draws the mesh.
-	 * @note Textures must be names as: texture_diffuseN, texture_specularN or nothing will be loaded.
+	 * @note Textures must be names as: texture_diffuseN, texture_specularN or texture_array or nothing will be loaded.
 	 *
 	 * @param program_id The shader program to use.
 	 *  @param active_texture_index The index of the texture to use.
 	 */
 	void draw(GLuint program_id, int active_texture_index) const;
+	/**
+	 * @brief Draws the mesh once per instance in a single draw call.
+	 * @note The VAO must have the mesh buffers and an instance buffer attached, see c_instanced_renderer.
+	 *
+	 * @param program_id The shader program to use.
+	 * @param instance_vao The VAO holding the mesh and instance attributes.
+	 * @param instance_count The number of instances to draw.
+	 */
+	void draw_instanced(GLuint program_id, GLuint instance_vao, GLsizei instance_count) const;
+	/**
+	 * @brief Attaches the mesh VBO, EBO and vertex attributes to the currently bound VAO.
+	 * @note Lets other VAOs (e.g. instanced ones) share the mesh buffers without re-uploading them.
+	 */
+	void setup_vertex_attributes() const { geometry_->setup_vertex_attributes(); }
+	/**
+	 * @brief Binds the mesh textures and sets their sampler uniforms.
+	 *
+	 * @param program_id The shader program to use.
+	 */
+	void bind_textures(GLuint program_id) const;
+
+	// == Accessors ==
+	const std::shared_ptr<c_geometry>& get_geometry() const { return geometry_; }
+
+	// == Constants ==
+	static constexpr GLuint instance_transform_location = 3; // First location of the per-instance model matrix (uses 3 - 6).
+	static constexpr GLuint instance_texture_location = 7;   // Location of the per-instance texture index.
+	static constexpr GLuint position_scale_location = 8;     // Scale and offset that rebuild packed positions, see c_geometry.
+	static constexpr GLuint position_offset_location = 9;
 
 	// == Public Members ==
-	GLuint vao; // vao is public.
-	// Mesh data
-	std::vector<s_vertex> vertices;
-	std::vector<GLuint> indices;
 	std::vector<s_texture> textures;
 
 private:
 
 	// == Private Methods ==
 	/**
-	 * @brief Sets up the mesh data.
-	 * @note This is called in the constructor.
+	 * @brief Resolves the sampler uniform locations for a program.
+	 * @note Only runs when the program or texture count changes, so drawing does no string building.
+	 *
+	 * @param program_id The shader program to resolve against.
+	 */
+	void resolve_sampler_locations(GLuint program_id) const;
+	/**
+	 * @brief Sets the constant position scale and offset attributes for the geometry, identity if it isn't packed.
 	 */
-	void setup_mesh();
+	void set_position_decode() const;
 
 	// == Private Members ==
-	GLuint vbo_, ebo_;
+	std::shared_ptr<c_geometry> geometry_; // The vertex and index data, possibly shared with other meshes.
+	// Sampler locations cached for the last program drawn with.
+	mutable GLuint sampler_program_ = 0;
+	mutable std::vector<GLint> sampler_locations_;
 };
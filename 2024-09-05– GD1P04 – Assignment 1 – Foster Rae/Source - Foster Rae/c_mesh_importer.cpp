@@ -0,0 +1,868 @@
+﻿#include "c_mesh_importer.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <geometric.hpp>
+#include "c_asset_pack.h"
+#include "c_mapped_file.h"
+#include "c_mesh_optimizer.h"
+#include "c_thread_pool.h"
+
+/**
+ * @brief A parsed JSON value, only as much as the glTF header needs.
+ * @param type What the value holds.
+ * @param number The value of a number or bool.
+ * @param string The value of a string.
+ * @param items The elements of an array or the values of an object.
+ * @param keys The keys of an object, in the same order as items.
+ */
+struct s_json {
+	enum class e_type { null, boolean, number, string, array, object } type = e_type::null;
+	double number = 0.0;
+	std::string string;
+	std::vector<s_json> items;
+	std::vector<std::string> keys;
+
+	// Object member or array element, nullptr if missing.
+	const s_json* get(std::string_view key) const
+	{
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			if (keys[i] == key)
+			{
+				return &items[i];
+			}
+		}
+		return nullptr;
+	}
+	const s_json* at(size_t index) const { return (type == e_type::array && index < items.size()) ? &items[index] : nullptr; }
+	// Number member, or the fallback if it is missing or not a number.
+	double get_number(std::string_view key, double fallback) const
+	{
+		const s_json* value = get(key);
+		return (value != nullptr && value->type == e_type::number) ? value->number : fallback;
+	}
+};
+
+/**
+ * @brief Skips spaces and tabs.
+ *
+ * @param p The current character.
+ * @param end One past the last character.
+ * @return The first character that isn't a space or tab.
+ */
+static const char* skip_spaces(const char* p, const char* end)
+{
+	while (p < end && (*p == ' ' || *p == '\t'))
+	{
+		p++;
+	}
+	return p;
+}
+
+/**
+ * @brief Parses a float after any spaces.
+ *
+ * @param p The current character, moved past the number.
+ * @param end One past the last character.
+ * @param value Set to the number.
+ * @return True if there was a number.
+ */
+static bool parse_float(const char*& p, const char* end, float& value)
+{
+	p = skip_spaces(p, end);
+	if (p < end && *p == '+')
+	{
+		p++; // from_chars doesn't take a leading plus.
+	}
+	const std::from_chars_result result = std::from_chars(p, end, value);
+	if (result.ec != std::errc())
+	{
+		return false;
+	}
+	p = result.ptr;
+	return true;
+}
+
+/**
+ * @brief Parses a signed OBJ index.
+ *
+ * @param p The current character, moved past the number.
+ * @param end One past the last character.
+ * @param value Set to the index.
+ * @return True if there was a non-zero index that fits in 32 bits.
+ */
+static bool parse_index(const char*& p, const char* end, int32_t& value)
+{
+	const bool negative = p < end && *p == '-';
+	if (negative)
+	{
+		p++;
+	}
+	int64_t result = 0;
+	const char* digits = p;
+	while (p < end && *p >= '0' && *p <= '9' && p - digits < 10)
+	{
+		result = result * 10 + (*p - '0');
+		p++;
+	}
+	if (p == digits || result == 0 || result > INT32_MAX || (p < end && *p >= '0' && *p <= '9'))
+	{
+		return false;
+	}
+	value = static_cast<int32_t>(negative ? -result : result);
+	return true;
+}
+
+/**
+ * @brief Parses a JSON value.
+ * @note Nesting is limited so a hostile file can't overflow the stack.
+ *
+ * @param p The current character, moved past the value.
+ * @param end One past the last character.
+ * @param value Set to the value.
+ * @param depth How deep the value is nested.
+ * @return True if the value is valid.
+ */
+static bool parse_json(const char*& p, const char* end, s_json& value, int depth = 0)
+{
+	const auto skip_whitespace = [&]()
+	{
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+		{
+			p++;
+		}
+	};
+	const auto parse_string = [&](std::string& out) -> bool
+	{
+		p++; // Opening quote.
+		while (p < end && *p != '"')
+		{
+			if (*p != '\\')
+			{
+				out.push_back(*p++);
+				continue;
+			}
+			if (++p == end)
+			{
+				return false;
+			}
+			const char escape = *p++;
+			switch (escape)
+			{
+			case 'b': out.push_back('\b'); break;
+			case 'f': out.push_back('\f'); break;
+			case 'n': out.push_back('\n'); break;
+			case 'r': out.push_back('\r'); break;
+			case 't': out.push_back('\t'); break;
+			case 'u':
+			{
+				// Names the importer looks up are ASCII, keep others as UTF-8 without pairing surrogates.
+				unsigned int code = 0;
+				if (end - p < 4 || std::from_chars(p, p + 4, code, 16).ptr != p + 4)
+				{
+					return false;
+				}
+				p += 4;
+				if (code < 0x80)
+				{
+					out.push_back(static_cast<char>(code));
+				}
+				else if (code < 0x800)
+				{
+					out.push_back(static_cast<char>(0xC0 | (code >> 6)));
+					out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+				}
+				else
+				{
+					out.push_back(static_cast<char>(0xE0 | (code >> 12)));
+					out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+					out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+				}
+				break;
+			}
+			default: out.push_back(escape); break; // Quote, backslash and slash.
+			}
+		}
+		if (p == end)
+		{
+			return false;
+		}
+		p++; // Closing quote.
+		return true;
+	};
+
+	if (depth > 64)
+	{
+		return false;
+	}
+	skip_whitespace();
+	if (p == end)
+	{
+		return false;
+	}
+
+	switch (*p)
+	{
+	case '{':
+	case '[':
+	{
+		const bool is_object = *p == '{';
+		const char close = is_object ? '}' : ']';
+		value.type = is_object ? s_json::e_type::object : s_json::e_type::array;
+		p++;
+		skip_whitespace();
+		if (p < end && *p == close)
+		{
+			p++;
+			return true;
+		}
+		while (true)
+		{
+			if (is_object)
+			{
+				skip_whitespace();
+				value.keys.emplace_back();
+				if (p == end || *p != '"' || !parse_string(value.keys.back()))
+				{
+					return false;
+				}
+				skip_whitespace();
+				if (p == end || *p++ != ':')
+				{
+					return false;
+				}
+			}
+			value.items.emplace_back();
+			if (!parse_json(p, end, value.items.back(), depth + 1))
+			{
+				return false;
+			}
+			skip_whitespace();
+			if (p == end)
+			{
+				return false;
+			}
+			if (*p == close)
+			{
+				p++;
+				return true;
+			}
+			if (*p++ != ',')
+			{
+				return false;
+			}
+		}
+	}
+	case '"':
+		value.type = s_json::e_type::string;
+		return parse_string(value.string);
+	case 't':
+	case 'f':
+	case 'n':
+	{
+		// Literals.
+		const std::string_view rest(p, end - p);
+		for (std::string_view literal : { "true", "false", "null" })
+		{
+			if (rest.substr(0, literal.size()) == literal)
+			{
+				value.type = (literal[0] == 'n') ? s_json::e_type::null : s_json::e_type::boolean;
+				value.number = (literal[0] == 't') ? 1.0 : 0.0;
+				p += literal.size();
+				return true;
+			}
+		}
+		return false;
+	}
+	default:
+	{
+		value.type = s_json::e_type::number;
+		const std::from_chars_result result = std::from_chars(p, end, value.number);
+		p = result.ptr;
+		return result.ec == std::errc();
+	}
+	}
+}
+
+/**
+ * @brief Where the elements of a glTF accessor sit in the BIN chunk.
+ * @param data The first element.
+ * @param count The number of elements.
+ * @param stride The bytes from one element to the next.
+ * @param component_type The GL type of each component.
+ * @param components The components in each element. (3 for VEC3)
+ * @param normalized True if integer components map to 0-1 or -1-1.
+ */
+struct s_accessor_view {
+	const unsigned char* data;
+	size_t count;
+	size_t stride;
+	int component_type;
+	int components;
+	bool normalized;
+};
+
+/**
+ * @brief Finds an accessor's elements in the BIN chunk and checks they fit.
+ *
+ * @param root The glTF JSON.
+ * @param bin The BIN chunk.
+ * @param index The accessor index.
+ * @param view Set to the elements.
+ * @return True if the accessor is valid and in the BIN chunk, sparse accessors are not supported.
+ */
+static bool get_accessor_view(const s_json& root, std::span<const unsigned char> bin, double index, s_accessor_view& view)
+{
+	const s_json* accessors = root.get("accessors");
+	const s_json* accessor = (accessors != nullptr && index >= 0.0) ? accessors->at(static_cast<size_t>(index)) : nullptr;
+	if (accessor == nullptr || accessor->get("sparse") != nullptr)
+	{
+		return false;
+	}
+	const s_json* buffer_views = root.get("bufferViews");
+	const double view_index = accessor->get_number("bufferView", -1.0);
+	const s_json* buffer_view = (buffer_views != nullptr && view_index >= 0.0) ? buffer_views->at(static_cast<size_t>(view_index)) : nullptr;
+	if (buffer_view == nullptr || buffer_view->get_number("buffer", 0.0) != 0.0)
+	{
+		return false;
+	}
+
+	// Element layout.
+	view.component_type = static_cast<int>(accessor->get_number("componentType", 0.0));
+	size_t component_size;
+	switch (view.component_type)
+	{
+	case GL_BYTE: case GL_UNSIGNED_BYTE: component_size = 1; break;
+	case GL_SHORT: case GL_UNSIGNED_SHORT: component_size = 2; break;
+	case GL_UNSIGNED_INT: case GL_FLOAT: component_size = 4; break;
+	default: return false;
+	}
+	const s_json* type = accessor->get("type");
+	const std::string type_name = (type != nullptr) ? type->string : "";
+	view.components = (type_name == "SCALAR") ? 1 : (type_name == "VEC2") ? 2 : (type_name == "VEC3") ? 3 : (type_name == "VEC4") ? 4 : 0;
+	const s_json* normalized = accessor->get("normalized");
+	view.normalized = normalized != nullptr && normalized->number != 0.0;
+	if (view.components == 0)
+	{
+		return false;
+	}
+
+	// Range checks, in doubles so huge values can't wrap.
+	const double element_size = static_cast<double>(component_size * view.components);
+	const double count = accessor->get_number("count", 0.0);
+	const double stride = buffer_view->get_number("byteStride", element_size);
+	const double view_offset = buffer_view->get_number("byteOffset", 0.0);
+	const double view_length = buffer_view->get_number("byteLength", 0.0);
+	const double offset = accessor->get_number("byteOffset", 0.0);
+	if (count < 1.0 || stride < element_size || view_offset < 0.0 || offset < 0.0 || view_offset + view_length > static_cast<double>(bin.size())
+		|| offset + stride * (count - 1.0) + element_size > view_length)
+	{
+		return false;
+	}
+	view.data = bin.data() + static_cast<size_t>(view_offset + offset);
+	view.count = static_cast<size_t>(count);
+	view.stride = static_cast<size_t>(stride);
+	return true;
+}
+
+/**
+ * @brief Reads one component of an accessor element as a float, scaling normalized integers.
+ *
+ * @param view The accessor.
+ * @param element The element index.
+ * @param component The component index.
+ * @return The value.
+ */
+static float read_component(const s_accessor_view& view, size_t element, int component)
+{
+	const unsigned char* source = view.data + element * view.stride;
+	switch (view.component_type)
+	{
+	case GL_FLOAT: { float value; std::memcpy(&value, source + component * 4, 4); return value; }
+	case GL_UNSIGNED_INT: { uint32_t value; std::memcpy(&value, source + component * 4, 4); return static_cast<float>(value); }
+	case GL_UNSIGNED_SHORT: { uint16_t value; std::memcpy(&value, source + component * 2, 2); return view.normalized ? value / 65535.0f : value; }
+	case GL_SHORT: { int16_t value; std::memcpy(&value, source + component * 2, 2); return view.normalized ? std::max(value / 32767.0f, -1.0f) : value; }
+	case GL_UNSIGNED_BYTE: { const uint8_t value = source[component]; return view.normalized ? value / 255.0f : value; }
+	default: { const int8_t value = static_cast<int8_t>(source[component]); return view.normalized ? std::max(value / 127.0f, -1.0f) : value; }
+	}
+}
+
+// == Public Methods ==
+bool c_mesh_importer::load(const char* file_path, std::vector<s_vertex>& vertices, std::vector<GLuint>& indices, bool optimize)
+{
+	// Read in place from the asset pack or the mapped file.
+	c_mapped_file file;
+	std::span<const unsigned char> data = c_asset_pack::find_mounted(file_path);
+	if (data.empty())
+	{
+		if (!file.open(file_path))
+		{
+			std::cout << "Failed to load mesh: " << file_path << '\n';
+			return false;
+		}
+		data = { file.get_data(), file.get_size() };
+	}
+
+	std::string extension = std::filesystem::path(file_path).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	bool loaded = false;
+	if (extension == ".obj")
+	{
+		// Threads only pay for themselves on big files.
+		std::unique_ptr<c_thread_pool> pool;
+		if (data.size() >= parallel_threshold)
+		{
+			pool = std::make_unique<c_thread_pool>();
+		}
+		loaded = parse_obj(reinterpret_cast<const char*>(data.data()), data.size(), vertices, indices, pool.get());
+	}
+	else if (extension == ".glb")
+	{
+		loaded = parse_glb(data.data(), data.size(), vertices, indices);
+	}
+	else
+	{
+		std::cout << "Error: Unsupported mesh format: " << file_path << '\n';
+		return false;
+	}
+
+	if (!loaded)
+	{
+		std::cout << "Failed to load mesh: " << file_path << '\n';
+		return false;
+	}
+
+	// Files come in whatever order the exporter wrote, reorder them once here rather than on every draw.
+	if (optimize)
+	{
+		c_mesh_optimizer::optimize(vertices, indices);
+	}
+	return true;
+}
+
+bool c_mesh_importer::parse_obj(const char* data, size_t size, std::vector<s_vertex>& vertices, std::vector<GLuint>& indices, c_thread_pool* pool)
+{
+	vertices.clear();
+	indices.clear();
+
+	// Split on line boundaries, a few chunks per thread so an uneven file still spreads out.
+	const size_t chunk_count = (pool == nullptr) ? 1 : std::max<size_t>(1, std::min<size_t>(pool->get_thread_count() * 4, size / 65536));
+	std::vector<const char*> bounds(chunk_count + 1, data + size);
+	bounds[0] = data;
+	for (size_t i = 1; i < chunk_count; i++)
+	{
+		const char* split = std::max(bounds[i - 1], data + size * i / chunk_count);
+		const char* newline = static_cast<const char*>(std::memchr(split, '\n', data + size - split));
+		bounds[i] = (newline != nullptr) ? newline + 1 : data + size;
+	}
+	std::vector<s_obj_chunk> chunks(chunk_count);
+	if (pool == nullptr)
+	{
+		parse_obj_chunk(bounds[0], bounds[1], chunks[0]);
+	}
+	else
+	{
+		for (size_t i = 0; i < chunk_count; i++)
+		{
+			pool->submit([&bounds, &chunks, i]() { parse_obj_chunk(bounds[i], bounds[i + 1], chunks[i]); });
+		}
+		pool->wait_idle();
+	}
+
+	// Join the attribute arrays and turn the chunk relative indices into file indices.
+	std::vector<float> positions, tex_coords, normals;
+	size_t corner_count = 0;
+	for (s_obj_chunk& chunk : chunks)
+	{
+		if (chunk.error)
+		{
+			std::cout << "Error: Invalid OBJ line." << '\n';
+			return false;
+		}
+		const int32_t offsets[3] = { static_cast<int32_t>(positions.size() / 3), static_cast<int32_t>(tex_coords.size() / 2), static_cast<int32_t>(normals.size() / 3) };
+		for (size_t slot : chunk.relative_corners)
+		{
+			chunk.corners[slot] += offsets[slot % 3];
+		}
+		positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+		tex_coords.insert(tex_coords.end(), chunk.tex_coords.begin(), chunk.tex_coords.end());
+		normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+		corner_count += chunk.corners.size() / 3;
+		std::vector<float>().swap(chunk.positions);
+		std::vector<float>().swap(chunk.tex_coords);
+		std::vector<float>().swap(chunk.normals);
+	}
+	if (corner_count == 0)
+	{
+		std::cout << "Error: OBJ has no faces." << '\n';
+		return false;
+	}
+
+	// Merge equal corners into one vertex. The table holds vertex index + 1, 0 is empty, and stays under half full.
+	const int32_t position_count = static_cast<int32_t>(positions.size() / 3);
+	const int32_t tex_coord_count = static_cast<int32_t>(tex_coords.size() / 2);
+	const int32_t normal_count = static_cast<int32_t>(normals.size() / 3);
+	size_t table_size = 1;
+	while (table_size < corner_count * 2)
+	{
+		table_size <<= 1;
+	}
+	std::vector<uint32_t> table(table_size, 0);
+	std::vector<int32_t> keys;
+	keys.reserve(std::min<size_t>(corner_count, position_count) * 3);
+	vertices.reserve(keys.capacity() / 3);
+	indices.resize(corner_count);
+	size_t index = 0;
+	bool needs_normals = false;
+	for (const s_obj_chunk& chunk : chunks)
+	{
+		for (size_t i = 0; i < chunk.corners.size(); i += 3)
+		{
+			const int32_t v = chunk.corners[i];
+			const int32_t vt = chunk.corners[i + 1];
+			const int32_t vn = chunk.corners[i + 2];
+			if (v < 0 || v >= position_count || (vt != missing_index && (vt < 0 || vt >= tex_coord_count))
+				|| (vn != missing_index && (vn < 0 || vn >= normal_count)))
+			{
+				std::cout << "Error: Invalid OBJ face index." << '\n';
+				vertices.clear();
+				indices.clear();
+				return false;
+			}
+
+			uint32_t hash = static_cast<uint32_t>(v) * 0x9E3779B1u ^ static_cast<uint32_t>(vt) * 0x85EBCA77u ^ static_cast<uint32_t>(vn) * 0xC2B2AE3Du;
+			hash ^= hash >> 15;
+			size_t bucket = hash & (table_size - 1);
+			while (table[bucket] != 0)
+			{
+				const int32_t* key = &keys[(table[bucket] - 1) * 3];
+				if (key[0] == v && key[1] == vt && key[2] == vn)
+				{
+					break;
+				}
+				bucket = (bucket + 1) & (table_size - 1);
+			}
+			if (table[bucket] == 0)
+			{
+				s_vertex vertex;
+				vertex.position = glm::vec3(positions[size_t(v) * 3], positions[size_t(v) * 3 + 1], positions[size_t(v) * 3 + 2]);
+				vertex.tex_coords = (vt == missing_index) ? glm::vec2(0.0f) : glm::vec2(tex_coords[size_t(vt) * 2], tex_coords[size_t(vt) * 2 + 1]);
+				vertex.normal = (vn == missing_index) ? glm::vec3(0.0f) : glm::vec3(normals[size_t(vn) * 3], normals[size_t(vn) * 3 + 1], normals[size_t(vn) * 3 + 2]);
+				needs_normals |= vn == missing_index;
+				vertices.push_back(vertex);
+				keys.insert(keys.end(), { v, vt, vn });
+				table[bucket] = static_cast<uint32_t>(vertices.size());
+			}
+			indices[index++] = table[bucket] - 1;
+		}
+	}
+
+	if (needs_normals)
+	{
+		generate_normals(vertices, indices.data(), indices.size());
+	}
+	return true;
+}
+
+bool c_mesh_importer::parse_glb(const unsigned char* data, size_t size, std::vector<s_vertex>& vertices, std::vector<GLuint>& indices)
+{
+	vertices.clear();
+	indices.clear();
+
+	// Header, then the JSON chunk, then the optional BIN chunk.
+	const auto read_u32 = [data](size_t offset) { uint32_t value; std::memcpy(&value, data + offset, 4); return value; };
+	if (size < 20 || std::memcmp(data, "glTF", 4) != 0 || read_u32(4) != 2 || read_u32(8) < 20 || read_u32(8) > size || read_u32(16) != glb_json_chunk)
+	{
+		std::cout << "Error: Not a glTF 2.0 binary." << '\n';
+		return false;
+	}
+	const size_t file_size = read_u32(8);
+	const size_t json_size = read_u32(12);
+	if (json_size > file_size - 20)
+	{
+		std::cout << "Error: Invalid glTF chunk." << '\n';
+		return false;
+	}
+	std::span<const unsigned char> bin;
+	const size_t bin_header = 20 + ((json_size + 3) & ~static_cast<size_t>(3));
+	if (bin_header + 8 <= file_size && read_u32(bin_header + 4) == glb_bin_chunk)
+	{
+		const size_t bin_size = read_u32(bin_header);
+		if (bin_size > file_size - bin_header - 8)
+		{
+			std::cout << "Error: Invalid glTF chunk." << '\n';
+			return false;
+		}
+		bin = { data + bin_header + 8, bin_size };
+	}
+
+	s_json root;
+	const char* json = reinterpret_cast<const char*>(data + 20);
+	if (!parse_json(json, json + json_size, root) || root.type != s_json::e_type::object)
+	{
+		std::cout << "Error: Invalid glTF JSON." << '\n';
+		return false;
+	}
+
+	// Every triangle primitive of every mesh goes into the one vertex and index list.
+	const s_json* meshes = root.get("meshes");
+	bool needs_normals = false;
+	for (size_t m = 0; meshes != nullptr && m < meshes->items.size(); m++)
+	{
+		const s_json* primitives = meshes->items[m].get("primitives");
+		for (size_t p = 0; primitives != nullptr && p < primitives->items.size(); p++)
+		{
+			const s_json& primitive = primitives->items[p];
+			if (primitive.get_number("mode", 4.0) != 4.0)
+			{
+				continue; // Points, lines and strips.
+			}
+			const s_json* attributes = primitive.get("attributes");
+			s_accessor_view position_view, normal_view, tex_coord_view, index_view;
+			if (attributes == nullptr || !get_accessor_view(root, bin, attributes->get_number("POSITION", -1.0), position_view) || position_view.components != 3)
+			{
+				std::cout << "Error: Invalid glTF positions." << '\n';
+				vertices.clear();
+				indices.clear();
+				return false;
+			}
+			const size_t count = position_view.count;
+			const bool has_normals = get_accessor_view(root, bin, attributes->get_number("NORMAL", -1.0), normal_view) && normal_view.components == 3 && normal_view.count == count;
+			const bool has_tex_coords = get_accessor_view(root, bin, attributes->get_number("TEXCOORD_0", -1.0), tex_coord_view) && tex_coord_view.components == 2
+				&& tex_coord_view.count == count;
+			if (vertices.size() + count > UINT32_MAX)
+			{
+				std::cout << "Error: glTF has too many vertices." << '\n';
+				vertices.clear();
+				indices.clear();
+				return false;
+			}
+
+			// Vertices. glTF puts the UV origin at the top left, OpenGL at the bottom left.
+			const GLuint base_vertex = static_cast<GLuint>(vertices.size());
+			vertices.resize(vertices.size() + count);
+			for (size_t i = 0; i < count; i++)
+			{
+				s_vertex& vertex = vertices[base_vertex + i];
+				vertex.position = glm::vec3(read_component(position_view, i, 0), read_component(position_view, i, 1), read_component(position_view, i, 2));
+				vertex.normal = has_normals ? glm::vec3(read_component(normal_view, i, 0), read_component(normal_view, i, 1), read_component(normal_view, i, 2)) : glm::vec3(0.0f);
+				vertex.tex_coords = has_tex_coords ? glm::vec2(read_component(tex_coord_view, i, 0), 1.0f - read_component(tex_coord_view, i, 1)) : glm::vec2(0.0f);
+			}
+			needs_normals |= !has_normals;
+
+			// Indices, or one vertex per corner if there are none.
+			const size_t base_index = indices.size();
+			if (primitive.get("indices") == nullptr)
+			{
+				for (size_t i = 0; i + 2 < count; i += 3)
+				{
+					indices.insert(indices.end(), { base_vertex + static_cast<GLuint>(i), base_vertex + static_cast<GLuint>(i + 1), base_vertex + static_cast<GLuint>(i + 2) });
+				}
+				continue;
+			}
+			if (!get_accessor_view(root, bin, primitive.get_number("indices", -1.0), index_view) || index_view.components != 1
+				|| (index_view.component_type != GL_UNSIGNED_BYTE && index_view.component_type != GL_UNSIGNED_SHORT && index_view.component_type != GL_UNSIGNED_INT))
+			{
+				std::cout << "Error: Invalid glTF indices." << '\n';
+				vertices.clear();
+				indices.clear();
+				return false;
+			}
+			indices.resize(base_index + index_view.count / 3 * 3);
+			for (size_t i = 0; i < indices.size() - base_index; i++)
+			{
+				const unsigned char* source = index_view.data + i * index_view.stride;
+				uint32_t value;
+				switch (index_view.component_type)
+				{
+				case GL_UNSIGNED_BYTE: value = source[0]; break;
+				case GL_UNSIGNED_SHORT: { uint16_t value_16; std::memcpy(&value_16, source, 2); value = value_16; break; }
+				default: std::memcpy(&value, source, 4); break;
+				}
+				if (value >= count)
+				{
+					std::cout << "Error: Invalid glTF index." << '\n';
+					vertices.clear();
+					indices.clear();
+					return false;
+				}
+				indices[base_index + i] = base_vertex + value;
+			}
+		}
+	}
+	if (indices.empty())
+	{
+		std::cout << "Error: glTF has no triangles." << '\n';
+		vertices.clear();
+		return false;
+	}
+
+	if (needs_normals)
+	{
+		generate_normals(vertices, indices.data(), indices.size());
+	}
+	return true;
+}
+
+// == Private Methods ==
+void c_mesh_importer::parse_obj_chunk(const char* begin, const char* end, s_obj_chunk& chunk)
+{
+	// Rough reserve, a typical line is around 30 bytes.
+	chunk.positions.reserve((end - begin) / 30);
+	chunk.corners.reserve((end - begin) / 10);
+
+	std::vector<int32_t> face;          // The corners of the current face.
+	std::vector<uint8_t> face_relative; // Which of the corner's indices are relative, one bit each.
+	const char* p = begin;
+	while (p < end)
+	{
+		p = skip_spaces(p, end);
+		const char* line_end = static_cast<const char*>(std::memchr(p, '\n', end - p));
+		if (line_end == nullptr)
+		{
+			line_end = end;
+		}
+
+		if (line_end - p >= 2 && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			// Position, any w or vertex colour after it is ignored.
+			float xyz[3];
+			p += 2;
+			chunk.error |= !parse_float(p, line_end, xyz[0]) || !parse_float(p, line_end, xyz[1]) || !parse_float(p, line_end, xyz[2]);
+			chunk.positions.insert(chunk.positions.end(), xyz, xyz + 3);
+		}
+		else if (line_end - p >= 3 && p[0] == 'v' && p[1] == 't' && (p[2] == ' ' || p[2] == '\t'))
+		{
+			// UV, v is optional and w is ignored.
+			float uv[2] = { 0.0f, 0.0f };
+			p += 3;
+			chunk.error |= !parse_float(p, line_end, uv[0]);
+			const char* next = skip_spaces(p, line_end);
+			if (next < line_end && *next != '\r')
+			{
+				chunk.error |= !parse_float(p, line_end, uv[1]);
+			}
+			chunk.tex_coords.insert(chunk.tex_coords.end(), uv, uv + 2);
+		}
+		else if (line_end - p >= 3 && p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t'))
+		{
+			float xyz[3];
+			p += 3;
+			chunk.error |= !parse_float(p, line_end, xyz[0]) || !parse_float(p, line_end, xyz[1]) || !parse_float(p, line_end, xyz[2]);
+			chunk.normals.insert(chunk.normals.end(), xyz, xyz + 3);
+		}
+		else if (line_end - p >= 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			// Corners are v, v/vt, v//vn or v/vt/vn. Negative indices count back from the last element so far.
+			const int32_t counts[3] = { static_cast<int32_t>(chunk.positions.size() / 3), static_cast<int32_t>(chunk.tex_coords.size() / 2),
+				static_cast<int32_t>(chunk.normals.size() / 3) };
+			face.clear();
+			face_relative.clear();
+			p += 2;
+			while (true)
+			{
+				p = skip_spaces(p, line_end);
+				if (p == line_end || *p == '\r')
+				{
+					break;
+				}
+				int32_t corner[3] = { missing_index, missing_index, missing_index };
+				uint8_t relative = 0;
+				for (int component = 0; component < 3; component++)
+				{
+					if (component > 0)
+					{
+						if (p == line_end || *p != '/')
+						{
+							break;
+						}
+						p++;
+						if (component == 1 && p < line_end && *p == '/')
+						{
+							continue; // v//vn
+						}
+					}
+					int32_t value;
+					if (!parse_index(p, line_end, value))
+					{
+						chunk.error = true;
+						break;
+					}
+					corner[component] = (value > 0) ? value - 1 : counts[component] + value;
+					relative |= (value < 0) ? (1 << component) : 0;
+				}
+				if (chunk.error)
+				{
+					break;
+				}
+				face.insert(face.end(), corner, corner + 3);
+				face_relative.push_back(relative);
+			}
+
+			// Fan out from the first corner.
+			const size_t face_corners = face_relative.size();
+			for (size_t i = 2; i < face_corners && !chunk.error; i++)
+			{
+				for (size_t corner : { size_t(0), i - 1, i })
+				{
+					for (int component = 0; component < 3; component++)
+					{
+						if (face_relative[corner] & (1 << component))
+						{
+							chunk.relative_corners.push_back(chunk.corners.size());
+						}
+						chunk.corners.push_back(face[corner * 3 + component]);
+					}
+				}
+			}
+			chunk.error |= face_corners < 3;
+		}
+		// Anything else is a comment, group, material or something that isn't geometry.
+
+		if (chunk.error)
+		{
+			return;
+		}
+		p = line_end + 1;
+	}
+}
+
+void c_mesh_importer::generate_normals(std::vector<s_vertex>& vertices, const GLuint* indices, size_t index_count)
+{
+	// Only fill vertices that have no normal, area weighted by leaving the cross product unnormalized.
+	std::vector<bool> missing(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		missing[i] = vertices[i].normal == glm::vec3(0.0f);
+	}
+	for (size_t i = 0; i + 2 < index_count; i += 3)
+	{
+		s_vertex& a = vertices[indices[i]];
+		s_vertex& b = vertices[indices[i + 1]];
+		s_vertex& c = vertices[indices[i + 2]];
+		const glm::vec3 normal = glm::cross(b.position - a.position, c.position - a.position);
+		for (GLuint index : { indices[i], indices[i + 1], indices[i + 2] })
+		{
+			if (missing[index])
+			{
+				vertices[index].normal += normal;
+			}
+		}
+	}
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		if (missing[i])
+		{
+			const float length = glm::length(vertices[i].normal);
+			vertices[i].normal = (length > 0.0f) ? vertices[i].normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+		}
+	}
+}
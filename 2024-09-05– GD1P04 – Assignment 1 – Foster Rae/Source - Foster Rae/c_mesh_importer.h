@@ -0,0 +1,116 @@
+﻿// /***********************************************************************
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+// (c) 2024 Media Design School
+// File Name : c_mesh_importer.h
+// Description : Class with static methods that load Wavefront OBJ and binary glTF meshes into vertex and index arrays.
+// Author : Foster Rae
+// Mail : Foster.Rae@mds.ac.nz
+// ************************************************************************/
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glew.h>
+#include "c_structs.h"
+
+class c_thread_pool;
+
+/**
+ * @class c_mesh_importer
+ * @brief Turns .obj and .glb files into s_vertex and index arrays ready for c_mesh or c_geometry_cache.
+ * @note OBJ files are split into chunks on line boundaries and parsed on a thread pool with std::from_chars, then
+ *       the position/UV/normal corners are merged into unique vertices through an open addressing hash table.
+ *       Polygons are triangulated as fans. Meshes without normals get smooth normals from their faces.
+ *       glTF UVs are flipped to the OpenGL origin, every triangle primitive of every mesh is merged into one.
+ *       load() then reorders the mesh with c_mesh_optimizer.
+ */
+class c_mesh_importer
+{
+public:
+
+	// == Public Methods ==
+	/**
+	 * @brief Loads a mesh from the mounted asset pack or a mapped file, picking the format from the extension.
+	 * @note Large OBJ files are parsed on a thread pool.
+	 *
+	 * @param file_path The file path to the .obj or .glb file.
+	 * @param vertices Set to the unique vertices.
+	 * @param indices Set to the triangle list indices.
+	 * @param optimize True to reorder the mesh for the vertex caches and overdraw, see c_mesh_optimizer.
+	 * @return True if the mesh loaded, false if the file is missing, invalid or not a supported format.
+	 */
+	static bool load(const char* file_path, std::vector<s_vertex>& vertices, std::vector<GLuint>& indices, bool optimize = true);
+	/**
+	 * @brief Parses OBJ text. Only the geometry is read, materials and groups are ignored.
+	 *
+	 * @param data The file contents.
+	 * @param size The size of the file in bytes.
+	 * @param vertices Set to the unique vertices.
+	 * @param indices Set to the triangle list indices.
+	 * @param pool Optional pool to spread the chunks over, nullptr to parse on this thread.
+	 * @return True if the mesh is valid.
+	 */
+	static bool parse_obj(const char* data, size_t size, std::vector<s_vertex>& vertices, std::vector<GLuint>& indices, c_thread_pool* pool = nullptr);
+	/**
+	 * @brief Parses a binary glTF 2.0 file. Only buffers stored in the file's BIN chunk are supported.
+	 * @note Node transforms are not applied, each mesh is loaded in its own space.
+	 *
+	 * @param data The file contents.
+	 * @param size The size of the file in bytes.
+	 * @param vertices Set to the vertices.
+	 * @param indices Set to the triangle list indices.
+	 * @return True if the mesh is valid.
+	 */
+	static bool parse_glb(const unsigned char* data, size_t size, std::vector<s_vertex>& vertices, std::vector<GLuint>& indices);
+
+	// == Constants ==
+	static constexpr size_t parallel_threshold = 1024 * 1024; // OBJ files smaller than this are parsed on the calling thread.
+
+private:
+
+	// == Constants ==
+	static constexpr int32_t missing_index = INT32_MIN;      // Corner without a UV or normal.
+	static constexpr uint32_t glb_json_chunk = 0x4E4F534Au;  // "JSON" read as little endian.
+	static constexpr uint32_t glb_bin_chunk = 0x004E4942u;   // "BIN\0" read as little endian.
+
+	// == Constructors / Destructors ==
+	c_mesh_importer() = default;  // Static class.
+	~c_mesh_importer() = default;
+
+	/**
+	 * @brief What one chunk of an OBJ file holds.
+	 * @param positions The "v" positions, 3 floats each.
+	 * @param tex_coords The "vt" coordinates, 2 floats each.
+	 * @param normals The "vn" normals, 3 floats each.
+	 * @param corners The triangle corners as position, UV and normal indices, 0 based, missing_index if missing.
+	 * @param relative_corners The corner values that are relative to the chunk's first element, fixed up after the merge.
+	 * @param error True if a line failed to parse.
+	 */
+	struct s_obj_chunk {
+		std::vector<float> positions;
+		std::vector<float> tex_coords;
+		std::vector<float> normals;
+		std::vector<int32_t> corners;
+		std::vector<size_t> relative_corners;
+		bool error = false;
+	};
+
+	// == Private Methods ==
+	/**
+	 * @brief Parses the lines of one chunk.
+	 * @param begin The first character of the chunk, the start of a line.
+	 * @param end One past the last character, the end of a line.
+	 * @param chunk The chunk to fill.
+	 */
+	static void parse_obj_chunk(const char* begin, const char* end, s_obj_chunk& chunk);
+	/**
+	 * @brief Gives vertices with a zero normal the normalized sum of the normals of the triangles around them.
+	 * @param vertices The vertices.
+	 * @param indices The triangles to take the normals from.
+	 * @param index_count The number of indices.
+	 */
+	static void generate_normals(std::vector<s_vertex>& vertices, const GLuint* indices, size_t index_count);
+};
@@ -0,0 +1,406 @@
+﻿#include "c_mesh_optimizer.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <geometric.hpp>
+#include "c_geometry.h"
+#include "c_mesh_importer.h"
+
+// == Public Methods ==
+void c_mesh_optimizer::optimize(std::vector<s_vertex>& vertices, std::vector<GLuint>& indices)
+{
+	optimize_vertex_cache(indices.data(), indices.size(), vertices.size());
+	optimize_overdraw(indices.data(), indices.size(), vertices);
+	optimize_vertex_fetch(vertices, indices);
+}
+
+void c_mesh_optimizer::optimize_vertex_cache(GLuint* indices, size_t index_count, size_t vertex_count, int cache_size)
+{
+	const size_t triangle_count = index_count / 3;
+	if (triangle_count == 0)
+	{
+		return;
+	}
+
+	// The triangles around each vertex, and how many of them are still to be emitted.
+	std::vector<uint32_t> offsets(vertex_count + 1, 0);
+	for (size_t i = 0; i < triangle_count * 3; i++)
+	{
+		offsets[indices[i] + 1]++;
+	}
+	for (size_t v = 0; v < vertex_count; v++)
+	{
+		offsets[v + 1] += offsets[v];
+	}
+	std::vector<uint32_t> adjacency(triangle_count * 3);
+	std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i < triangle_count * 3; i++)
+	{
+		adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+	std::vector<uint32_t> live(vertex_count);
+	for (size_t v = 0; v < vertex_count; v++)
+	{
+		live[v] = offsets[v + 1] - offsets[v];
+	}
+
+	// A vertex is in the cache if fewer than cache_size vertices were shaded since it was.
+	std::vector<uint32_t> cache_time(vertex_count, 0);
+	uint32_t time = cache_size + 1;
+	std::vector<bool> emitted(triangle_count, false);
+	std::vector<uint32_t> dead_ends;  // Recently used vertices to restart from when a fan runs out.
+	std::vector<uint32_t> candidates; // Vertices of the last fan, the next fan is picked from these.
+	std::vector<GLuint> output;
+	output.reserve(triangle_count * 3);
+	size_t cursor = 0;
+	const auto skip_dead_end = [&]() -> int64_t
+	{
+		while (!dead_ends.empty())
+		{
+			const uint32_t v = dead_ends.back();
+			dead_ends.pop_back();
+			if (live[v] > 0)
+			{
+				return v;
+			}
+		}
+		while (cursor < vertex_count && live[cursor] == 0)
+		{
+			cursor++;
+		}
+		return (cursor < vertex_count) ? static_cast<int64_t>(cursor) : -1;
+	};
+
+	int64_t fan = skip_dead_end();
+	while (fan >= 0)
+	{
+		// Emit every remaining triangle around the fan vertex.
+		candidates.clear();
+		for (uint32_t a = offsets[fan]; a < offsets[fan + 1]; a++)
+		{
+			const uint32_t triangle = adjacency[a];
+			if (emitted[triangle])
+			{
+				continue;
+			}
+			for (int k = 0; k < 3; k++)
+			{
+				const uint32_t v = indices[triangle * 3 + k];
+				output.push_back(v);
+				dead_ends.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				if (time - cache_time[v] > static_cast<uint32_t>(cache_size))
+				{
+					cache_time[v] = time++;
+				}
+			}
+			emitted[triangle] = true;
+		}
+
+		// Next, the oldest candidate that will still be cached once its own triangles are emitted.
+		int64_t best = -1;
+		int64_t best_priority = -1;
+		for (uint32_t v : candidates)
+		{
+			if (live[v] == 0)
+			{
+				continue;
+			}
+			int64_t priority = 0;
+			if (time - cache_time[v] + 2 * live[v] <= static_cast<uint32_t>(cache_size))
+			{
+				priority = time - cache_time[v];
+			}
+			if (priority > best_priority)
+			{
+				best = v;
+				best_priority = priority;
+			}
+		}
+		fan = (best >= 0) ? best : skip_dead_end();
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void c_mesh_optimizer::optimize_overdraw(GLuint* indices, size_t index_count, const std::vector<s_vertex>& vertices, float threshold, int cache_size)
+{
+	const size_t triangle_count = index_count / 3;
+	if (triangle_count < 2)
+	{
+		return;
+	}
+
+	// Same FIFO as analyze, bumping the time past cache_size empties it.
+	std::vector<uint32_t> cache_time(vertices.size(), 0);
+	uint32_t time = cache_size + 1;
+	const auto shade = [&](size_t triangle)
+	{
+		int misses = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			const GLuint v = indices[triangle * 3 + k];
+			if (time - cache_time[v] > static_cast<uint32_t>(cache_size))
+			{
+				cache_time[v] = time++;
+				misses++;
+			}
+		}
+		return misses;
+	};
+	const auto flush = [&]() { time += cache_size + 1; };
+
+	// Hard boundaries, where all three vertices missed so the order already jumped somewhere cold.
+	std::vector<size_t> hard_starts;
+	for (size_t t = 0; t < triangle_count; t++)
+	{
+		if (shade(t) == 3 || t == 0)
+		{
+			hard_starts.push_back(t);
+		}
+	}
+	hard_starts.push_back(triangle_count);
+
+	// Soft boundaries, wherever the cluster so far is within the threshold of its hard cluster's ACMR.
+	std::vector<size_t> starts;
+	for (size_t c = 0; c + 1 < hard_starts.size(); c++)
+	{
+		const size_t begin = hard_starts[c];
+		const size_t end = hard_starts[c + 1];
+		flush();
+		int cluster_misses = 0;
+		for (size_t t = begin; t < end; t++)
+		{
+			cluster_misses += shade(t);
+		}
+		const float cluster_threshold = threshold * static_cast<float>(cluster_misses) / static_cast<float>(end - begin);
+
+		flush();
+		starts.push_back(begin);
+		size_t soft_begin = begin;
+		int misses = 0;
+		for (size_t t = begin; t + 1 < end; t++)
+		{
+			misses += shade(t);
+			if (static_cast<float>(misses) / static_cast<float>(t + 1 - soft_begin) <= cluster_threshold)
+			{
+				starts.push_back(t + 1);
+				soft_begin = t + 1;
+				misses = 0;
+				flush();
+			}
+		}
+	}
+	starts.push_back(triangle_count);
+
+	// Area weighted centroid and normal of each cluster, and of the whole mesh.
+	const size_t cluster_count = starts.size() - 1;
+	std::vector<glm::vec3> centroids(cluster_count, glm::vec3(0.0f));
+	std::vector<glm::vec3> normals(cluster_count, glm::vec3(0.0f));
+	glm::vec3 mesh_centroid(0.0f);
+	float mesh_area = 0.0f;
+	for (size_t c = 0; c < cluster_count; c++)
+	{
+		float cluster_area = 0.0f;
+		for (size_t t = starts[c]; t < starts[c + 1]; t++)
+		{
+			const glm::vec3& a = vertices[indices[t * 3]].position;
+			const glm::vec3& b = vertices[indices[t * 3 + 1]].position;
+			const glm::vec3& d = vertices[indices[t * 3 + 2]].position;
+			const glm::vec3 normal = glm::cross(b - a, d - a);
+			const float area = glm::length(normal);
+			centroids[c] += (a + b + d) * (area / 3.0f);
+			normals[c] += normal;
+			cluster_area += area;
+		}
+		mesh_centroid += centroids[c];
+		mesh_area += cluster_area;
+		centroids[c] = (cluster_area > 0.0f) ? centroids[c] / cluster_area : vertices[indices[starts[c] * 3]].position;
+	}
+	mesh_centroid = (mesh_area > 0.0f) ? mesh_centroid / mesh_area : glm::vec3(0.0f);
+
+	// Draw the clusters that face away from the centre and sit far out first.
+	std::vector<float> keys(cluster_count);
+	for (size_t c = 0; c < cluster_count; c++)
+	{
+		const float length = glm::length(normals[c]);
+		keys[c] = (length > 0.0f) ? glm::dot(centroids[c] - mesh_centroid, normals[c] / length) : 0.0f;
+	}
+	std::vector<size_t> order(cluster_count);
+	for (size_t c = 0; c < cluster_count; c++)
+	{
+		order[c] = c;
+	}
+	std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] > keys[b]; });
+
+	std::vector<GLuint> sorted;
+	sorted.reserve(triangle_count * 3);
+	for (size_t c : order)
+	{
+		sorted.insert(sorted.end(), indices + starts[c] * 3, indices + starts[c + 1] * 3);
+	}
+	std::copy(sorted.begin(), sorted.end(), indices);
+}
+
+void c_mesh_optimizer::optimize_vertex_fetch(std::vector<s_vertex>& vertices, std::vector<GLuint>& indices)
+{
+	const GLuint unused = 0xFFFFFFFFu;
+	std::vector<GLuint> remap(vertices.size(), unused);
+	std::vector<s_vertex> reordered;
+	reordered.reserve(vertices.size());
+	for (GLuint& index : indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = static_cast<GLuint>(reordered.size());
+			reordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	vertices.swap(reordered);
+}
+
+s_vertex_cache_stats c_mesh_optimizer::analyze(const GLuint* indices, size_t index_count, size_t vertex_count, size_t vertex_size, int cache_size)
+{
+	s_vertex_cache_stats stats;
+	const size_t triangle_count = index_count / 3;
+	if (triangle_count == 0 || vertex_count == 0)
+	{
+		return stats;
+	}
+
+	// Each shaded vertex is read through the fetch cache, vertices that hit the post-transform cache are not.
+	std::vector<uint32_t> cache_time(vertex_count, 0);
+	uint32_t time = cache_size + 1;
+	std::vector<uint32_t> line_time((vertex_count * vertex_size + fetch_line_size - 1) / fetch_line_size, 0);
+	uint32_t line_clock = fetch_line_count + 1;
+	std::vector<bool> used(vertex_count, false);
+	size_t unique = 0;
+	size_t misses = 0;
+	size_t lines_fetched = 0;
+	for (size_t i = 0; i < triangle_count * 3; i++)
+	{
+		const GLuint v = indices[i];
+		if (!used[v])
+		{
+			used[v] = true;
+			unique++;
+		}
+		if (time - cache_time[v] <= static_cast<uint32_t>(cache_size))
+		{
+			continue;
+		}
+		cache_time[v] = time++;
+		misses++;
+
+		for (size_t line = v * vertex_size / fetch_line_size; line <= (v * vertex_size + vertex_size - 1) / fetch_line_size; line++)
+		{
+			if (line_clock - line_time[line] > fetch_line_count)
+			{
+				line_time[line] = line_clock++;
+				lines_fetched++;
+			}
+		}
+	}
+
+	stats.acmr = static_cast<float>(misses) / static_cast<float>(triangle_count);
+	stats.atvr = static_cast<float>(misses) / static_cast<float>(unique);
+	stats.overfetch = static_cast<float>(lines_fetched * fetch_line_size) / static_cast<float>(unique * vertex_size);
+	return stats;
+}
+
+int c_mesh_optimizer::report(const std::vector<std::string>& sources)
+{
+	namespace fs = std::filesystem;
+
+	// Gather the meshes, any case. (rock.OBJ)
+	std::vector<fs::path> files;
+	const auto add_file = [&files](const fs::path& path)
+	{
+		std::string extension = path.extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		if (extension == ".obj" || extension == ".glb")
+		{
+			files.push_back(path);
+		}
+	};
+	for (const std::string& source : sources)
+	{
+		std::error_code error;
+		if (fs::is_directory(source, error))
+		{
+			for (const fs::directory_entry& entry : fs::recursive_directory_iterator(source, error))
+			{
+				if (entry.is_regular_file())
+				{
+					add_file(entry.path());
+				}
+			}
+		}
+		else
+		{
+			add_file(source);
+		}
+	}
+	if (files.empty())
+	{
+		std::cout << "No .obj or .glb meshes found." << '\n';
+		return -1;
+	}
+
+	// Load each mesh as it is in the file, then optimize it the way c_mesh_importer::load does.
+	int reported = 0;
+	int failed = 0;
+	for (const fs::path& file : files)
+	{
+		std::vector<s_vertex> vertices;
+		std::vector<GLuint> indices;
+		if (!c_mesh_importer::load(file.string().c_str(), vertices, indices, false))
+		{
+			failed++;
+			continue;
+		}
+		const s_vertex_cache_stats before = analyze(indices.data(), indices.size(), vertices.size());
+		const auto start = std::chrono::high_resolution_clock::now();
+		optimize(vertices, indices);
+		const double optimize_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		const s_vertex_cache_stats after = analyze(indices.data(), indices.size(), vertices.size());
+
+		std::cout << file.string() << " (" << vertices.size() << " vertices, " << indices.size() / 3 << " triangles, optimized in " << optimize_ms << " ms)\n";
+		std::cout << "  ACMR: " << before.acmr << " -> " << after.acmr << "\n";
+		std::cout << "  ATVR: " << before.atvr << " -> " << after.atvr << "\n";
+		std::cout << "  Overfetch: " << before.overfetch << " -> " << after.overfetch << "\n";
+
+		// Round trip through the packed layout to show what it loses.
+		glm::vec3 position_scale, position_offset;
+		const std::vector<s_packed_vertex> packed = c_geometry::pack_vertices(vertices, position_scale, position_offset);
+		float position_error = 0.0f;
+		float normal_error = 0.0f;
+		float tex_coords_error = 0.0f;
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			const s_vertex unpacked = c_geometry::unpack_vertex(packed[i], position_scale, position_offset);
+			position_error = std::max(position_error, glm::length(unpacked.position - vertices[i].position));
+			if (glm::length(vertices[i].normal) > 0.0f && glm::length(unpacked.normal) > 0.0f)
+			{
+				const float cosine = glm::dot(glm::normalize(unpacked.normal), glm::normalize(vertices[i].normal));
+				normal_error = std::max(normal_error, glm::degrees(std::acos(std::clamp(cosine, -1.0f, 1.0f))));
+			}
+			const glm::vec2 tex_coords_difference = glm::abs(unpacked.tex_coords - vertices[i].tex_coords);
+			tex_coords_error = std::max(tex_coords_error, std::max(tex_coords_difference.x, tex_coords_difference.y));
+		}
+		const float bounds_size = glm::length(position_scale) * 2.0f;
+		std::cout << "  Packed (" << sizeof(s_packed_vertex) << " bytes a vertex instead of " << sizeof(s_vertex) << "): position error <= " << position_error
+			<< " (" << ((bounds_size > 0.0f) ? position_error / bounds_size * 100.0f : 0.0f) << "% of the bounds diagonal), normal <= " << normal_error
+			<< " degrees, UV <= " << tex_coords_error << "\n";
+		reported++;
+	}
+
+	std::cout << "Reported " << reported << " meshes, " << failed << " failed." << '\n';
+	return (failed == 0) ? reported : -1;
+}
@@ -0,0 +1,115 @@
+﻿// /***********************************************************************
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+// (c) 2024 Media Design School
+// File Name : c_mesh_optimizer.h
+// Description : Class with static methods that reorder mesh indices and vertices for the GPU caches.
+// Author : Foster Rae
+// Mail : Foster.Rae@mds.ac.nz
+// ************************************************************************/
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <glew.h>
+#include "c_structs.h"
+
+/**
+ * @brief How well an index order uses the vertex caches, from a FIFO cache simulation.
+ * @param acmr Average cache miss ratio, vertex shader runs per triangle. 0.5 is ideal on a large grid, 3 is no reuse.
+ * @param atvr Average transform to vertex ratio, vertex shader runs per vertex. 1 is ideal.
+ * @param overfetch Bytes read through the vertex fetch cache over the size of the vertices used. 1 is ideal.
+ */
+struct s_vertex_cache_stats {
+	float acmr = 0.0f;
+	float atvr = 0.0f;
+	float overfetch = 0.0f;
+};
+
+/**
+ * @class c_mesh_optimizer
+ * @brief Reorders imported meshes so the GPU shades each vertex as few times as possible, draws the triangles
+ *        most likely to hide others first, and reads the vertex buffer in order.
+ * @note The stages follow Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced
+ *       Overdraw" (2007): Tipsify for the post-transform cache, then clusters sorted by how much they occlude.
+ *       The vertices are renumbered last, in the order the triangles first use them.
+ *       Run the executable with: --mesh-report [files or folders...]
+ */
+class c_mesh_optimizer
+{
+public:
+
+	// == Public Methods ==
+	/**
+	 * @brief Runs every stage: vertex cache, overdraw, then vertex fetch.
+	 * @note Unused vertices are dropped.
+	 *
+	 * @param vertices The vertices, reordered.
+	 * @param indices The triangle list indices, reordered.
+	 */
+	static void optimize(std::vector<s_vertex>& vertices, std::vector<GLuint>& indices);
+	/**
+	 * @brief Reorders the triangles with Tipsify so recently shaded vertices are reused before they leave the cache.
+	 *
+	 * @param indices The triangle list indices, reordered in place.
+	 * @param index_count The number of indices.
+	 * @param vertex_count The number of vertices the indices refer to.
+	 * @param cache_size The post-transform cache size to target.
+	 */
+	static void optimize_vertex_cache(GLuint* indices, size_t index_count, size_t vertex_count, int cache_size = default_cache_size);
+	/**
+	 * @brief Splits a cache optimized order into clusters and sorts them so outward facing clusters far from the centre
+	 *        draw first, from any view those are the ones that cover the rest.
+	 * @note Clusters start where the cache was flushed, and where restarting the cache costs little, so the ACMR
+	 *       grows by at most the threshold.
+	 *
+	 * @param indices The triangle list indices, reordered in place.
+	 * @param index_count The number of indices.
+	 * @param vertices The vertices the indices refer to.
+	 * @param threshold How much worse the ACMR may get, 1.05 allows 5%.
+	 * @param cache_size The post-transform cache size the order was made for.
+	 */
+	static void optimize_overdraw(GLuint* indices, size_t index_count, const std::vector<s_vertex>& vertices, float threshold = default_overdraw_threshold,
+		int cache_size = default_cache_size);
+	/**
+	 * @brief Renumbers the vertices in the order the indices first use them, dropping unused ones.
+	 *
+	 * @param vertices The vertices, reordered.
+	 * @param indices The indices, rewritten to the new order.
+	 */
+	static void optimize_vertex_fetch(std::vector<s_vertex>& vertices, std::vector<GLuint>& indices);
+	/**
+	 * @brief Measures an index order with a FIFO post-transform cache and a cache of fetch lines.
+	 *
+	 * @param indices The triangle list indices.
+	 * @param index_count The number of indices.
+	 * @param vertex_count The number of vertices the indices refer to.
+	 * @param vertex_size The size of a vertex in bytes.
+	 * @param cache_size The post-transform cache size.
+	 * @return The cache statistics.
+	 */
+	static s_vertex_cache_stats analyze(const GLuint* indices, size_t index_count, size_t vertex_count, size_t vertex_size = sizeof(s_vertex),
+		int cache_size = default_cache_size);
+	/**
+	 * @brief Loads every .obj and .glb file given, optimizes it and prints the statistics before and after, and the
+	 *        error of packing its vertices with c_geometry::pack_vertices.
+	 *
+	 * @param sources The files and folders to search, folders are searched recursively.
+	 * @return The number of meshes reported, or -1 if a mesh failed to load or none were found.
+	 */
+	static int report(const std::vector<std::string>& sources);
+
+	// == Constants ==
+	static constexpr int default_cache_size = 16;             // FIFO entries, a safe size for the GPUs this targets.
+	static constexpr float default_overdraw_threshold = 1.05f; // Overdraw sorting may cost up to 5% more vertex shading.
+	static constexpr size_t fetch_line_size = 64;              // Bytes per vertex fetch cache line.
+	static constexpr size_t fetch_line_count = 64;             // Lines in the simulated vertex fetch cache, 4 KB.
+
+private:
+
+	// == Constructors / Destructors ==
+	c_mesh_optimizer() = default;  // Static class.
+	~c_mesh_optimizer() = default;
+};
@@ -0,0 +1,179 @@
+﻿#include "c_scene.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include "c_asset_pack.h"
+#include "c_transform_store.h"
+
+// == Public Methods ==
+bool c_scene::open(const char* file_path)
+{
+	close();
+
+	// Read in place from the asset pack or the mapped file.
+	std::span<const unsigned char> data = c_asset_pack::find_mounted(file_path);
+	if (data.empty())
+	{
+		if (!file_.open(file_path))
+		{
+			return false;
+		}
+		data = { file_.get_data(), file_.get_size() };
+	}
+
+	// Checks.
+	const uint64_t size = data.size();
+	const s_scene_header* header = reinterpret_cast<const s_scene_header*>(data.data());
+	if (size < sizeof(s_scene_header) || std::memcmp(header->magic, "CSCN", 4) != 0 || header->version != file_version)
+	{
+		std::cout << "Not a scene: " << file_path << '\n';
+		close();
+		return false;
+	}
+	const uint64_t transforms_size = get_array_stride(header->object_count) * transform_array_count;
+	if (header->strings_offset > header->groups_offset || header->groups_offset > size || header->groups_offset % alignof(s_scene_group) != 0
+		|| (size - header->groups_offset) / sizeof(s_scene_group) < header->group_count || header->transforms_offset % array_alignment != 0
+		|| header->transforms_offset > size || size - header->transforms_offset < transforms_size)
+	{
+		std::cout << "Error: Invalid tables in " << file_path << '\n';
+		close();
+		return false;
+	}
+	const s_scene_group* groups = reinterpret_cast<const s_scene_group*>(data.data() + header->groups_offset);
+	for (uint32_t i = 0; i < header->group_count; i++)
+	{
+		const s_scene_group& group = groups[i];
+		if (group.mesh >= header->mesh_count || group.texture >= header->texture_count || group.first > header->object_count
+			|| group.count > header->object_count - group.first)
+		{
+			std::cout << "Error: Invalid group " << i << " in " << file_path << '\n';
+			close();
+			return false;
+		}
+	}
+
+	// The names are few, copy them out.
+	const char* strings = reinterpret_cast<const char*>(data.data() + header->strings_offset);
+	const char* strings_end = reinterpret_cast<const char*>(data.data() + header->groups_offset);
+	for (uint32_t i = 0; i < header->mesh_count + header->texture_count; i++)
+	{
+		const char* end = static_cast<const char*>(std::memchr(strings, '\0', strings_end - strings));
+		if (end == nullptr)
+		{
+			std::cout << "Error: Invalid strings in " << file_path << '\n';
+			close();
+			return false;
+		}
+		((i < header->mesh_count) ? mesh_names_ : texture_paths_).emplace_back(strings, end);
+		strings = end + 1;
+	}
+
+	data_ = data.data();
+	header_ = header;
+	groups_ = { groups, header->group_count };
+	return true;
+}
+
+void c_scene::close()
+{
+	file_.close();
+	data_ = nullptr;
+	header_ = nullptr;
+	groups_ = {};
+	mesh_names_.clear();
+	texture_paths_.clear();
+}
+
+int c_scene::load_group(size_t group, c_transform_store& transforms) const
+{
+	if (group >= groups_.size())
+	{
+		return -1;
+	}
+
+	// Each component is one contiguous copy.
+	const s_scene_group& entry = groups_[group];
+	return transforms.append(entry.count, get_array(0) + entry.first, get_array(1) + entry.first, get_array(2) + entry.first, get_array(3) + entry.first,
+		get_array(4) + entry.first, get_array(5) + entry.first, get_array(6) + entry.first,
+		glm::vec3(entry.local_extents[0], entry.local_extents[1], entry.local_extents[2]));
+}
+
+bool c_scene::write(const char* file_path, const std::vector<s_scene_export_group>& groups, const std::vector<std::string>& mesh_names,
+	const std::vector<std::string>& texture_paths)
+{
+	// Lay the groups out one after another.
+	std::vector<s_scene_group> table;
+	uint32_t object_count = 0;
+	for (const s_scene_export_group& group : groups)
+	{
+		if (group.mesh >= mesh_names.size() || group.texture >= texture_paths.size())
+		{
+			std::cout << "Error: Scene group refers to a missing mesh or texture." << '\n';
+			return false;
+		}
+		const uint32_t count = static_cast<uint32_t>(group.handles.size());
+		table.push_back({ group.mesh, group.texture, group.flags, object_count, count, { group.local_extents.x, group.local_extents.y, group.local_extents.z } });
+		object_count += count;
+	}
+
+	// Split the transforms into one array per component.
+	const size_t floats_per_array = static_cast<size_t>(get_array_stride(object_count) / sizeof(float));
+	std::vector<float> arrays(floats_per_array * transform_array_count, 0.0f);
+	size_t object = 0;
+	for (const s_scene_export_group& group : groups)
+	{
+		for (int handle : group.handles)
+		{
+			const glm::vec3 position = group.transforms->get_position(handle);
+			const glm::vec3 scale = group.transforms->get_scale(handle);
+			const float values[transform_array_count] = { position.x, position.y, position.z, group.transforms->get_rotation(handle), scale.x, scale.y, scale.z };
+			for (int array = 0; array < transform_array_count; array++)
+			{
+				arrays[array * floats_per_array + object] = values[array];
+			}
+			object++;
+		}
+	}
+
+	// Header, strings, groups, then the aligned arrays.
+	std::string strings;
+	for (const std::vector<std::string>* names : { &mesh_names, &texture_paths })
+	{
+		for (const std::string& name : *names)
+		{
+			strings += name;
+			strings += '\0';
+		}
+	}
+	s_scene_header header = {};
+	std::memcpy(header.magic, "CSCN", 4);
+	header.version = file_version;
+	header.object_count = object_count;
+	header.group_count = static_cast<uint32_t>(table.size());
+	header.mesh_count = static_cast<uint32_t>(mesh_names.size());
+	header.texture_count = static_cast<uint32_t>(texture_paths.size());
+	header.strings_offset = sizeof(s_scene_header);
+	header.groups_offset = (header.strings_offset + strings.size() + alignof(s_scene_group) - 1) / alignof(s_scene_group) * alignof(s_scene_group);
+	header.transforms_offset = (header.groups_offset + sizeof(s_scene_group) * table.size() + array_alignment - 1) / array_alignment * array_alignment;
+
+	std::ofstream file(file_path, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "Failed to write scene: " << file_path << '\n';
+		return false;
+	}
+	static const char padding[array_alignment] = {};
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+	file.write(padding, static_cast<std::streamsize>(header.groups_offset - static_cast<uint64_t>(file.tellp())));
+	file.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(sizeof(s_scene_group) * table.size()));
+	file.write(padding, static_cast<std::streamsize>(header.transforms_offset - static_cast<uint64_t>(file.tellp())));
+	file.write(reinterpret_cast<const char*>(arrays.data()), static_cast<std::streamsize>(sizeof(float) * arrays.size()));
+	return static_cast<bool>(file);
+}
+
+// == Private Methods ==
+const float* c_scene::get_array(int array) const
+{
+	return reinterpret_cast<const float*>(data_ + header_->transforms_offset + get_array_stride(header_->object_count) * array);
+}
@@ -0,0 +1,168 @@
+﻿// /***********************************************************************
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+// (c) 2024 Media Design School
+// File Name : c_scene.h
+// Description : Class that writes scenes to a binary file and bulk loads them back into transform stores.
+// Author : Foster Rae
+// Mail : Foster.Rae@mds.ac.nz
+// ************************************************************************/
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+#include "Dependencies/GLM/glm.hpp"
+#include "c_mapped_file.h"
+
+class c_transform_store;
+
+/**
+ * @brief The header at the start of a scene (.scene) file.
+ * @param magic Always "CSCN".
+ * @param version The format version, files with another version are rejected.
+ * @param object_count The number of objects, the length of each transform array.
+ * @param group_count The number of s_scene_group entries.
+ * @param mesh_count The number of mesh names in the strings.
+ * @param texture_count The number of texture paths in the strings, after the mesh names.
+ * @param strings_offset The byte offset of the null terminated mesh names and texture paths.
+ * @param groups_offset The byte offset of the group table.
+ * @param transforms_offset The byte offset of the transform arrays, see c_scene::transform_array_count.
+ */
+struct s_scene_header {
+	char magic[4];
+	uint32_t version;
+	uint32_t object_count;
+	uint32_t group_count;
+	uint32_t mesh_count;
+	uint32_t texture_count;
+	uint64_t strings_offset;
+	uint64_t groups_offset;
+	uint64_t transforms_offset;
+};
+
+/**
+ * @brief A run of objects that share a mesh, a texture and flags.
+ * @param mesh The index of the mesh name.
+ * @param texture The index of the texture path.
+ * @param flags c_scene::static_flag for objects that never move.
+ * @param first The first object of the run.
+ * @param count The number of objects in the run.
+ * @param local_extents The half extents of the mesh's bounding box.
+ */
+struct s_scene_group {
+	uint32_t mesh;
+	uint32_t texture;
+	uint32_t flags;
+	uint32_t first;
+	uint32_t count;
+	float local_extents[3];
+};
+
+/**
+ * @brief Objects to write to a scene, as handles into a transform store.
+ * @param transforms The store holding the objects' transforms.
+ * @param handles The objects to write.
+ * @param mesh The index of the mesh name.
+ * @param texture The index of the texture path.
+ * @param flags c_scene::static_flag for objects that never move.
+ * @param local_extents The half extents of the mesh's bounding box.
+ */
+struct s_scene_export_group {
+	const c_transform_store* transforms;
+	std::vector<int> handles;
+	uint32_t mesh;
+	uint32_t texture;
+	uint32_t flags;
+	glm::vec3 local_extents = glm::vec3(0.5f);
+};
+
+/**
+ * @class c_scene
+ * @brief Reads a scene file in place and loads its objects into transform stores a group at a time.
+ * @note The transforms are stored as one array per component, the same layout as c_transform_store, so loading a
+ *       group is a copy of each array with no per-object allocation. Objects are grouped by mesh, texture and flags.
+ *       Read from the mounted asset pack if it has the file, otherwise the file is mapped.
+ */
+class c_scene
+{
+public:
+
+	// == Constructors and Destructors ==
+	c_scene() = default;
+	~c_scene() = default;
+	c_scene(const c_scene&) = delete;            // Owns the mapping, no copying.
+	c_scene& operator=(const c_scene&) = delete;
+
+	// == Public Methods ==
+	/**
+	 * @brief Opens a scene file and checks it, closing any scene that was already open.
+	 *
+	 * @param file_path The file path to the scene.
+	 * @return True if the scene is valid.
+	 */
+	bool open(const char* file_path);
+	/**
+	 * @brief Closes the scene. Does nothing if no scene is open.
+	 */
+	void close();
+	/**
+	 * @brief Appends the transforms of a group to a store.
+	 *
+	 * @param group The index of the group.
+	 * @param transforms The store to add them to.
+	 * @return The handle of the group's first object, the rest follow it. -1 if the group doesn't exist.
+	 */
+	int load_group(size_t group, c_transform_store& transforms) const;
+	/**
+	 * @brief Writes a scene file.
+	 *
+	 * @param file_path The file to write.
+	 * @param groups The objects to write, each group keeps its order.
+	 * @param mesh_names The names of the meshes the groups refer to.
+	 * @param texture_paths The paths of the textures the groups refer to.
+	 * @return True if the file was written.
+	 */
+	static bool write(const char* file_path, const std::vector<s_scene_export_group>& groups, const std::vector<std::string>& mesh_names,
+		const std::vector<std::string>& texture_paths);
+
+	// == Accessors ==
+	bool is_open() const { return header_ != nullptr; }
+	size_t get_object_count() const { return (header_ != nullptr) ? header_->object_count : 0; }
+	std::span<const s_scene_group> get_groups() const { return groups_; }
+	const std::vector<std::string>& get_mesh_names() const { return mesh_names_; }
+	const std::vector<std::string>& get_texture_paths() const { return texture_paths_; }
+
+	// == Constants ==
+	static constexpr char file_extension[] = ".scene";
+	static constexpr uint32_t file_version = 1;
+	static constexpr uint64_t array_alignment = 16; // Each transform array starts aligned for SIMD reads.
+	static constexpr int transform_array_count = 7; // Position X, Y, Z, rotation, scale X, Y, Z.
+	static constexpr uint32_t static_flag = 1;
+
+private:
+
+	// == Private Methods ==
+	/**
+	 * @brief Gets one of the transform arrays.
+	 * @param array The array, in the order of transform_array_count.
+	 * @return The first value of the array.
+	 */
+	const float* get_array(int array) const;
+	/**
+	 * @brief Gets the distance between the transform arrays in the file.
+	 * @param object_count The number of objects.
+	 * @return The size of one array rounded up to array_alignment.
+	 */
+	static uint64_t get_array_stride(uint64_t object_count) { return (object_count * sizeof(float) + array_alignment - 1) / array_alignment * array_alignment; }
+
+	// == Private Members ==
+	c_mapped_file file_;                          // Unused if the scene is in the asset pack.
+	const unsigned char* data_ = nullptr;         // The file contents.
+	const s_scene_header* header_ = nullptr;      // Points into data_.
+	std::span<const s_scene_group> groups_;       // Points into data_.
+	std::vector<std::string> mesh_names_;
+	std::vector<std::string> texture_paths_;
+};
@@ -1,8 +1,20 @@
-#include "c_shader_loader.h"
+﻿#include "c_shader_loader.h"
+#include "c_asset_pack.h"
+#include "c_gl_state.h"
+#include<chrono>
+#include<cstdio>
+#include<filesystem>
 #include<iostream>
 #include<fstream>
 #include<vector>
 
+// == Static Members ==
+std::unordered_map<GLuint, std::vector<s_uniform_info>> c_shader_loader::uniform_tables_;
+s_program_cache_stats c_shader_loader::cache_stats_;
+std::unordered_map<int, c_shader_loader::s_pending_program> c_shader_loader::pending_programs_;
+int c_shader_loader::next_program_handle_ = 1;
+bool c_shader_loader::parallel_compile_supported_ = false;
+
 // == Constructors / Destructors ==
 c_shader_loader::c_shader_loader() = default;
 c_shader_loader::~c_shader_loader() = default;
@@ -10,45 +22,163 @@ c_shader_loader::~c_shader_loader() = default;
 // == Public Methods ==
 GLuint c_shader_loader::create_program(const char* vertex_shader_filename, const char* fragment_shader_filename)
 {
-	// Create the shaders from the filepath.
-	GLuint vertex_shader = create_shader(GL_VERTEX_SHADER, vertex_shader_filename);
-	GLuint fragment_shader = create_shader(GL_FRAGMENT_SHADER, fragment_shader_filename);
+	// Submit and wait straight away.
+	return finish_program(submit_program(vertex_shader_filename, fragment_shader_filename));
+}
 
-	// Create the program handle, attach the shaders and link it.
-	GLuint program = glCreateProgram();			// create a program object.
-	glAttachShader(program, vertex_shader);		// attach the vertex shader.
-	glAttachShader(program, fragment_shader);   // attach the fragment shader.
-	glLinkProgram(program); 					// link the shaders into a complete program.
+int c_shader_loader::submit_program(const char* vertex_shader_filename, const char* fragment_shader_filename)
+{
+	const auto start_time = std::chrono::high_resolution_clock::now();
+	enable_parallel_compile();
+
+	// Read the shader code.
+	s_pending_program pending;
+	pending.vertex_shader_filename = vertex_shader_filename;
+	pending.fragment_shader_filename = fragment_shader_filename;
+	pending.vertex_code = read_shader_file(vertex_shader_filename);
+	pending.fragment_code = read_shader_file(fragment_shader_filename);
+
+	// Try the binary cache first, fall back to compiling from source.
+	pending.cache_path = get_program_cache_path(pending.vertex_code, pending.fragment_code);
+	pending.program = load_program_binary(pending.cache_path);
+	pending.from_cache = (pending.program != 0);
+	if (!pending.from_cache)
+	{
+		start_compile(pending);
+	}
 
-	// Check for linking errors.
+	// Only the time spent here blocks the caller, the driver carries on in the background.
+	pending.main_thread_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start_time).count();
+	const int handle = next_program_handle_++;
+	pending_programs_[handle] = std::move(pending);
+	return handle;
+}
+
+bool c_shader_loader::is_program_ready(int handle)
+{
+	auto it = pending_programs_.find(handle);
+	if (it == pending_programs_.end())
+	{
+		return true; // Unknown or already finished, finish_program won't block.
+	}
+
+	// Without the extension there is no way to ask, so report ready and let finish_program block.
+	if (!parallel_compile_supported_)
+	{
+		return true;
+	}
+	GLint completed = GL_FALSE;
+	glGetProgramiv(it->second.program, GL_COMPLETION_STATUS_KHR, &completed);
+	return completed == GL_TRUE;
+}
+
+GLuint c_shader_loader::finish_program(int handle)
+{
+	auto it = pending_programs_.find(handle);
+	if (it == pending_programs_.end())
+	{
+		return 0;
+	}
+	s_pending_program pending = std::move(it->second);
+	pending_programs_.erase(it);
+	const auto start_time = std::chrono::high_resolution_clock::now();
+	const std::string program_name = pending.vertex_shader_filename + " + " + pending.fragment_shader_filename;
+
+	// Check the link status, this waits for the driver if it hasn't finished yet.
 	int link_result = 0;
-	glGetProgramiv(program, GL_LINK_STATUS, &link_result);
+	glGetProgramiv(pending.program, GL_LINK_STATUS, &link_result);
+	if (link_result == GL_FALSE && pending.from_cache)
+	{
+		// The driver rejected the cached binary (e.g. after a driver update), compile from source instead.
+		glDeleteProgram(pending.program);
+		cache_stats_.rejected++;
+		pending.from_cache = false;
+		start_compile(pending);
+		glGetProgramiv(pending.program, GL_LINK_STATUS, &link_result);
+	}
 	if (link_result == GL_FALSE)
 	{
-		// Get error details and print them.
-		std::string programName = vertex_shader_filename + *fragment_shader_filename;
-		print_error_details(false, program, programName.c_str());
+		// Get error details and print them, a failed compile shows up as a failed link.
+		print_compile_errors(pending);
+		print_error_details(false, pending.program, program_name.c_str());
+		glDeleteShader(pending.vertex_shader);
+		glDeleteShader(pending.fragment_shader);
+		glDeleteProgram(pending.program);
 		return 0;
 	}
 
 	// Detach the shaders and delete them.
-	glDeleteShader(vertex_shader); 	    // delete the vertex shader.
-	glDeleteShader(fragment_shader);    // delete the fragment shader.
+	glDeleteShader(pending.vertex_shader); 	    // delete the vertex shader.
+	glDeleteShader(pending.fragment_shader);    // delete the fragment shader.
+
+	// Save freshly linked programs for the next launch.
+	if (!pending.from_cache)
+	{
+		save_program_binary(pending.program, pending.cache_path);
+	}
+
+	// Reflect the active uniforms once so setters never query the driver.
+	reflect_uniforms(pending.program);
 
-	return program; 				    // return the program ID.
+	// Record the startup metrics.
+	const double elapsed_ms = pending.main_thread_ms + std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start_time).count();
+	(pending.from_cache) ? cache_stats_.hits++ : cache_stats_.misses++;
+	cache_stats_.load_time_ms += elapsed_ms;
+	std::cout << "Program " << program_name << ": " << (pending.from_cache ? "cache hit" : "cache miss") << " (" << elapsed_ms << " ms on the main thread)" << '\n';
+
+	return pending.program; 				    // return the program ID.
+}
+
+void c_shader_loader::delete_program(GLuint program)
+{
+	uniform_tables_.erase(program);
+	c_gl_state::forget_program(program);
+	glDeleteProgram(program);
+}
+
+GLint c_shader_loader::get_uniform_location(GLuint program, const std::string& name)
+{
+	// Search the reflection table, only a handful of uniforms per program so a linear search is fine.
+	for (const s_uniform_info& uniform : get_uniforms(program))
+	{
+		if (uniform.name == name)
+		{
+			return uniform.location;
+		}
+	}
+	return -1; // Not active, the setters ignore -1 the same way OpenGL does.
+}
+
+const std::vector<s_uniform_info>& c_shader_loader::get_uniforms(GLuint program)
+{
+	static const std::vector<s_uniform_info> empty;
+	auto it = uniform_tables_.find(program);
+	return (it != uniform_tables_.end()) ? it->second : empty;
 }
 
 void c_shader_loader::set_mat_4(GLuint program, const std::string& name, const glm::mat4& mat)
 {
-	glUniformMatrix4fv(glGetUniformLocation(program, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	set_mat_4(get_uniform_location(program, name), mat);
 }
 
 // == Private Methods ==
-GLuint c_shader_loader::create_shader(GLenum shader_type, const char* shader_name)
+void c_shader_loader::start_compile(s_pending_program& pending)
 {
-	// Create shader object and populate with shader code.
-	std::string shader_code = read_shader_file(shader_name);  		     // Save the shader code as a string.
+	// Create the shaders from the code.
+	pending.vertex_shader = create_shader(GL_VERTEX_SHADER, pending.vertex_code);
+	pending.fragment_shader = create_shader(GL_FRAGMENT_SHADER, pending.fragment_code);
+
+	// Create the program handle, attach the shaders and link it.
+	// The statuses aren't checked here so the driver can compile in the background, see finish_program.
+	pending.program = glCreateProgram();			// create a program object.
+	glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE); // let the binary be saved to the cache.
+	glAttachShader(pending.program, pending.vertex_shader);		// attach the vertex shader.
+	glAttachShader(pending.program, pending.fragment_shader);   // attach the fragment shader.
+	glLinkProgram(pending.program); 					// link the shaders into a complete program.
+}
 
+GLuint c_shader_loader::create_shader(GLenum shader_type, const std::string& shader_code)
+{
 	// Create the shader ID and create pointers for source code string and length.
 	GLuint shader_id = glCreateShader(shader_type);					     // Create a shader object with the enum 'shader_type' provided.
 	const char* p_shader_code = shader_code.c_str(); 				     // Create a pointer to the shader code, convert the string to a char array.
@@ -58,21 +188,63 @@ GLuint c_shader_loader::create_shader(GLenum shader_type, const char* shader_nam
 	glShaderSource(shader_id, 1, &p_shader_code, &code_length);	 // Populate the shader object with the shader code.
 	glCompileShader(shader_id);                                          // Compile the shader.
 
-	// Check for compilation errors.
-	int compile_result = 0;
-	glGetShaderiv(shader_id, GL_COMPILE_STATUS, &compile_result);
-	if (compile_result == GL_FALSE)
+	return shader_id; // Return the GLuint ID of the shader, the compile status is checked in finish_program.
+}
+
+void c_shader_loader::print_compile_errors(const s_pending_program& pending)
+{
+	// Cached programs have no shaders.
+	const GLuint shaders[] = { pending.vertex_shader, pending.fragment_shader };
+	const std::string* names[] = { &pending.vertex_shader_filename, &pending.fragment_shader_filename };
+	for (int i = 0; i < 2; i++)
 	{
-		// Get error details and print them.
-		print_error_details(true, shader_id, shader_name);
-		return 0;
+		if (shaders[i] == 0)
+		{
+			continue;
+		}
+
+		// Check for compilation errors.
+		int compile_result = 0;
+		glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &compile_result);
+		if (compile_result == GL_FALSE)
+		{
+			// Get error details and print them.
+			print_error_details(true, shaders[i], names[i]->c_str());
+		}
 	}
+}
 
-	return shader_id; // Return the GLuint ID of the compiled shader.
+void c_shader_loader::enable_parallel_compile()
+{
+	static bool initialised = false;
+	if (initialised)
+	{
+		return;
+	}
+	initialised = true;
+
+	// Let the driver pick how many compiler threads to use. (0xFFFFFFFF = implementation maximum)
+	if (GLEW_KHR_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+		parallel_compile_supported_ = true;
+	}
+	else if (GLEW_ARB_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFFu);
+		parallel_compile_supported_ = true;
+	}
 }
 
 std::string c_shader_loader::read_shader_file(const char* filename)
 {
+	// Take the source from the mounted asset pack if it has it, no file to open.
+	const std::span<const unsigned char> packed = c_asset_pack::find_mounted(filename);
+	if (!packed.empty())
+	{
+		return std::string(reinterpret_cast<const char*>(packed.data()), packed.size());
+	}
+
 	// Open the file and read the contents into a string.
 	std::ifstream file(filename, std::ios::in);
 	std::string shader_code;
@@ -107,4 +279,151 @@ void c_shader_loader::print_error_details(bool is_shader, GLuint id, const char*
 	                                                                                                  log.data());
 	std::cout << "Error compiling " << ((is_shader == true) ? "shader" : "program") << ": " << name << '\n';
 	std::cout << log.data() << '\n';
+}
+
+void c_shader_loader::reflect_uniforms(GLuint program)
+{
+	std::vector<s_uniform_info>& uniforms = uniform_tables_[program];
+	uniforms.clear();
+
+	// Get the number of active uniforms.
+	GLint uniform_count = 0;
+	glGetProgramInterfaceiv(program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniform_count);
+
+	// Query the properties of each uniform.
+	const GLenum properties[] = { GL_NAME_LENGTH, GL_TYPE, GL_LOCATION, GL_ARRAY_SIZE, GL_BLOCK_INDEX };
+	constexpr GLsizei property_count = sizeof(properties) / sizeof(properties[0]);
+	for (GLint i = 0; i < uniform_count; i++)
+	{
+		GLint values[property_count];
+		glGetProgramResourceiv(program, GL_UNIFORM, i, property_count, properties, property_count, nullptr, values);
+
+		// Skip uniform block members, they have no location.
+		if (values[4] != -1)
+		{
+			continue;
+		}
+
+		// Get the name, the length includes the null terminator.
+		std::string name(values[0], '\0');
+		glGetProgramResourceName(program, GL_UNIFORM, i, values[0], nullptr, &name[0]);
+		name.resize(values[0] - 1);
+
+		// Store arrays under their base name so "name" and "name[0]" both resolve.
+		const size_t array_suffix = name.rfind("[0]");
+		if (array_suffix != std::string::npos && array_suffix == name.size() - 3)
+		{
+			name.resize(array_suffix);
+		}
+
+		uniforms.push_back({ name, values[2], static_cast<GLenum>(values[1]), values[3] });
+	}
+}
+
+std::string c_shader_loader::get_program_cache_path(const std::string& vertex_code, const std::string& fragment_code)
+{
+	// Key on the source and the driver, a binary is only valid for the driver that made it.
+	const char* driver_strings[] = {
+		reinterpret_cast<const char*>(glGetString(GL_VENDOR)),
+		reinterpret_cast<const char*>(glGetString(GL_RENDERER)),
+		reinterpret_cast<const char*>(glGetString(GL_VERSION))
+	};
+
+	uint64_t hash = hash_string(fnv_offset_basis, vertex_code);
+	hash = hash_string(hash, fragment_code);
+	for (const char* driver_string : driver_strings)
+	{
+		hash = hash_string(hash, (driver_string != nullptr) ? driver_string : "");
+	}
+
+	// Write the hash as hex for the file name.
+	char file_name[32];
+	std::snprintf(file_name, sizeof(file_name), "%016llx.bin", static_cast<unsigned long long>(hash));
+	return std::string(program_cache_directory) + "/" + file_name;
+}
+
+GLuint c_shader_loader::load_program_binary(const std::string& cache_path)
+{
+	// Open the cached binary.
+	std::ifstream file(cache_path, std::ios::in | std::ios::binary);
+	if (!file.good())
+	{
+		return 0;
+	}
+
+	// Read the header then the binary.
+	s_program_binary_header header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != program_binary_magic)
+	{
+		return 0;
+	}
+
+	// The length must match the rest of the file, a truncated or corrupt cache falls back to compiling from source.
+	file.seekg(0, std::ios::end);
+	const std::streamoff binary_size = static_cast<std::streamoff>(file.tellg()) - static_cast<std::streamoff>(sizeof(header));
+	if (header.length == 0 || binary_size != static_cast<std::streamoff>(header.length))
+	{
+		std::cout << "Program cache is truncated or corrupt, compiling from source: " << cache_path << '\n';
+		return 0;
+	}
+	file.seekg(sizeof(header), std::ios::beg);
+	std::vector<char> binary(header.length);
+	if (!file.read(binary.data(), header.length))
+	{
+		return 0;
+	}
+
+	// Give it to the driver. It rejects binaries from a different driver version, finish_program checks for that.
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(header.length));
+	return program;
+}
+
+void c_shader_loader::save_program_binary(GLuint program, const std::string& cache_path)
+{
+	// Some drivers don't support program binaries.
+	GLint format_count = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+	if (format_count == 0)
+	{
+		return;
+	}
+
+	// Get the binary from the driver.
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+	{
+		return;
+	}
+	s_program_binary_header header = { program_binary_magic, 0, 0 };
+	std::vector<char> binary(length);
+	glGetProgramBinary(program, length, nullptr, &header.format, binary.data());
+	header.length = static_cast<uint32_t>(length);
+
+	// Write it to the cache. A failed write just means a miss next launch.
+	std::error_code error;
+	std::filesystem::create_directories(program_cache_directory, error);
+	std::ofstream file(cache_path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.good())
+	{
+		std::cout << "Cannot write program cache: " << cache_path << '\n';
+		return;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(binary.data(), length);
+}
+
+uint64_t c_shader_loader::hash_string(uint64_t hash, const std::string& text)
+{
+	// FNV-1a.
+	for (unsigned char c : text)
+	{
+		hash ^= c;
+		hash *= 1099511628211ull; // FNV prime.
+	}
+	// Hash a separator so "ab" + "c" and "a" + "bc" differ.
+	hash ^= 0xFFu;
+	hash *= 1099511628211ull;
+	return hash;
 }
\ No newline at end of file
@@ -1,4 +1,4 @@
-/***********************************************************************
+﻿/***********************************************************************
 Bachelor of Software Engineering
 Media Design School
 Auckland
@@ -10,11 +10,43 @@ Author : Foster Rae
 Mail : Foster.Rae@mds.ac.nz
 ************************************************************************/
 #pragma once
+#include <cstdint>
 #include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include "Dependencies/GLM/glm.hpp"
 #include "Dependencies/GLEW/glew.h"
 #include "Dependencies/GLFW/glfw3.h"
 
+/**
+ * @brief Reflection info for one active uniform of a program.
+ * @param name The name of the uniform. Arrays are stored without the "[0]" suffix.
+ * @param location The location of the uniform, used as the handle for the setters.
+ * @param type The GLSL type of the uniform. (GL_FLOAT_MAT4, GL_SAMPLER_2D, etc.)
+ * @param array_size The number of elements, 1 if not an array.
+ */
+struct s_uniform_info {
+	std::string name;
+	GLint location;
+	GLenum type;
+	GLint array_size;
+};
+
+/**
+ * @brief Startup metrics for the program binary cache.
+ * @param hits Programs loaded from a cached binary.
+ * @param misses Programs compiled and linked from source.
+ * @param rejected Cached binaries the driver refused, these are also counted as misses.
+ * @param load_time_ms Total time spent creating programs in milliseconds.
+ */
+struct s_program_cache_stats {
+	int hits = 0;
+	int misses = 0;
+	int rejected = 0;
+	double load_time_ms = 0.0;
+};
+
 /**
  * @class c_shader_loader
  * @brief Handles the loading and compiling of shaders.
@@ -32,10 +64,68 @@ public:
 	 * @param vertex_shader_filename The file path to the vertex shader.
 	 * @param fragment_shader_filename The file path to the fragment shader.
 	 * @return A GLuint to the created shader program.
+	 * @note Linked programs are cached on disk with glGetProgramBinary and reloaded on later launches.
+	 * @note The active uniforms are reflected into a table once here, see get_uniform_location.
+	 * @note Blocks until the program is linked, use submit_program to keep working while the driver compiles.
 	 */
 	static GLuint create_program(const char* vertex_shader_filename, const char* fragment_shader_filename);
+	/**
+	 * @brief Starts compiling and linking a program without waiting for the result.
+	 * @note With KHR/ARB_parallel_shader_compile the driver compiles on its own threads, so other
+	 *       setup (texture loading, scene building) can run before finish_program is called.
+	 *
+	 * @param vertex_shader_filename The file path to the vertex shader.
+	 * @param fragment_shader_filename The file path to the fragment shader.
+	 * @return A handle to pass to is_program_ready and finish_program.
+	 */
+	static int submit_program(const char* vertex_shader_filename, const char* fragment_shader_filename);
+	/**
+	 * @brief Checks whether a submitted program has finished compiling and linking.
+	 * @note Always true without the parallel compile extension, finish_program then blocks instead.
+	 *
+	 * @param handle The handle returned by submit_program.
+	 * @return True if finish_program won't block.
+	 */
+	static bool is_program_ready(int handle);
+	/**
+	 * @brief Checks a submitted program's status, prints any errors, caches and reflects it.
+	 * @note Blocks if the driver hasn't finished. Each handle can only be finished once.
+	 *
+	 * @param handle The handle returned by submit_program.
+	 * @return A GLuint to the created shader program, or 0 if it failed.
+	 */
+	static GLuint finish_program(int handle);
+	/**
+	 * @brief Deletes a shader program and its uniform table.
+	 *
+	 * @param program The shader program to delete.
+	 */
+	static void delete_program(GLuint program);
+	/**
+	 * @brief Gets the location of a uniform from the program's reflection table.
+	 * @note Resolve once at setup and keep the handle, this does a string lookup but no driver query.
+	 *
+	 * @param program The shader program to look in.
+	 * @param name The name of the uniform variable.
+	 * @return The location of the uniform, or -1 if it is not active.
+	 */
+	static GLint get_uniform_location(GLuint program, const std::string& name);
+	/**
+	 * @brief Gets the reflected uniforms of a program.
+	 *
+	 * @param program The shader program.
+	 * @return The active uniforms, empty if the program was not created by the loader.
+	 */
+	static const std::vector<s_uniform_info>& get_uniforms(GLuint program);
+	/**
+	 * @brief Gets the program binary cache hits, misses and load time so far.
+	 *
+	 * @return The cache metrics.
+	 */
+	static const s_program_cache_stats& get_cache_stats() { return cache_stats_; }
 	/**
 	 * @brief Sets a mat4 value in the shader program.
+	 * @note Looks the name up in the reflection table, prefer the location overload in per-draw code.
 	 *
 	 * @param program The shader program to set the value in.
 	 * @param name The name of the uniform variable.
@@ -43,23 +133,72 @@ public:
 	 */
 	static void set_mat_4(GLuint program, const std::string& name, const glm::mat4& mat);
 
+	// == Handle Setters ==
+	// Set a uniform of the program in use by its pre-resolved location. Ignored if the location is -1.
+	static void set_mat_4(GLint location, const glm::mat4& mat) { glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]); }
+	static void set_int(GLint location, int value) { glUniform1i(location, value); }
+	static void set_float(GLint location, float value) { glUniform1f(location, value); }
+
 private:
 
 	// == Constructors / Destructors ==
 	c_shader_loader();  // Default constructor.
 	~c_shader_loader(); // Default destructor.
 
+	/**
+	 * @brief A program that has been submitted but not finished.
+	 * @param vertex_shader_filename The file path to the vertex shader, for error messages.
+	 * @param fragment_shader_filename The file path to the fragment shader, for error messages.
+	 * @param vertex_code The vertex shader code, kept to recompile if the cached binary is rejected.
+	 * @param fragment_code The fragment shader code.
+	 * @param cache_path The path of the program's cache file.
+	 * @param program The program ID.
+	 * @param vertex_shader The vertex shader ID, 0 if loaded from the cache.
+	 * @param fragment_shader The fragment shader ID, 0 if loaded from the cache.
+	 * @param from_cache Whether the program was created from a cached binary.
+	 * @param main_thread_ms Time spent in submit_program in milliseconds.
+	 */
+	struct s_pending_program {
+		std::string vertex_shader_filename;
+		std::string fragment_shader_filename;
+		std::string vertex_code;
+		std::string fragment_code;
+		std::string cache_path;
+		GLuint program = 0;
+		GLuint vertex_shader = 0;
+		GLuint fragment_shader = 0;
+		bool from_cache = false;
+		double main_thread_ms = 0.0;
+	};
+
 	// == Private Methods ==
 	/**
-	 * @brief Creates a shader object from the shader type and file path provided.
+	 * @brief Compiles the shaders and links them into a program without checking the status.
+	 *
+	 * @param pending The pending program, the shader and program IDs are written to it.
+	 */
+	static void start_compile(s_pending_program& pending);
+	/**
+	 * @brief Creates a shader object from the shader type and code provided and starts compiling it.
 	 *
 	 * @param shader_type The type of shader to create.
-	 * @param shader_name The file path to the shader.
+	 * @param shader_code The shader code.
 	 * @return The shader ID.
 	 */
-	static GLuint create_shader(GLenum shader_type, const char* shader_name);
+	static GLuint create_shader(GLenum shader_type, const std::string& shader_code);
+	/**
+	 * @brief Prints the compile errors of a pending program's shaders.
+	 *
+	 * @param pending The pending program.
+	 */
+	static void print_compile_errors(const s_pending_program& pending);
+	/**
+	 * @brief Tells the driver to compile on its own threads if KHR/ARB_parallel_shader_compile is supported.
+	 */
+	static void enable_parallel_compile();
 	/**
 	 * @brief Reads the shader file and returns the shader code as a string.
+	 * @note Read from the mounted asset pack if it has the file.
 	 *
 	 * @param filename The file path to the shader.
 	 * @return The shader code as a string.
@@ -73,4 +212,65 @@ private:
 	 * @param name The name of the shader or program.
 	 */
 	static void print_error_details(bool is_shader, GLuint id, const char* name);
+	/**
+	 * @brief Queries every active uniform of a program and stores it in the uniform table.
+	 *
+	 * @param program The linked shader program.
+	 */
+	static void reflect_uniforms(GLuint program);
+
+	// == Program Binary Cache ==
+	/**
+	 * @brief The header written before a cached program binary.
+	 * @param magic Identifies the file as a program binary.
+	 * @param format The binary format returned by the driver.
+	 * @param length The size of the binary in bytes.
+	 */
+	struct s_program_binary_header {
+		uint32_t magic;
+		GLenum format;
+		uint32_t length;
+	};
+	/**
+	 * @brief Gets the cache file path for a program, keyed on a hash of the source and the driver.
+	 *
+	 * @param vertex_code The vertex shader code.
+	 * @param fragment_code The fragment shader code.
+	 * @return The path of the cache file.
+	 */
+	static std::string get_program_cache_path(const std::string& vertex_code, const std::string& fragment_code);
+	/**
+	 * @brief Creates a program from a cached binary.
+	 *
+	 * @param cache_path The path of the cache file.
+	 * @return The program ID, or 0 if there is no cached binary. The link status is checked in finish_program.
+	 */
+	static GLuint load_program_binary(const std::string& cache_path);
+	/**
+	 * @brief Writes a linked program's binary to the cache.
+	 *
+	 * @param program The linked program.
+	 * @param cache_path The path of the cache file.
+	 */
+	static void save_program_binary(GLuint program, const std::string& cache_path);
+	/**
+	 * @brief Hashes a string with FNV-1a.
+	 *
+	 * @param hash The hash to continue from.
+	 * @param text The string to hash.
+	 * @return The new hash.
+	 */
+	static uint64_t hash_string(uint64_t hash, const std::string& text);
+
+	// == Constants ==
+	static constexpr const char* program_cache_directory = "ShaderCache"; // Folder the program binaries are written to.
+	static constexpr uint32_t program_binary_magic = 0x50524F47;         // "PROG"
+	static constexpr uint64_t fnv_offset_basis = 14695981039346656037ull;
+
+	// == Private Members ==
+	static std::unordered_map<GLuint, std::vector<s_uniform_info>> uniform_tables_; // Program ID -> active uniforms.
+	static s_program_cache_stats cache_stats_;                                      // Binary cache metrics.
+	static std::unordered_map<int, s_pending_program> pending_programs_;           // Handle -> submitted program.
+	static int next_program_handle_;
+	static bool parallel_compile_supported_;                                        // KHR or ARB_parallel_shader_compile.
 };
@@ -0,0 +1,101 @@
+﻿#include "c_skyline_packer.h"
+#include <algorithm>
+#include <climits>
+
+c_skyline_packer::c_skyline_packer(int width, int height)
+	: width_(width)
+	, height_(height)
+{
+	// One flat run along the bottom.
+	skyline_.push_back({ 0, 0, width });
+}
+
+// == Public Methods ==
+bool c_skyline_packer::pack(int width, int height, int& x, int& y)
+{
+	// Pick the spot where the top of the rectangle is lowest, then the narrowest run to waste less.
+	size_t best_index = skyline_.size();
+	int best_top = INT_MAX;
+	int best_width = INT_MAX;
+	for (size_t i = 0; i < skyline_.size(); i++)
+	{
+		const int bottom = fit(i, width, height);
+		if (bottom < 0)
+		{
+			continue;
+		}
+		const int top = bottom + height;
+		if (top < best_top || (top == best_top && skyline_[i].width < best_width))
+		{
+			best_index = i;
+			best_top = top;
+			best_width = skyline_[i].width;
+		}
+	}
+	if (best_index == skyline_.size())
+	{
+		return false;
+	}
+
+	x = skyline_[best_index].x;
+	y = best_top - height;
+
+	// Raise the skyline under the rectangle, trimming or removing the runs it covers.
+	skyline_.insert(skyline_.begin() + static_cast<std::ptrdiff_t>(best_index), { x, best_top, width });
+	for (size_t i = best_index + 1; i < skyline_.size();)
+	{
+		s_segment& segment = skyline_[i];
+		const int covered = (x + width) - segment.x;
+		if (covered <= 0)
+		{
+			break;
+		}
+		if (covered < segment.width)
+		{
+			segment.x += covered;
+			segment.width -= covered;
+			break;
+		}
+		skyline_.erase(skyline_.begin() + static_cast<std::ptrdiff_t>(i));
+	}
+
+	// Merge neighbouring runs at the same height.
+	for (size_t i = 0; i + 1 < skyline_.size();)
+	{
+		if (skyline_[i].y == skyline_[i + 1].y)
+		{
+			skyline_[i].width += skyline_[i + 1].width;
+			skyline_.erase(skyline_.begin() + static_cast<std::ptrdiff_t>(i) + 1);
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	used_area_ += static_cast<long long>(width) * height;
+	return true;
+}
+
+// == Private Methods ==
+int c_skyline_packer::fit(size_t index, int width, int height) const
+{
+	if (skyline_[index].x + width > width_)
+	{
+		return -1;
+	}
+
+	// The rectangle rests on the highest run under it.
+	int bottom = 0;
+	int width_left = width;
+	for (size_t i = index; width_left > 0; i++)
+	{
+		bottom = std::max(bottom, skyline_[i].y);
+		if (bottom + height > height_)
+		{
+			return -1;
+		}
+		width_left -= skyline_[i].width;
+	}
+	return bottom;
+}
@@ -0,0 +1,80 @@
+﻿// /***********************************************************************
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+// (c) 2024 Media Design School
+// File Name : c_skyline_packer.h
+// Description : Class that packs rectangles into a fixed size area with the skyline bottom-left heuristic.
+// Author : Foster Rae
+// Mail : Foster.Rae@mds.ac.nz
+// ************************************************************************/
+#pragma once
+#include <cstddef>
+#include <vector>
+
+/**
+ * @class c_skyline_packer
+ * @brief Packs rectangles into an area by tracking the top edge of everything placed so far (the skyline).
+ * @note Each rectangle goes where its top ends up lowest, so the gaps under the skyline stay small.
+ *       Packing tallest first gives the tightest results.
+ */
+class c_skyline_packer
+{
+public:
+
+	// == Constructors and Destructors ==
+	/**
+	 * @brief Construct an empty packer.
+	 * @param width The width of the area.
+	 * @param height The height of the area.
+	 */
+	c_skyline_packer(int width, int height);
+	~c_skyline_packer() = default;
+
+	// == Public Methods ==
+	/**
+	 * @brief Places a rectangle.
+	 *
+	 * @param width The width of the rectangle.
+	 * @param height The height of the rectangle.
+	 * @param x The left edge of the placed rectangle.
+	 * @param y The bottom edge of the placed rectangle.
+	 * @return True if it was placed, false if there is no room left for it.
+	 */
+	bool pack(int width, int height, int& x, int& y);
+
+	// == Accessors ==
+	float get_occupancy() const { return static_cast<float>(used_area_) / (static_cast<float>(width_) * static_cast<float>(height_)); }
+
+private:
+
+	/**
+	 * @brief A flat run of the skyline.
+	 * @param x The left edge of the run.
+	 * @param y The height of the skyline along the run.
+	 * @param width The width of the run.
+	 */
+	struct s_segment {
+		int x;
+		int y;
+		int width;
+	};
+
+	// == Private Methods ==
+	/**
+	 * @brief Finds where a rectangle would sit if its left edge starts at a segment.
+	 *
+	 * @param index The segment the rectangle starts on.
+	 * @param width The width of the rectangle.
+	 * @param height The height of the rectangle.
+	 * @return The bottom edge of the rectangle, or -1 if it doesn't fit there.
+	 */
+	int fit(size_t index, int width, int height) const;
+
+	// == Private Members ==
+	std::vector<s_segment> skyline_; // Left to right, covering the whole width.
+	int width_;
+	int height_;
+	long long used_area_ = 0;
+};
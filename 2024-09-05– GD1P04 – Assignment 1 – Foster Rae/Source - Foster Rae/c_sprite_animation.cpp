@@ -0,0 +1,48 @@
+﻿#include "c_sprite_animation.h"
+
+c_sprite_animation::c_sprite_animation(const c_sprite_atlas& atlas, int sequence, float frames_per_second, bool looping)
+	: frames_(&atlas.get_frames(sequence))
+	, frame_duration_(1.0f / frames_per_second)
+	, looping_(looping)
+{
+}
+
+// == Public Methods ==
+void c_sprite_animation::update(float delta_time)
+{
+	if (finished_ || frames_->empty())
+	{
+		return;
+	}
+
+	time_ += delta_time;
+	if (time_ < frame_duration_)
+	{
+		return;
+	}
+
+	// Step over every frame the delta covers in one go, a long hitch doesn't loop here.
+	const int steps = static_cast<int>(time_ / frame_duration_);
+	time_ -= static_cast<float>(steps) * frame_duration_;
+	const int frame_count = get_frame_count();
+	if (looping_)
+	{
+		frame_ = (frame_ + steps) % frame_count;
+	}
+	else if (frame_ + steps >= frame_count - 1)
+	{
+		frame_ = frame_count - 1;
+		finished_ = true;
+	}
+	else
+	{
+		frame_ += steps;
+	}
+}
+
+void c_sprite_animation::restart()
+{
+	frame_ = 0;
+	time_ = 0.0f;
+	finished_ = false;
+}
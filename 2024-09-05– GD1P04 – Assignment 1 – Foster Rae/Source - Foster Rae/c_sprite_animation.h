@@ -0,0 +1,65 @@
+﻿// /***********************************************************************
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+// (c) 2024 Media Design School
+// File Name : c_sprite_animation.h
+// Description : Class that steps through the frames of a sprite atlas sequence.
+// Author : Foster Rae
+// Mail : Foster.Rae@mds.ac.nz
+// ************************************************************************/
+#pragma once
+#include <vector>
+#include "c_structs.h"
+#include "c_sprite_atlas.h"
+
+/**
+ * @class c_sprite_animation
+ * @brief Plays a sequence from a sprite atlas by picking the UV rect of the current frame.
+ * @note Holds no GL state, so thousands can run side by side and still draw from the one atlas bind.
+ */
+class c_sprite_animation
+{
+public:
+
+	// == Constructors and Destructors ==
+	/**
+	 * @brief Construct an animation at its first frame.
+	 * @param atlas The atlas holding the sequence, must outlive the animation.
+	 * @param sequence The sequence handle from c_sprite_atlas::add_sequence.
+	 * @param frames_per_second The playback rate.
+	 * @param looping True to wrap back to the first frame, false to hold the last frame.
+	 */
+	c_sprite_animation(const c_sprite_atlas& atlas, int sequence, float frames_per_second = 12.0f, bool looping = true);
+	~c_sprite_animation() = default;
+
+	// == Public Methods ==
+	/**
+	 * @brief Advances the animation, skipping frames if the delta covers more than one.
+	 * @param delta_time The time since the last update in seconds.
+	 */
+	void update(float delta_time);
+	/**
+	 * @brief Goes back to the first frame and plays again.
+	 */
+	void restart();
+
+	// == Accessors ==
+	const s_uv_rect& get_uv_rect() const { return (*frames_)[frame_]; }
+	int get_frame() const { return frame_; }
+	int get_frame_count() const { return static_cast<int>(frames_->size()); }
+	bool is_finished() const { return finished_; }
+	void set_frame(int frame) { frame_ = frame % get_frame_count(); time_ = 0.0f; }
+	void set_frames_per_second(float frames_per_second) { frame_duration_ = 1.0f / frames_per_second; }
+
+private:
+
+	// == Private Members ==
+	const std::vector<s_uv_rect>* frames_; // The sequence's rects in the atlas.
+	float frame_duration_;
+	float time_ = 0.0f;                    // Time spent on the current frame.
+	int frame_ = 0;
+	bool looping_;
+	bool finished_ = false;
+};
@@ -0,0 +1,254 @@
+﻿#include "c_sprite_atlas.h"
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+#include <stb_image.h>
+#include "c_block_encoder.h"
+#include "c_gl_state.h"
+#include "c_graphics_utils.h"
+#include "c_skyline_packer.h"
+#include "c_thread_pool.h"
+
+c_sprite_atlas::c_sprite_atlas(c_texture_cache* cache)
+	: cache_(cache)
+{
+}
+
+c_sprite_atlas::~c_sprite_atlas()
+{
+	release_texture();
+}
+
+// == Public Methods ==
+int c_sprite_atlas::add_sequence(const std::vector<std::string>& file_paths)
+{
+	sequences_.push_back({ file_paths, {} });
+	return static_cast<int>(sequences_.size()) - 1;
+}
+
+bool c_sprite_atlas::build(int max_size, int padding, bool compress)
+{
+	// A decoded frame and where it is packed.
+	struct s_frame {
+		int sequence;
+		int width;
+		int height;
+		unsigned char* pixels;
+		int x;
+		int y;
+		int packed_width;  // The frame with its padding, rounded up to whole blocks if compressing.
+		int packed_height;
+	};
+	// An atlas of the same frames may still be in the cache, then only the frame sizes are needed for the layout.
+	c_texture_ref cached = (cache_ != nullptr) ? cache_->find(make_key(padding, compress)) : c_texture_ref();
+	const bool reuse = cached.is_valid();
+
+	std::vector<s_frame> frames;
+	for (int sequence = 0; sequence < static_cast<int>(sequences_.size()); sequence++)
+	{
+		for (size_t i = 0; i < sequences_[sequence].file_paths.size(); i++)
+		{
+			frames.push_back({ sequence, 0, 0, nullptr, 0, 0, 0, 0 });
+		}
+	}
+
+	// Decode in parallel. Flipped like the rest of the textures, so row 0 is the bottom of the atlas.
+	{
+		c_thread_pool decoder;
+		size_t frame_index = 0;
+		for (const s_sequence& sequence : sequences_)
+		{
+			for (const std::string& path : sequence.file_paths)
+			{
+				s_frame* frame = &frames[frame_index++];
+				decoder.submit([frame, path, reuse]()
+				{
+					int components;
+					if (reuse)
+					{
+						if (!c_graphics_utils::read_image_info(path.c_str(), frame->width, frame->height, components))
+						{
+							std::cout << "Failed to load image: " << path << '\n';
+						}
+						return;
+					}
+					stbi_set_flip_vertically_on_load_thread(1);
+					frame->pixels = c_graphics_utils::decode_image(path.c_str(), frame->width, frame->height, components, 4);
+					if (frame->pixels == nullptr)
+					{
+						std::cout << "Failed to load image: " << path << '\n';
+					}
+				});
+			}
+		}
+	}
+	auto free_frames = [&frames]()
+	{
+		for (s_frame& frame : frames)
+		{
+			stbi_image_free(frame.pixels);
+		}
+	};
+	if (std::any_of(frames.begin(), frames.end(), [reuse](const s_frame& frame) { return reuse ? frame.width <= 0 : frame.pixels == nullptr; }))
+	{
+		free_frames();
+		return false;
+	}
+
+	// Whole blocks keep each compressed block inside one frame. Every packed size is then a multiple of 4, so the packer
+	// only places frames on block boundaries.
+	const int block_size = compress ? 4 : 1;
+	for (s_frame& frame : frames)
+	{
+		frame.packed_width = (frame.width + padding * 2 + block_size - 1) / block_size * block_size;
+		frame.packed_height = (frame.height + padding * 2 + block_size - 1) / block_size * block_size;
+	}
+
+	// Tallest first packs tightest.
+	std::vector<size_t> order(frames.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&frames](size_t a, size_t b) { return frames[a].packed_height > frames[b].packed_height; });
+
+	// Try power of two sizes, smallest area first, until every frame fits.
+	bool packed = false;
+	for (int size = 64; size <= max_size && !packed; size *= 2)
+	{
+		for (int width : { size, size * 2 })
+		{
+			if (width > max_size)
+			{
+				continue;
+			}
+			c_skyline_packer packer(width, size);
+			packed = std::all_of(order.begin(), order.end(), [&](size_t i)
+			{
+				return packer.pack(frames[i].packed_width, frames[i].packed_height, frames[i].x, frames[i].y);
+			});
+			if (packed)
+			{
+				width_ = width;
+				height_ = size;
+				std::cout << "Packed " << frames.size() << " sprite frames into a " << width_ << "x" << height_ << " atlas ("
+					<< static_cast<int>(packer.get_occupancy() * 100.0f) << "% used)" << '\n';
+				break;
+			}
+		}
+	}
+	if (!packed)
+	{
+		std::cout << "Sprite frames don't fit in a " << max_size << "x" << max_size << " atlas." << '\n';
+		free_frames();
+		return false;
+	}
+
+	// UV rects in frame order.
+	size_t frame_index = 0;
+	for (s_sequence& sequence : sequences_)
+	{
+		sequence.frames.clear();
+		for (size_t i = 0; i < sequence.file_paths.size(); i++)
+		{
+			const s_frame& frame = frames[frame_index++];
+			const glm::vec2 min(static_cast<float>(frame.x + padding), static_cast<float>(frame.y + padding));
+			const glm::vec2 max = min + glm::vec2(static_cast<float>(frame.width), static_cast<float>(frame.height));
+			const glm::vec2 size(static_cast<float>(width_), static_cast<float>(height_));
+			sequence.frames.push_back({ min / size, max / size });
+		}
+	}
+
+	// The cached texture already has this layout.
+	if (reuse)
+	{
+		release_texture();
+		texture_ref_ = std::move(cached);
+		texture_ = texture_ref_.get_id();
+		GLint format;
+		c_gl_state::bind_texture_for_update(GL_TEXTURE_2D, texture_);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+		format_ = static_cast<GLenum>(format);
+		return true;
+	}
+
+	// Copy each frame in with its edges repeated into the padding, and into the rest of its blocks.
+	std::vector<unsigned char> atlas(static_cast<size_t>(width_) * height_ * 4, 0);
+	for (const s_frame& frame : frames)
+	{
+		for (int y = -padding; y < frame.packed_height - padding; y++)
+		{
+			const int source_y = std::clamp(y, 0, frame.height - 1);
+			for (int x = -padding; x < frame.packed_width - padding; x++)
+			{
+				const int source_x = std::clamp(x, 0, frame.width - 1);
+				const size_t destination = (static_cast<size_t>(frame.y + padding + y) * width_ + frame.x + padding + x) * 4;
+				std::copy_n(&frame.pixels[(static_cast<size_t>(source_y) * frame.width + source_x) * 4], 4, &atlas[destination]);
+			}
+		}
+	}
+
+	free_frames();
+
+	// Compress on the pool, BC1 if every frame is opaque.
+	std::vector<unsigned char> blocks;
+	format_ = GL_RGBA8;
+	if (compress)
+	{
+		format_ = c_block_encoder::choose_format(atlas.data(), width_, height_);
+		c_thread_pool encoder;
+		blocks = c_block_encoder::encode(atlas.data(), width_, height_, format_, &encoder);
+	}
+
+	// Upload. No mips, they would blend neighbouring frames together.
+	release_texture();
+	glGenTextures(1, &texture_);
+	c_gl_state::bind_texture_for_update(GL_TEXTURE_2D, texture_);
+	glTexStorage2D(GL_TEXTURE_2D, 1, format_, width_, height_);
+	if (compress)
+	{
+		glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, format_, static_cast<GLsizei>(blocks.size()), blocks.data());
+	}
+	else
+	{
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, atlas.data());
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// Hand it to the cache so another atlas of the same frames can share it.
+	if (cache_ != nullptr)
+	{
+		texture_ref_ = cache_->add(make_key(padding, compress), texture_, compress ? blocks.size() : atlas.size());
+	}
+	return true;
+}
+
+// == Private Methods ==
+std::string c_sprite_atlas::make_key(int padding, bool compress) const
+{
+	std::string key = "atlas:" + std::to_string(padding) + (compress ? ",bc" : ",rgba8");
+	for (const s_sequence& sequence : sequences_)
+	{
+		key += '|';
+		for (const std::string& path : sequence.file_paths)
+		{
+			key += path + ';';
+		}
+	}
+	return key;
+}
+
+void c_sprite_atlas::release_texture()
+{
+	// A cached texture stays resident for the next atlas of the same frames, until the cache evicts it.
+	if (texture_ref_.is_valid())
+	{
+		texture_ref_.reset();
+	}
+	else if (texture_ != 0)
+	{
+		c_gl_state::forget_texture(texture_);
+		glDeleteTextures(1, &texture_);
+	}
+	texture_ = 0;
+}
@@ -0,0 +1,114 @@
+﻿// /***********************************************************************
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+// (c) 2024 Media Design School
+// File Name : c_sprite_atlas.h
+// Description : Class that packs sprite animation frames into one atlas texture.
+// Author : Foster Rae
+// Mail : Foster.Rae@mds.ac.nz
+// ************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include <glew.h>
+#include "c_structs.h"
+#include "c_texture_cache.h"
+
+/**
+ * @class c_sprite_atlas
+ * @brief Packs frame sequences (coin/tile000..014, Run (1..10), etc.) into one texture and keeps a UV rect per frame.
+ * @note Every sprite drawn from the atlas shares one texture bind, changing frame only changes the UVs.
+ *       Each frame is padded by repeating its edge pixels, so linear filtering never samples a neighbour.
+ *       The atlas is block compressed by default (BC3, or BC1 if every frame is opaque). Frames are packed on 4x4 block
+ *       boundaries so no block mixes two frames. The frames come from the source images, not cooked files, because they
+ *       have to be repacked and cooked levels are already compressed.
+ *       With a texture cache, an atlas of the same frames that is still cached is reused, building it then only reads
+ *       the frame sizes to lay out the UVs.
+ */
+class c_sprite_atlas
+{
+public:
+
+	// == Constructors and Destructors ==
+	/**
+	 * @brief Construct an empty atlas.
+	 * @param cache The cache that shares and frees the atlas texture, nullptr for the atlas to own it. Must outlive the atlas.
+	 */
+	explicit c_sprite_atlas(c_texture_cache* cache = nullptr);
+	~c_sprite_atlas(); // Deletes or releases the atlas texture.
+	c_sprite_atlas(const c_sprite_atlas&) = delete;            // Owns GL objects, no copying.
+	c_sprite_atlas& operator=(const c_sprite_atlas&) = delete;
+
+	// == Public Methods ==
+	/**
+	 * @brief Adds a sequence of frames to pack.
+	 *
+	 * @param file_paths The frame images in play order.
+	 * @return A handle to the sequence.
+	 */
+	int add_sequence(const std::vector<std::string>& file_paths);
+	/**
+	 * @brief Decodes every frame on a thread pool, packs them, and uploads the atlas.
+	 * @note Tries square then wide power of two sizes, smallest first, until everything fits.
+	 *       Compressing takes a quarter (BC3) or an eighth (BC1) of the VRAM and bandwidth of RGBA8, the encode runs on
+	 *       the thread pool while building.
+	 *
+	 * @param max_size The largest width or height to try.
+	 * @param padding The pixels of repeated edge around each frame.
+	 * @param compress True to block compress the atlas, false to keep it RGBA8.
+	 * @return True if the atlas was built, false if a frame failed to load or they don't fit in max_size.
+	 */
+	bool build(int max_size = 4096, int padding = 1, bool compress = true);
+	/**
+	 * @brief Gets the UV rects of a sequence.
+	 *
+	 * @param sequence The handle returned by add_sequence.
+	 * @return The rect of each frame in play order.
+	 */
+	const std::vector<s_uv_rect>& get_frames(int sequence) const { return sequences_[sequence].frames; }
+
+	// == Accessors ==
+	s_texture get_texture() const { return { texture_, "texture_atlas", GL_TEXTURE_2D }; }
+	GLuint get_texture_id() const { return texture_; }
+	GLenum get_format() const { return format_; } // GL_RGBA8, or the BC1/BC3 format if compressed.
+	int get_width() const { return width_; }
+	int get_height() const { return height_; }
+	int get_sequence_count() const { return static_cast<int>(sequences_.size()); }
+
+private:
+
+	/**
+	 * @brief A sequence of frames.
+	 * @param file_paths The frame images in play order.
+	 * @param frames The UV rect of each frame, filled in by build.
+	 */
+	struct s_sequence {
+		std::vector<std::string> file_paths;
+		std::vector<s_uv_rect> frames;
+	};
+
+	// == Private Methods ==
+	/**
+	 * @brief Builds the cache key of the atlas from its frames and build settings.
+	 *
+	 * @param padding The padding passed to build.
+	 * @param compress The compress flag passed to build.
+	 * @return The key, starting with "atlas:".
+	 */
+	std::string make_key(int padding, bool compress) const;
+	/**
+	 * @brief Deletes the texture if the atlas owns it, or drops its cache reference.
+	 */
+	void release_texture();
+
+	// == Private Members ==
+	std::vector<s_sequence> sequences_;
+	c_texture_cache* cache_;
+	c_texture_ref texture_ref_; // Set if the texture belongs to the cache.
+	GLuint texture_ = 0;
+	GLenum format_ = GL_RGBA8;
+	int width_ = 0;
+	int height_ = 0;
+};
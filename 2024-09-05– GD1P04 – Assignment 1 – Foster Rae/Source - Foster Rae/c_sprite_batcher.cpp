@@ -0,0 +1,165 @@
+﻿#include "c_sprite_batcher.h"
+#include <algorithm>
+#include <gtc/packing.hpp>
+#include "c_gl_state.h"
+#include "c_shader_loader.h"
+
+c_sprite_batcher::c_sprite_batcher()
+{
+	glGenVertexArrays(1, &vao_);
+	glGenBuffers(1, &instance_vbo_);
+
+	// Only instance attributes, one per sprite.
+	c_gl_state::bind_vertex_array(vao_);
+	glBindBuffer(GL_ARRAY_BUFFER, instance_vbo_);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(s_sprite_instance), reinterpret_cast<void*>(offsetof(s_sprite_instance, position)));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(s_sprite_instance), reinterpret_cast<void*>(offsetof(s_sprite_instance, size)));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(s_sprite_instance), reinterpret_cast<void*>(offsetof(s_sprite_instance, uv_rect)));
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(s_sprite_instance), reinterpret_cast<void*>(offsetof(s_sprite_instance, tint)));
+	for (GLuint location = 0; location < 4; location++)
+	{
+		glVertexAttribDivisor(location, 1); // Advance once per sprite.
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+c_sprite_batcher::~c_sprite_batcher()
+{
+	glDeleteBuffers(1, &instance_vbo_);
+	c_gl_state::forget_vertex_array(vao_);
+	glDeleteVertexArrays(1, &vao_);
+}
+
+// == Public Methods ==
+void c_sprite_batcher::begin()
+{
+	// Keep the memory, only reset the counts.
+	sprites_.clear();
+	sort_keys_.clear();
+	textures_.clear();
+	last_texture_ = 0;
+}
+
+void c_sprite_batcher::submit(GLuint texture_id, const glm::vec2& position, const glm::vec2& size, const s_uv_rect& uv_rect, const glm::vec4& tint, int layer)
+{
+	// Find the texture's slot, most sprites use the same texture as the one before.
+	if (textures_.empty() || texture_id != last_texture_)
+	{
+		auto found = std::find(textures_.begin(), textures_.end(), texture_id);
+		if (found == textures_.end())
+		{
+			found = textures_.insert(textures_.end(), texture_id);
+		}
+		last_texture_ = texture_id;
+		last_texture_slot_ = static_cast<uint32_t>(found - textures_.begin());
+	}
+
+	// Layer in the top bits, then texture, then submit order so the sort is stable.
+	const uint64_t layer_bits = static_cast<uint64_t>(std::clamp(layer, min_layer, max_layer) - min_layer);
+	sort_keys_.push_back((layer_bits << 48) | (static_cast<uint64_t>(last_texture_slot_ & 0xFFFF) << 32) | sprites_.size());
+	sprites_.push_back({ position, size, uv_rect, glm::packUnorm4x8(tint) });
+}
+
+int c_sprite_batcher::end(GLuint program_id)
+{
+	draw_count_ = 0;
+	if (sprites_.empty())
+	{
+		return 0;
+	}
+
+	// Sprites are often submitted in order already, then the sort is one pass.
+	if (!std::is_sorted(sort_keys_.begin(), sort_keys_.end()))
+	{
+		sort_keys();
+	}
+
+	// Orphan the buffer each frame so the driver doesn't wait on last frame's draws, then write in sorted order.
+	glBindBuffer(GL_ARRAY_BUFFER, instance_vbo_);
+	if (sprites_.size() > instance_capacity_)
+	{
+		instance_capacity_ = sprites_.size() * 2;
+	}
+	const GLsizeiptr upload_size = static_cast<GLsizeiptr>(sprites_.size() * sizeof(s_sprite_instance));
+	glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(instance_capacity_ * sizeof(s_sprite_instance)), nullptr, GL_STREAM_DRAW);
+	s_sprite_instance* instances = static_cast<s_sprite_instance*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, upload_size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+	if (instances == nullptr)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		return 0;
+	}
+	for (uint64_t key : sort_keys_)
+	{
+		*instances++ = sprites_[key & 0xFFFFFFFFu];
+	}
+	glUnmapBuffer(GL_ARRAY_BUFFER);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// Resolve the sampler once per program.
+	c_gl_state::use_program(program_id);
+	if (sampler_program_ != program_id)
+	{
+		sampler_program_ = program_id;
+		sampler_location_ = c_shader_loader::get_uniform_location(program_id, "sprite_texture");
+	}
+	c_shader_loader::set_int(sampler_location_, 0);
+	c_gl_state::bind_vertex_array(vao_);
+	c_gl_state::set_capability(GL_BLEND, true);
+	c_gl_state::set_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	// One instanced strip per run of the same texture, layers with the same texture run together.
+	size_t run_start = 0;
+	for (size_t i = 1; i <= sort_keys_.size(); i++)
+	{
+		const uint32_t slot = static_cast<uint32_t>(sort_keys_[run_start] >> 32) & 0xFFFF;
+		if (i < sort_keys_.size() && (static_cast<uint32_t>(sort_keys_[i] >> 32) & 0xFFFF) == slot)
+		{
+			continue;
+		}
+		c_gl_state::bind_texture(0, GL_TEXTURE_2D, textures_[slot]);
+		glDrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(i - run_start), static_cast<GLuint>(run_start));
+		draw_count_++;
+		run_start = i;
+	}
+	return draw_count_;
+}
+
+// == Private Methods ==
+void c_sprite_batcher::sort_keys()
+{
+	// Radix sort on the layer and texture bits, a byte a pass. The submit index below them is already in order and
+	// each pass is stable, so it stays in order. A pass where every key has the same byte is skipped, so a few layers
+	// and textures only cost two passes.
+	const size_t count = sort_keys_.size();
+	sort_scratch_.resize(count);
+	for (int shift = 32; shift < 64; shift += 8)
+	{
+		size_t offsets[256] = {};
+		for (uint64_t key : sort_keys_)
+		{
+			offsets[(key >> shift) & 0xFF]++;
+		}
+		if (offsets[(sort_keys_[0] >> shift) & 0xFF] == count)
+		{
+			continue;
+		}
+
+		// Counts to starting offsets.
+		size_t total = 0;
+		for (size_t& offset : offsets)
+		{
+			const size_t bucket_count = offset;
+			offset = total;
+			total += bucket_count;
+		}
+		for (uint64_t key : sort_keys_)
+		{
+			sort_scratch_[offsets[(key >> shift) & 0xFF]++] = key;
+		}
+		sort_keys_.swap(sort_scratch_);
+	}
+}
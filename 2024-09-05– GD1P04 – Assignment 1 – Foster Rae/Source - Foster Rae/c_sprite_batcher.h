@@ -0,0 +1,104 @@
+﻿// /***********************************************************************
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+// (c) 2024 Media Design School
+// File Name : c_sprite_batcher.h
+// Description : Class that draws 2D sprites as instanced quads, one draw call per run of sprites sharing a texture.
+// Author : Foster Rae
+// Mail : Foster.Rae@mds.ac.nz
+// ************************************************************************/
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glew.h>
+#include <glm.hpp>
+#include "c_structs.h"
+
+/**
+ * @class c_sprite_batcher
+ * @brief Collects sprites each frame, sorts them by layer then texture and draws each run with one instanced call.
+ * @note Sprites are submitted between begin and end. Every sprite is one instance (position, size, UV rect, tint)
+ *       streamed into an orphaned buffer, the quad corners come from gl_VertexID so there is no vertex buffer.
+ *       Use with sprite.vert and sprite.frag.
+ */
+class c_sprite_batcher
+{
+public:
+
+	// == Constructors and Destructors ==
+	c_sprite_batcher();
+	~c_sprite_batcher();
+	c_sprite_batcher(const c_sprite_batcher&) = delete;            // Owns GL objects, no copying.
+	c_sprite_batcher& operator=(const c_sprite_batcher&) = delete;
+
+	// == Public Methods ==
+	/**
+	 * @brief Starts a new batch, dropping the sprites of the last one.
+	 */
+	void begin();
+	/**
+	 * @brief Adds a sprite to the batch.
+	 *
+	 * @param texture_id The GL_TEXTURE_2D to sample, such as a c_sprite_atlas.
+	 * @param position The centre of the sprite.
+	 * @param size The width and height of the sprite.
+	 * @param uv_rect The part of the texture to draw.
+	 * @param tint Multiplied with the texture colour.
+	 * @param layer Higher layers draw on top, sprites within a layer draw in submit order per texture.
+	 */
+	void submit(GLuint texture_id, const glm::vec2& position, const glm::vec2& size, const s_uv_rect& uv_rect, const glm::vec4& tint = glm::vec4(1.0f), int layer = 0);
+	/**
+	 * @brief Sorts, uploads and draws the batch with alpha blending.
+	 * @note The frame constants pass (e.g. the UI pass) must be bound, the sprites use its view_projection.
+	 *
+	 * @param program_id The sprite shader program.
+	 * @return The number of draw calls issued.
+	 */
+	int end(GLuint program_id);
+
+	// == Accessors ==
+	size_t get_sprite_count() const { return sprites_.size(); }
+	int get_draw_count() const { return draw_count_; } // Draw calls of the last end.
+
+	// == Constants ==
+	static constexpr int min_layer = -32768; // Layers are stored in 16 bits of the sort key.
+	static constexpr int max_layer = 32767;
+
+private:
+
+	/**
+	 * @brief Per-sprite data streamed to the instanced vertex attributes.
+	 * @param position The centre of the sprite.
+	 * @param size The width and height of the sprite.
+	 * @param uv_rect The part of the texture to draw.
+	 * @param tint The RGBA8 tint, normalised in the shader.
+	 */
+	struct s_sprite_instance {
+		glm::vec2 position;
+		glm::vec2 size;
+		s_uv_rect uv_rect;
+		uint32_t tint;
+	};
+
+	// == Private Methods ==
+	/**
+	 * @brief Sorts the keys by layer then texture, keeping submit order within each.
+	 */
+	void sort_keys();
+
+	// == Private Members ==
+	std::vector<s_sprite_instance> sprites_; // Submit order.
+	std::vector<uint64_t> sort_keys_;        // Layer, texture slot, then submit index, one per sprite.
+	std::vector<uint64_t> sort_scratch_;     // Second buffer for the radix sort passes.
+	std::vector<GLuint> textures_;           // Textures used this batch, the slot is the index.
+	GLuint last_texture_ = 0;                // Cached slot lookup, sprites usually come in runs of one texture.
+	uint32_t last_texture_slot_ = 0;
+	GLuint vao_ = 0;
+	GLuint instance_vbo_ = 0;
+	size_t instance_capacity_ = 0;           // Number of sprites the instance buffer can hold.
+	GLuint sampler_program_ = 0;             // Program the sampler location was resolved for.
+	GLint sampler_location_ = -1;
+	int draw_count_ = 0;
+};
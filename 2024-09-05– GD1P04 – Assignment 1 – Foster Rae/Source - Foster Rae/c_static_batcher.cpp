@@ -0,0 +1,152 @@
+﻿#include "c_static_batcher.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+c_static_batcher::c_static_batcher(const c_geometry& geometry, const std::vector<s_texture>& textures, float region_size)
+	: source_vertices_(geometry.get_vertices()), source_indices_(geometry.get_indices()), textures_(textures), region_size_(region_size)
+{}
+
+void c_static_batcher::add(const c_transform_store& transforms, int handle)
+{
+	const uint64_t key = get_region_key(transforms.get_position(handle));
+	s_region& region = regions_[key];
+	region.handles.push_back(handle);
+	region.dirty = true;
+	object_regions_[handle] = key;
+}
+
+void c_static_batcher::update(c_transform_store& transforms)
+{
+	// Move changed objects to their new region, both regions need rebuilding.
+	size_t begin, end;
+	if (transforms.take_dirty_range(begin, end))
+	{
+		for (size_t handle = begin; handle < end; handle++)
+		{
+			const auto object = object_regions_.find(static_cast<int>(handle));
+			if (object == object_regions_.end())
+			{
+				continue;
+			}
+
+			s_region& old_region = regions_[object->second];
+			old_region.dirty = true;
+			const uint64_t key = get_region_key(transforms.get_position(static_cast<int>(handle)));
+			if (key != object->second)
+			{
+				old_region.handles.erase(std::find(old_region.handles.begin(), old_region.handles.end(), static_cast<int>(handle)));
+				s_region& new_region = regions_[key];
+				new_region.handles.push_back(static_cast<int>(handle));
+				new_region.dirty = true;
+				object->second = key;
+			}
+		}
+	}
+
+	for (auto& entry : regions_)
+	{
+		s_region& region = entry.second;
+
+		// Swap in finished batches, the old buffers are freed here on the GL thread.
+		if (region.build && region.build->done.load(std::memory_order_acquire))
+		{
+			region.mesh.reset();
+			if (!region.build->indices.empty())
+			{
+				region.mesh = std::make_unique<c_mesh>(region.build->vertices, region.build->indices, textures_);
+			}
+			region.bounds_min = region.build->bounds_min;
+			region.bounds_max = region.build->bounds_max;
+			region.build.reset();
+		}
+
+		// One rebuild per region at a time, changes made while it runs are picked up by the next one.
+		if (region.dirty && !region.build)
+		{
+			start_build(region, transforms);
+		}
+	}
+}
+
+void c_static_batcher::draw(GLuint program_id, int texture_index, const c_frustum& frustum) const
+{
+	// Batch vertices are already in world space, so the model matrix is the identity.
+	const glm::mat4 identity(1.0f);
+	for (GLuint i = 0; i < 4; i++)
+	{
+		glVertexAttrib4fv(c_mesh::instance_transform_location + i, &identity[i][0]);
+	}
+
+	for (const auto& entry : regions_)
+	{
+		const s_region& region = entry.second;
+		if (region.mesh && frustum.is_box_visible((region.bounds_min + region.bounds_max) * 0.5f, (region.bounds_max - region.bounds_min) * 0.5f))
+		{
+			region.mesh->draw(program_id, texture_index);
+		}
+	}
+}
+
+int c_static_batcher::get_building_count() const
+{
+	int count = 0;
+	for (const auto& entry : regions_)
+	{
+		count += (entry.second.build != nullptr);
+	}
+	return count;
+}
+
+// == Private Methods ==
+uint64_t c_static_batcher::get_region_key(const glm::vec3& position) const
+{
+	// Same packing as c_voxel_world, 21 bits per axis.
+	const glm::ivec3 coord = glm::ivec3(glm::floor(position / region_size_));
+	const uint64_t mask = (1ull << 21) - 1;
+	return ((static_cast<uint64_t>(coord.x) & mask) << 42)
+		| ((static_cast<uint64_t>(coord.y) & mask) << 21)
+		| (static_cast<uint64_t>(coord.z) & mask);
+}
+
+void c_static_batcher::start_build(s_region& region, const c_transform_store& transforms)
+{
+	// Snapshot the matrices on this thread, the store keeps changing while the worker runs.
+	std::vector<glm::mat4> model_matrices;
+	model_matrices.reserve(region.handles.size());
+	for (int handle : region.handles)
+	{
+		model_matrices.push_back(transforms.get_model_matrix(handle));
+	}
+	region.dirty = false;
+	region.build = std::make_shared<s_region_build>();
+
+	// The source geometry never changes after construction, so the worker can read it without a lock.
+	std::shared_ptr<s_region_build> build = region.build;
+	workers_.submit([this, build, model_matrices = std::move(model_matrices)]()
+	{
+		build->vertices.reserve(source_vertices_.size() * model_matrices.size());
+		build->indices.reserve(source_indices_.size() * model_matrices.size());
+		build->bounds_min = glm::vec3(FLT_MAX);
+		build->bounds_max = glm::vec3(-FLT_MAX);
+		for (const glm::mat4& model : model_matrices)
+		{
+			// Transform every vertex into world space, normals by the inverse transpose so scaling doesn't skew them.
+			const GLuint base = static_cast<GLuint>(build->vertices.size());
+			const glm::mat3 normal_matrix = glm::transpose(glm::inverse(glm::mat3(model)));
+			for (const s_vertex& vertex : source_vertices_)
+			{
+				const glm::vec3 position = glm::vec3(model * glm::vec4(vertex.position, 1.0f));
+				const glm::vec3 normal = normal_matrix * vertex.normal;
+				build->vertices.push_back({ position, (glm::dot(normal, normal) > 0.0f) ? glm::normalize(normal) : normal, vertex.tex_coords });
+				build->bounds_min = glm::min(build->bounds_min, position);
+				build->bounds_max = glm::max(build->bounds_max, position);
+			}
+			for (GLuint index : source_indices_)
+			{
+				build->indices.push_back(base + index);
+			}
+		}
+		build->done.store(true, std::memory_order_release);
+	});
+}
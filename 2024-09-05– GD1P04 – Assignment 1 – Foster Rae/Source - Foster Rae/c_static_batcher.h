@@ -0,0 +1,132 @@
+﻿// /***********************************************************************
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+// (c) 2024 Media Design School
+// File Name : c_static_batcher.h
+// Description : Class that merges static objects into one mesh per region and rebuilds changed regions in the background.
+// Author : Foster Rae
+// Mail : Foster.Rae@mds.ac.nz
+// ************************************************************************/
+#pragma once
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "Dependencies/GLM/glm.hpp"
+#include "c_geometry.h"
+#include "c_mesh.h"
+#include "c_frustum.h"
+#include "c_thread_pool.h"
+#include "c_transform_store.h"
+
+/**
+ * @class c_static_batcher
+ * @brief Pre-transforms copies of one geometry into merged vertex and index buffers, one per grid region.
+ * @note When an object moves its old and new regions are rebuilt on a worker thread and the finished buffers are
+ *       uploaded on the GL thread in update. The old batch keeps drawing until then, so edits never stall a frame.
+ */
+class c_static_batcher
+{
+public:
+
+	// == Constructors and Destructors ==
+	/**
+	 * @brief Construct a batcher for copies of a geometry.
+	 * @param geometry The geometry every object uses, copied so the workers never touch the GL object.
+	 * @param textures The material of the batches.
+	 * @param region_size The width of a region in world units.
+	 */
+	c_static_batcher(const c_geometry& geometry, const std::vector<s_texture>& textures, float region_size = 16.0f);
+	~c_static_batcher() = default; // The thread pool is the last member, so it finishes its jobs before anything else goes.
+	c_static_batcher(const c_static_batcher&) = delete;            // Owns GL objects, no copying.
+	c_static_batcher& operator=(const c_static_batcher&) = delete;
+
+	// == Public Methods ==
+	/**
+	 * @brief Adds an object to the batch of the region it is in.
+	 * @param transforms The store holding the object's transform.
+	 * @param handle The object's transform handle.
+	 */
+	void add(const c_transform_store& transforms, int handle);
+	/**
+	 * @brief Picks up moved objects, swaps in finished batches and starts rebuilding dirty regions. Call on the GL thread.
+	 * @note Takes the store's dirty range, so the store can't also feed an instanced renderer.
+	 *
+	 * @param transforms The store the objects were added from.
+	 */
+	void update(c_transform_store& transforms);
+	/**
+	 * @brief Draws every region that is at least partly inside the frustum, one draw per region.
+	 *
+	 * @param program_id The shader program to use.
+	 * @param texture_index The texture array layer to use.
+	 * @param frustum The camera frustum.
+	 */
+	void draw(GLuint program_id, int texture_index, const c_frustum& frustum) const;
+
+	// == Accessors ==
+	size_t get_region_count() const { return regions_.size(); }
+	int get_building_count() const; // Regions with a rebuild in flight.
+
+private:
+
+	/**
+	 * @brief The output of a region rebuild, written by a worker and read by the GL thread once done is set.
+	 * @param vertices The pre-transformed vertices of every object in the region.
+	 * @param indices The indices, offset per object.
+	 * @param bounds_min The minimum corner of the batch.
+	 * @param bounds_max The maximum corner of the batch.
+	 * @param done Set by the worker when the buffers are ready.
+	 */
+	struct s_region_build {
+		std::vector<s_vertex> vertices;
+		std::vector<GLuint> indices;
+		glm::vec3 bounds_min;
+		glm::vec3 bounds_max;
+		std::atomic<bool> done{ false };
+	};
+
+	/**
+	 * @brief A region of the grid.
+	 * @param handles The objects in the region.
+	 * @param mesh The current batch, null until the first build finishes or if the region is empty.
+	 * @param bounds_min The minimum corner of the current batch.
+	 * @param bounds_max The maximum corner of the current batch.
+	 * @param dirty The batch is out of date and needs rebuilding.
+	 * @param build The rebuild in flight, null if there isn't one.
+	 */
+	struct s_region {
+		std::vector<int> handles;
+		std::unique_ptr<c_mesh> mesh;
+		glm::vec3 bounds_min = glm::vec3(0.0f);
+		glm::vec3 bounds_max = glm::vec3(0.0f);
+		bool dirty = true;
+		std::shared_ptr<s_region_build> build;
+	};
+
+	// == Private Methods ==
+	/**
+	 * @brief Gets the key of the region holding a position.
+	 * @param position The world position.
+	 * @return The packed region coordinate.
+	 */
+	uint64_t get_region_key(const glm::vec3& position) const;
+	/**
+	 * @brief Snapshots a region's model matrices and queues its rebuild on the worker.
+	 *
+	 * @param region The region to rebuild.
+	 * @param transforms The store holding the objects.
+	 */
+	void start_build(s_region& region, const c_transform_store& transforms);
+
+	// == Private Members ==
+	std::vector<s_vertex> source_vertices_;
+	std::vector<GLuint> source_indices_;
+	std::vector<s_texture> textures_;
+	float region_size_;
+	std::unordered_map<uint64_t, s_region> regions_;
+	std::unordered_map<int, uint64_t> object_regions_; // Transform handle -> region key.
+	c_thread_pool workers_{ 1 };                        // One worker is enough, rebuilds are rare and small.
+};
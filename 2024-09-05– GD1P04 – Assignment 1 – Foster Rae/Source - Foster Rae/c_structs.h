@@ -10,6 +10,8 @@
 // Mail : Foster.Rae@mds.ac.nz
 // ************************************************************************/
 #pragma once
+#include <cstdint>
+#include <glew.h>
 #include <glm.hpp>
 #include <string>
 
@@ -28,12 +30,52 @@ struct s_vertex {
 	glm::vec2 tex_coords;
 };
 
+/**
+ * @brief Compact vertex, half the size of s_vertex. Built by c_geometry for geometry uploaded packed.
+ * @param position The position within the mesh bounds as signed normalized shorts, the fourth is padding.
+ * @param normal The normal as signed normalized 10:10:10:2. (GL_INT_2_10_10_10_REV)
+ * @param tex_coords The texture coordinates as half floats.
+ *
+ * @note Stored in memory as:\n
+ * [ position.x, position.y, position.z, padding (16 bits each), normal (32 bits), tex_coords.x, tex_coords.y (16 bits each) ]
+ */
+struct s_packed_vertex {
+	int16_t position[4];
+	uint32_t normal;
+	uint16_t tex_coords[2];
+};
+
 /**
  * @brief Texture struct to hold the texture id and type.
  * @param id The texture id.
  * @param type The texture type. (diffuse, specular, etc.)
+ * @param target The texture target. (GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY)
  */
 struct s_texture {
 	unsigned int id;
 	std::string type;
+	GLenum target = GL_TEXTURE_2D;
+};
+
+/**
+ * @brief Per-instance data streamed to the instanced vertex attributes.
+ * @param model_matrix The model matrix of the instance.
+ * @param texture_index The index of the texture the instance samples.
+ *
+ * @note Stored in memory as:\n
+ * [ model_matrix[0], model_matrix[1], model_matrix[2], model_matrix[3], texture_index ]
+ */
+struct s_instance_data {
+	glm::mat4 model_matrix;
+	int texture_index;
+};
+
+/**
+ * @brief A rectangle of a texture in UV space.
+ * @param min The bottom left corner.
+ * @param max The top right corner.
+ */
+struct s_uv_rect {
+	glm::vec2 min;
+	glm::vec2 max;
 };
\ No newline at end of file
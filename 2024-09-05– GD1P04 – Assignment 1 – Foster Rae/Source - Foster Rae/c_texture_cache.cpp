@@ -0,0 +1,292 @@
+﻿#include "c_texture_cache.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <system_error>
+#include <stb_image.h>
+#include "c_asset_pack.h"
+#include "c_gl_state.h"
+#include "c_graphics_utils.h"
+#include "c_texture_cooker.h"
+
+// == c_texture_ref ==
+c_texture_ref::c_texture_ref(c_texture_cache* cache, int index)
+	: cache_(cache), index_(index)
+{
+}
+
+c_texture_ref::~c_texture_ref()
+{
+	reset();
+}
+
+c_texture_ref::c_texture_ref(const c_texture_ref& other)
+	: cache_(other.cache_), index_(other.index_)
+{
+	if (cache_ != nullptr)
+	{
+		cache_->add_ref(index_);
+	}
+}
+
+c_texture_ref& c_texture_ref::operator=(const c_texture_ref& other)
+{
+	// Take the new reference first so assigning a handle to itself doesn't free the texture.
+	c_texture_cache* cache = other.cache_;
+	const int index = other.index_;
+	if (cache != nullptr)
+	{
+		cache->add_ref(index);
+	}
+	reset();
+	cache_ = cache;
+	index_ = index;
+	return *this;
+}
+
+c_texture_ref::c_texture_ref(c_texture_ref&& other) noexcept
+	: cache_(other.cache_), index_(other.index_)
+{
+	other.cache_ = nullptr;
+	other.index_ = -1;
+}
+
+c_texture_ref& c_texture_ref::operator=(c_texture_ref&& other) noexcept
+{
+	if (this != &other)
+	{
+		reset();
+		cache_ = other.cache_;
+		index_ = other.index_;
+		other.cache_ = nullptr;
+		other.index_ = -1;
+	}
+	return *this;
+}
+
+void c_texture_ref::reset()
+{
+	if (cache_ != nullptr)
+	{
+		cache_->release(index_);
+		cache_ = nullptr;
+		index_ = -1;
+	}
+}
+
+GLuint c_texture_ref::get_id() const
+{
+	return (cache_ != nullptr) ? cache_->entries_[index_].texture : 0;
+}
+
+// == c_texture_cache ==
+c_texture_cache::c_texture_cache(size_t budget_bytes)
+	: budget_bytes_(budget_bytes)
+{
+}
+
+c_texture_cache::~c_texture_cache()
+{
+	for (const s_entry& entry : entries_)
+	{
+		if (entry.texture == 0)
+		{
+			continue;
+		}
+		if (entry.ref_count > 0)
+		{
+			std::cout << "Texture still referenced when the cache was destroyed: " << entry.key << '\n';
+		}
+		c_gl_state::forget_texture(entry.texture);
+		glDeleteTextures(1, &entry.texture);
+	}
+}
+
+c_texture_ref c_texture_cache::load(const std::string& file_path, const s_sampler_settings& sampler)
+{
+	// Already loaded, find takes it off the LRU list if nobody was using it.
+	const std::string key = make_key(file_path, sampler);
+	c_texture_ref cached = find(key);
+	if (cached.is_valid())
+	{
+		return cached;
+	}
+
+	size_t bytes = 0;
+	const GLuint texture = upload(file_path, sampler, bytes);
+	if (texture == 0)
+	{
+		return c_texture_ref();
+	}
+	return c_texture_ref(this, insert(key, texture, bytes));
+}
+
+c_texture_ref c_texture_cache::find(const std::string& key)
+{
+	auto found = lookup_.find(key);
+	if (found == lookup_.end())
+	{
+		return c_texture_ref();
+	}
+	add_ref(found->second);
+	return c_texture_ref(this, found->second);
+}
+
+c_texture_ref c_texture_cache::add(const std::string& key, GLuint texture, size_t bytes)
+{
+	c_texture_ref cached = find(key);
+	if (cached.is_valid())
+	{
+		std::cout << "Texture added twice, keeping the cached one: " << key << '\n';
+		c_gl_state::forget_texture(texture);
+		glDeleteTextures(1, &texture);
+		return cached;
+	}
+	return c_texture_ref(this, insert(key, texture, bytes));
+}
+
+void c_texture_cache::set_budget(size_t budget_bytes)
+{
+	budget_bytes_ = budget_bytes;
+	trim();
+}
+
+// == Private Methods ==
+int c_texture_cache::insert(const std::string& key, GLuint texture, size_t bytes)
+{
+	// Reuse an evicted entry before growing, so handles stay small indices.
+	int index;
+	if (!free_entries_.empty())
+	{
+		index = free_entries_.back();
+		free_entries_.pop_back();
+	}
+	else
+	{
+		index = static_cast<int>(entries_.size());
+		entries_.emplace_back();
+	}
+	entries_[index] = { key, texture, bytes, 1, lru_.end() };
+	lookup_.emplace(key, index);
+	resident_bytes_ += bytes;
+	upload_count_++;
+
+	// The new texture may push the unreferenced ones over the budget.
+	trim();
+	return index;
+}
+
+void c_texture_cache::add_ref(int index)
+{
+	s_entry& entry = entries_[index];
+	if (entry.ref_count++ == 0)
+	{
+		lru_.erase(entry.lru_position);
+		entry.lru_position = lru_.end();
+	}
+}
+
+void c_texture_cache::release(int index)
+{
+	s_entry& entry = entries_[index];
+	if (--entry.ref_count > 0)
+	{
+		return;
+	}
+
+	// Keep it resident for the next load, the budget decides when it really goes.
+	entry.lru_position = lru_.insert(lru_.end(), index);
+	trim();
+}
+
+void c_texture_cache::trim()
+{
+	while (resident_bytes_ > budget_bytes_ && !lru_.empty())
+	{
+		evict(lru_.front());
+	}
+}
+
+void c_texture_cache::evict(int index)
+{
+	s_entry& entry = entries_[index];
+	lru_.erase(entry.lru_position);
+	lookup_.erase(entry.key);
+	resident_bytes_ -= entry.bytes;
+
+	c_gl_state::forget_texture(entry.texture);
+	glDeleteTextures(1, &entry.texture);
+
+	entry = { std::string(), 0, 0, 0, lru_.end() };
+	free_entries_.push_back(index);
+}
+
+std::string c_texture_cache::make_key(const std::string& file_path, const s_sampler_settings& sampler)
+{
+	// Resolve relative parts and links so every spelling of a path gives the same key.
+	std::error_code error;
+	std::filesystem::path canonical = std::filesystem::weakly_canonical(file_path, error);
+	std::string key = error ? file_path : canonical.generic_string();
+#ifdef _WIN32
+	// Windows paths are case insensitive.
+	std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+#endif
+
+	key += '|' + std::to_string(sampler.wrap_s) + ',' + std::to_string(sampler.wrap_t) + ','
+		+ std::to_string(sampler.min_filter) + ',' + std::to_string(sampler.mag_filter);
+	return key;
+}
+
+GLuint c_texture_cache::upload(const std::string& file_path, const s_sampler_settings& sampler, size_t& bytes)
+{
+	GLuint texture;
+	const bool mipmapped = sampler.min_filter != GL_NEAREST && sampler.min_filter != GL_LINEAR;
+	if (std::filesystem::path(file_path).extension() == c_texture_cooker::file_extension)
+	{
+		// Cooked textures carry their own mips, the file size is close to what they take on the GPU.
+		texture = c_graphics_utils::load_cooked_image(file_path.c_str());
+		if (texture == 0)
+		{
+			return 0;
+		}
+		std::error_code error;
+		const std::span<const unsigned char> packed = c_asset_pack::find_mounted(file_path);
+		const std::uintmax_t file_size = packed.empty() ? std::filesystem::file_size(file_path, error) : packed.size();
+		bytes = error ? 0 : static_cast<size_t>(file_size);
+	}
+	else
+	{
+		int width, height, components;
+		unsigned char* image_data = c_graphics_utils::decode_image(file_path.c_str(), width, height, components, 4);
+		if (image_data == nullptr)
+		{
+			std::cout << "Failed to load image: " << file_path << '\n';
+			return 0;
+		}
+
+		// Immutable storage with only the levels the sampler will use.
+		const GLsizei levels = mipmapped ? static_cast<GLsizei>(std::floor(std::log2(std::max(width, height)))) + 1 : 1;
+		glGenTextures(1, &texture);
+		c_gl_state::bind_texture_for_update(GL_TEXTURE_2D, texture);
+		glTexStorage2D(GL_TEXTURE_2D, levels, GL_RGBA8, width, height);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, image_data);
+		if (levels > 1)
+		{
+			glGenerateMipmap(GL_TEXTURE_2D);
+		}
+		stbi_image_free(image_data);
+
+		// A full mip chain adds a third on top of the base level.
+		bytes = static_cast<size_t>(width) * height * 4;
+		bytes += (levels > 1) ? bytes / 3 : 0;
+	}
+
+	c_gl_state::bind_texture_for_update(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, sampler.wrap_s);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, sampler.wrap_t);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, sampler.min_filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampler.mag_filter);
+	return texture;
+}
@@ -0,0 +1,212 @@
+﻿// /***********************************************************************
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+// (c) 2024 Media Design School
+// File Name : c_texture_cache.h
+// Description : Class that shares loaded textures through ref-counted handles and evicts unused ones over a VRAM budget.
+// Author : Foster Rae
+// Mail : Foster.Rae@mds.ac.nz
+// ************************************************************************/
+#pragma once
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glew.h>
+#include "c_structs.h"
+
+/**
+ * @brief How a cached texture is sampled. Part of the cache key, the same file with other settings is another texture.
+ * @param wrap_s The GL_TEXTURE_WRAP_S mode.
+ * @param wrap_t The GL_TEXTURE_WRAP_T mode.
+ * @param min_filter The GL_TEXTURE_MIN_FILTER, mipmaps are only built if it uses them.
+ * @param mag_filter The GL_TEXTURE_MAG_FILTER.
+ */
+struct s_sampler_settings {
+	GLint wrap_s = GL_REPEAT;
+	GLint wrap_t = GL_REPEAT;
+	GLint min_filter = GL_LINEAR_MIPMAP_LINEAR;
+	GLint mag_filter = GL_LINEAR;
+};
+
+class c_texture_cache;
+
+/**
+ * @class c_texture_ref
+ * @brief A counted reference to a texture in a c_texture_cache. The texture stays loaded while any reference exists.
+ * @note Copying adds a reference, destroying or resetting drops it. The cache must outlive its references.
+ */
+class c_texture_ref
+{
+public:
+
+	// == Constructors and Destructors ==
+	c_texture_ref() = default;
+	~c_texture_ref();
+	c_texture_ref(const c_texture_ref& other);
+	c_texture_ref& operator=(const c_texture_ref& other);
+	c_texture_ref(c_texture_ref&& other) noexcept;
+	c_texture_ref& operator=(c_texture_ref&& other) noexcept;
+
+	// == Public Methods ==
+	/**
+	 * @brief Drops the reference, the handle is empty afterwards.
+	 */
+	void reset();
+
+	// == Accessors ==
+	bool is_valid() const { return cache_ != nullptr; }
+	GLuint get_id() const;
+	s_texture get_texture() const { return { get_id(), "texture_diffuse", GL_TEXTURE_2D }; }
+
+private:
+
+	friend class c_texture_cache;
+
+	// == Constructors ==
+	c_texture_ref(c_texture_cache* cache, int index); // Takes a reference the cache already counted.
+
+	// == Private Members ==
+	c_texture_cache* cache_ = nullptr;
+	int index_ = -1; // Entry in the cache.
+};
+
+/**
+ * @class c_texture_cache
+ * @brief Loads each file once per sampler setting and hands out c_texture_ref handles to it.
+ * @note A texture nobody references stays resident so loading it again is free, until the resident size goes over
+ *       the budget. Then the least recently released textures are deleted first. A budget of 0 deletes a texture as
+ *       soon as its last reference goes. Referenced textures are never evicted, so the budget can be exceeded.
+ *       .ctex files are loaded with c_graphics_utils::load_cooked_image, other images are decoded with stb_image.
+ *       Textures built at runtime, like sprite atlases, are handed over with add and shared the same way.
+ */
+class c_texture_cache
+{
+public:
+
+	// == Constructors and Destructors ==
+	/**
+	 * @brief Construct an empty cache.
+	 * @param budget_bytes The most VRAM unreferenced textures can keep resident.
+	 */
+	explicit c_texture_cache(size_t budget_bytes = default_budget);
+	~c_texture_cache(); // Deletes every texture, references must be dropped first.
+	c_texture_cache(const c_texture_cache&) = delete;            // Owns GL objects, no copying.
+	c_texture_cache& operator=(const c_texture_cache&) = delete;
+
+	// == Public Methods ==
+	/**
+	 * @brief Gets a texture, loading it only if it isn't already in the cache.
+	 *
+	 * @param file_path The file path to the image, different spellings of the same file share one texture.
+	 * @param sampler How the texture is sampled.
+	 * @return A reference to the texture, empty if it failed to load.
+	 */
+	c_texture_ref load(const std::string& file_path, const s_sampler_settings& sampler = s_sampler_settings());
+	/**
+	 * @brief Gets a texture that was handed to the cache with add, if it is still resident.
+	 *
+	 * @param key The key the texture was added under.
+	 * @return A reference to the texture, empty if it isn't cached.
+	 */
+	c_texture_ref find(const std::string& key);
+	/**
+	 * @brief Hands a texture built somewhere else (e.g. a sprite atlas) to the cache, which deletes it like a loaded one.
+	 * @note Prefix the key with what built it ("atlas:") so it can't match a file key. If the key is already cached the
+	 *       texture is deleted and the cached one is returned.
+	 *
+	 * @param key The key to find the texture by.
+	 * @param texture The texture, owned by the cache afterwards.
+	 * @param bytes The VRAM size of the texture.
+	 * @return A reference to the texture.
+	 */
+	c_texture_ref add(const std::string& key, GLuint texture, size_t bytes);
+	/**
+	 * @brief Changes the budget and evicts unreferenced textures to fit it.
+	 * @param budget_bytes The most VRAM unreferenced textures can keep resident.
+	 */
+	void set_budget(size_t budget_bytes);
+
+	// == Accessors ==
+	size_t get_resident_bytes() const { return resident_bytes_; }
+	size_t get_texture_count() const { return lookup_.size(); }
+	size_t get_unreferenced_count() const { return lru_.size(); }
+	size_t get_upload_count() const { return upload_count_; } // Textures loaded or added, cache hits don't count.
+
+	// == Constants ==
+	static constexpr size_t default_budget = 256 * 1024 * 1024;
+
+private:
+
+	friend class c_texture_ref;
+
+	/**
+	 * @brief A cached texture.
+	 * @param key The canonical path and sampler settings.
+	 * @param texture The GL texture, 0 if the entry is free.
+	 * @param bytes The estimated VRAM size with mipmaps.
+	 * @param ref_count The live references.
+	 * @param lru_position Where the entry is in the LRU list, only valid while ref_count is 0.
+	 */
+	struct s_entry {
+		std::string key;
+		GLuint texture;
+		size_t bytes;
+		int ref_count;
+		std::list<int>::iterator lru_position;
+	};
+
+	// == Private Methods ==
+	void add_ref(int index);
+	/**
+	 * @brief Drops a reference, moving the texture to the LRU list when it reaches 0 and trimming to the budget.
+	 * @param index The entry.
+	 */
+	void release(int index);
+	/**
+	 * @brief Evicts the least recently released textures until the resident size fits the budget.
+	 */
+	void trim();
+	/**
+	 * @brief Deletes an unreferenced texture and frees its entry.
+	 * @param index The entry.
+	 */
+	void evict(int index);
+	/**
+	 * @brief Stores a new texture with one reference, then trims to the budget.
+	 *
+	 * @param key The cache key.
+	 * @param texture The texture.
+	 * @param bytes The VRAM size of the texture.
+	 * @return The entry.
+	 */
+	int insert(const std::string& key, GLuint texture, size_t bytes);
+	/**
+	 * @brief Builds the cache key for a file and sampler.
+	 *
+	 * @param file_path The file path as given.
+	 * @param sampler The sampler settings.
+	 * @return The canonical path followed by the sampler settings.
+	 */
+	static std::string make_key(const std::string& file_path, const s_sampler_settings& sampler);
+	/**
+	 * @brief Loads an image into a new texture with the sampler settings.
+	 *
+	 * @param file_path The file path to the image.
+	 * @param sampler The sampler settings.
+	 * @param bytes Set to the estimated VRAM size.
+	 * @return The texture, or 0 if it failed to load.
+	 */
+	static GLuint upload(const std::string& file_path, const s_sampler_settings& sampler, size_t& bytes);
+
+	// == Private Members ==
+	std::vector<s_entry> entries_;
+	std::vector<int> free_entries_;               // Entries whose texture was evicted, reused before growing.
+	std::unordered_map<std::string, int> lookup_; // Key to entry.
+	std::list<int> lru_;                          // Unreferenced entries, least recently released first.
+	size_t resident_bytes_ = 0;
+	size_t budget_bytes_;
+	size_t upload_count_ = 0;
+};
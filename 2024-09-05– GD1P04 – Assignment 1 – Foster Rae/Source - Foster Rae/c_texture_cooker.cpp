@@ -0,0 +1,279 @@
+﻿#include "c_texture_cooker.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <atomic>
+#include <stb_image.h>
+#include "c_block_encoder.h"
+#include "c_thread_pool.h"
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <xmmintrin.h>
+#define TEXTURE_COOKER_SSE
+#endif
+
+/**
+ * @brief Converts an sRGB encoded value to linear light.
+ *
+ * @param value The sRGB value from 0 to 1.
+ * @return The linear value from 0 to 1.
+ */
+static float srgb_to_linear(float value)
+{
+	return (value <= 0.04045f) ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+/**
+ * @brief Converts a linear value to sRGB encoded.
+ *
+ * @param value The linear value from 0 to 1.
+ * @return The sRGB value from 0 to 1.
+ */
+static float linear_to_srgb(float value)
+{
+	return (value <= 0.0031308f) ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+// == Public Methods ==
+int c_texture_cooker::cook_directory(const char* source_dir, const char* output_dir, bool compress)
+{
+	namespace fs = std::filesystem;
+	std::error_code error;
+	if (!fs::is_directory(source_dir, error))
+	{
+		std::cout << "Texture folder not found: " << source_dir << '\n';
+		return -1;
+	}
+
+	// Each image is cooked on its own worker.
+	std::atomic<int> cooked{ 0 };
+	std::atomic<int> failed{ 0 };
+	c_thread_pool pool;
+	for (const fs::directory_entry& entry : fs::recursive_directory_iterator(source_dir, error))
+	{
+		// Only the formats stb_image reads, any case. (texture_diffuse1.PNG)
+		std::string extension = entry.path().extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		if (!entry.is_regular_file() || (extension != ".png" && extension != ".jpg" && extension != ".jpeg" && extension != ".tga" && extension != ".bmp"))
+		{
+			continue;
+		}
+
+		// Mirror the source layout in the output folder.
+		fs::path output_path = fs::path(output_dir) / entry.path().lexically_relative(source_dir);
+		output_path.replace_extension(file_extension);
+		fs::create_directories(output_path.parent_path(), error);
+
+		pool.submit([source_path = entry.path().string(), output_path = output_path.string(), compress, &cooked, &failed]()
+		{
+			if (cook(source_path.c_str(), output_path.c_str(), compress))
+			{
+				cooked++;
+			}
+			else
+			{
+				failed++;
+			}
+		});
+	}
+	pool.wait_idle();
+
+	std::cout << "Cooked " << cooked << " textures into " << output_dir << ", " << failed << " failed." << '\n';
+	return (failed == 0) ? cooked.load() : -1;
+}
+
+bool c_texture_cooker::cook(const char* source_path, const char* output_path, bool compress)
+{
+	// Flip like the runtime does, so the file is already in GPU row order.
+	int width, height, components;
+	stbi_set_flip_vertically_on_load_thread(1);
+	unsigned char* pixels = stbi_load(source_path, &width, &height, &components, 4);
+	if (pixels == nullptr)
+	{
+		std::cout << "Failed to load image: " << source_path << '\n';
+		return false;
+	}
+
+	std::vector<s_image_level> levels = build_mip_chain(pixels, width, height);
+	if (!compress)
+	{
+		stbi_image_free(pixels);
+		return write(output_path, levels, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+	}
+
+	// Opaque textures take half the space as BC1, anything with alpha (sprites) needs BC3.
+	const GLenum format = c_block_encoder::choose_format(pixels, width, height);
+	stbi_image_free(pixels);
+	for (s_image_level& level : levels)
+	{
+		level.data = c_block_encoder::encode(level.data.data(), level.width, level.height, format);
+	}
+	return write(output_path, levels, format, 0, 0);
+}
+
+std::vector<s_image_level> c_texture_cooker::build_mip_chain(const unsigned char* pixels, int width, int height)
+{
+	std::vector<s_image_level> levels;
+	levels.push_back({ width, height, std::vector<unsigned char>(pixels, pixels + static_cast<size_t>(width) * height * 4) });
+
+	// Decode to linear with premultiplied alpha, so the box filter weights each colour by its coverage.
+	float to_linear[256];
+	for (int i = 0; i < 256; i++)
+	{
+		to_linear[i] = srgb_to_linear(static_cast<float>(i) / 255.0f);
+	}
+	std::vector<float> current(static_cast<size_t>(width) * height * 4);
+	for (size_t i = 0; i < current.size(); i += 4)
+	{
+		const float alpha = static_cast<float>(pixels[i + 3]) / 255.0f;
+		current[i + 0] = to_linear[pixels[i + 0]] * alpha;
+		current[i + 1] = to_linear[pixels[i + 1]] * alpha;
+		current[i + 2] = to_linear[pixels[i + 2]] * alpha;
+		current[i + 3] = alpha;
+	}
+
+	std::vector<float> next;
+	while (width > 1 || height > 1)
+	{
+		const int next_width = std::max(1, width / 2);
+		const int next_height = std::max(1, height / 2);
+		next.resize(static_cast<size_t>(next_width) * next_height * 4);
+		downsample(current.data(), width, height, next.data());
+
+		// Back to sRGB bytes, the filtering carries on from the float copy so errors don't build up.
+		s_image_level level = { next_width, next_height, std::vector<unsigned char>(next.size()) };
+		for (size_t i = 0; i < next.size(); i += 4)
+		{
+			const float alpha = next[i + 3];
+			const float inverse_alpha = (alpha > 0.0f) ? 1.0f / alpha : 0.0f;
+			for (int channel = 0; channel < 3; channel++)
+			{
+				const float value = std::min(1.0f, next[i + channel] * inverse_alpha);
+				level.data[i + channel] = static_cast<unsigned char>(linear_to_srgb(value) * 255.0f + 0.5f);
+			}
+			level.data[i + 3] = static_cast<unsigned char>(std::min(1.0f, alpha) * 255.0f + 0.5f);
+		}
+		levels.push_back(std::move(level));
+
+		current.swap(next);
+		width = next_width;
+		height = next_height;
+	}
+	return levels;
+}
+
+bool c_texture_cooker::write(const char* output_path, const std::vector<s_image_level>& levels, GLenum internal_format, GLenum format, GLenum type)
+{
+	if (levels.empty())
+	{
+		return false;
+	}
+
+	// Lay the levels out after the header and the mip table, each on an aligned offset.
+	s_cooked_texture_header header = {};
+	std::memcpy(header.magic, "CTEX", 4);
+	header.version = file_version;
+	header.width = static_cast<uint32_t>(levels.front().width);
+	header.height = static_cast<uint32_t>(levels.front().height);
+	header.mip_count = static_cast<uint32_t>(levels.size());
+	header.internal_format = internal_format;
+	header.format = format;
+	header.type = type;
+
+	std::vector<s_cooked_mip> mips(levels.size());
+	size_t offset = sizeof(s_cooked_texture_header) + sizeof(s_cooked_mip) * levels.size();
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		offset = (offset + level_alignment - 1) / level_alignment * level_alignment;
+		mips[i] = { static_cast<uint32_t>(offset), static_cast<uint32_t>(levels[i].data.size()), static_cast<uint32_t>(levels[i].width), static_cast<uint32_t>(levels[i].height) };
+		offset += levels[i].data.size();
+	}
+
+	std::ofstream file(output_path, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "Failed to write cooked texture: " << output_path << '\n';
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(mips.data()), static_cast<std::streamsize>(sizeof(s_cooked_mip) * mips.size()));
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		// Pad up to the level's offset.
+		static const char padding[level_alignment] = {};
+		file.write(padding, static_cast<std::streamsize>(mips[i].offset - static_cast<uint32_t>(file.tellp())));
+		file.write(reinterpret_cast<const char*>(levels[i].data.data()), static_cast<std::streamsize>(levels[i].data.size()));
+	}
+	return static_cast<bool>(file);
+}
+
+const s_cooked_texture_header* c_texture_cooker::read_header(const unsigned char* data, size_t size, const char* file_path)
+{
+	const s_cooked_texture_header* header = reinterpret_cast<const s_cooked_texture_header*>(data);
+	if (size < sizeof(s_cooked_texture_header) || std::memcmp(header->magic, "CTEX", 4) != 0 || header->version != file_version)
+	{
+		std::cout << "Not a cooked texture: " << file_path << '\n';
+		return nullptr;
+	}
+	const s_cooked_mip* mips = reinterpret_cast<const s_cooked_mip*>(header + 1);
+	if (header->mip_count == 0 || size < sizeof(s_cooked_texture_header) + sizeof(s_cooked_mip) * header->mip_count)
+	{
+		std::cout << "Error: Invalid mip table in " << file_path << '\n';
+		return nullptr;
+	}
+	for (uint32_t level = 0; level < header->mip_count; level++)
+	{
+		if (static_cast<size_t>(mips[level].offset) + mips[level].size > size)
+		{
+			std::cout << "Error: Truncated cooked texture: " << file_path << '\n';
+			return nullptr;
+		}
+	}
+	return header;
+}
+
+std::string c_texture_cooker::get_cooked_path(const std::string& source_path)
+{
+	// Same layout as cook_directory, the path below the source folder with the extension swapped.
+	const std::filesystem::path relative = std::filesystem::path(source_path).lexically_normal().lexically_relative(default_source_dir);
+	if (relative.empty() || *relative.begin() == "..")
+	{
+		return std::string();
+	}
+	std::filesystem::path cooked_path = std::filesystem::path(default_output_dir) / relative;
+	cooked_path.replace_extension(file_extension);
+	return cooked_path.generic_string();
+}
+
+// == Private Methods ==
+void c_texture_cooker::downsample(const float* source, int width, int height, float* destination)
+{
+	const int next_width = std::max(1, width / 2);
+	const int next_height = std::max(1, height / 2);
+	for (int y = 0; y < next_height; y++)
+	{
+		const float* row0 = source + static_cast<size_t>(std::min(y * 2, height - 1)) * width * 4;
+		const float* row1 = source + static_cast<size_t>(std::min(y * 2 + 1, height - 1)) * width * 4;
+		float* out = destination + static_cast<size_t>(y) * next_width * 4;
+		for (int x = 0; x < next_width; x++, out += 4)
+		{
+			const int x0 = std::min(x * 2, width - 1) * 4;
+			const int x1 = std::min(x * 2 + 1, width - 1) * 4;
+#ifdef TEXTURE_COOKER_SSE
+			// One pixel is one register, all four channels are averaged at once.
+			const __m128 top = _mm_add_ps(_mm_loadu_ps(row0 + x0), _mm_loadu_ps(row0 + x1));
+			const __m128 bottom = _mm_add_ps(_mm_loadu_ps(row1 + x0), _mm_loadu_ps(row1 + x1));
+			_mm_storeu_ps(out, _mm_mul_ps(_mm_add_ps(top, bottom), _mm_set1_ps(0.25f)));
+#else
+			for (int channel = 0; channel < 4; channel++)
+			{
+				out[channel] = (row0[x0 + channel] + row0[x1 + channel] + row1[x0 + channel] + row1[x1 + channel]) * 0.25f;
+			}
+#endif
+		}
+	}
+}
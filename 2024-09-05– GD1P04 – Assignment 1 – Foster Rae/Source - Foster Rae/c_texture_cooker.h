@@ -0,0 +1,159 @@
+﻿// /***********************************************************************
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+// (c) 2024 Media Design School
+// File Name : c_texture_cooker.h
+// Description : Class with static methods that cook images into GPU-ready files with their mip chains.
+// Author : Foster Rae
+// Mail : Foster.Rae@mds.ac.nz
+// ************************************************************************/
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glew.h>
+
+/**
+ * @brief The header at the start of a cooked texture (.ctex) file.
+ * @param magic Always "CTEX".
+ * @param version The format version, files with another version are rejected.
+ * @param width The width of the top level.
+ * @param height The height of the top level.
+ * @param mip_count The number of levels, each has an s_cooked_mip entry straight after the header.
+ * @param internal_format The format passed to glTexStorage2D. (GL_RGBA8 or a BC1/BC3 format)
+ * @param format The format passed to glTexSubImage2D, 0 if the levels are compressed.
+ * @param type The type passed to glTexSubImage2D, 0 if the levels are compressed.
+ */
+struct s_cooked_texture_header {
+	char magic[4];
+	uint32_t version;
+	uint32_t width;
+	uint32_t height;
+	uint32_t mip_count;
+	uint32_t internal_format;
+	uint32_t format;
+	uint32_t type;
+};
+
+/**
+ * @brief Where a level of a cooked texture is in the file.
+ * @param offset The byte offset of the level from the start of the file, 16 byte aligned.
+ * @param size The size of the level in bytes.
+ * @param width The width of the level.
+ * @param height The height of the level.
+ */
+struct s_cooked_mip {
+	uint32_t offset;
+	uint32_t size;
+	uint32_t width;
+	uint32_t height;
+};
+
+/**
+ * @brief A level of an image in memory.
+ * @param width The width of the level.
+ * @param height The height of the level.
+ * @param data The level data, laid out as it is uploaded.
+ */
+struct s_image_level {
+	int width;
+	int height;
+	std::vector<unsigned char> data;
+};
+
+/**
+ * @class c_texture_cooker
+ * @brief Turns images into .ctex files holding every mip level, so the runtime maps and uploads them with no decode
+ *        and no glGenerateMipmap.
+ * @note Run the executable with: --cook-textures [source folder] [output folder]
+ */
+class c_texture_cooker
+{
+public:
+
+	// == Public Methods ==
+	/**
+	 * @brief Cooks every image in a folder and its subfolders on a thread pool, keeping the folder layout.
+	 *
+	 * @param source_dir The folder to read the images from.
+	 * @param output_dir The folder to write the .ctex files to.
+	 * @param compress True to block compress the levels, false to keep them RGBA8.
+	 * @return The number of textures cooked, or -1 if any failed.
+	 */
+	static int cook_directory(const char* source_dir, const char* output_dir, bool compress = true);
+	/**
+	 * @brief Cooks one image into a .ctex file.
+	 * @note Compressed images are BC1 if they are fully opaque, otherwise BC3.
+	 *
+	 * @param source_path The image to cook.
+	 * @param output_path The file to write.
+	 * @param compress True to block compress the levels, false to keep them RGBA8.
+	 * @return True if the file was written.
+	 */
+	static bool cook(const char* source_path, const char* output_path, bool compress = true);
+	/**
+	 * @brief Builds the full mip chain of an RGBA8 image down to 1x1.
+	 * @note Filtered in linear light with the colour weighted by alpha, so mips don't darken or pick up the colour of
+	 *       transparent texels. Level 0 is the source image.
+	 *
+	 * @param pixels The sRGB RGBA8 pixels of the top level.
+	 * @param width The width of the image.
+	 * @param height The height of the image.
+	 * @return Every level, largest first.
+	 */
+	static std::vector<s_image_level> build_mip_chain(const unsigned char* pixels, int width, int height);
+	/**
+	 * @brief Writes levels to a .ctex file.
+	 *
+	 * @param output_path The file to write.
+	 * @param levels The levels, largest first.
+	 * @param internal_format The format passed to glTexStorage2D.
+	 * @param format The format passed to glTexSubImage2D, 0 if the levels are compressed.
+	 * @param type The type passed to glTexSubImage2D, 0 if the levels are compressed.
+	 * @return True if the file was written.
+	 */
+	static bool write(const char* output_path, const std::vector<s_image_level>& levels, GLenum internal_format, GLenum format, GLenum type);
+	/**
+	 * @brief Checks that a cooked texture in memory is complete, the mip table follows the header.
+	 *
+	 * @param data The .ctex file contents.
+	 * @param size The size of the file.
+	 * @param file_path The file path, for errors.
+	 * @return The header, or nullptr if the file is invalid.
+	 */
+	static const s_cooked_texture_header* read_header(const unsigned char* data, size_t size, const char* file_path);
+	/**
+	 * @brief Gets where cook_directory writes an image when cooking the default folders.
+	 *
+	 * @param source_path The image. (e.g. Resources/Textures/coin/tile000.png)
+	 * @return The .ctex path (e.g. Resources/Cooked/coin/tile000.ctex), or empty if the image is outside the source folder.
+	 */
+	static std::string get_cooked_path(const std::string& source_path);
+
+	// == Constants ==
+	static constexpr char default_source_dir[] = "Resources/Textures";
+	static constexpr char default_output_dir[] = "Resources/Cooked";
+	static constexpr char file_extension[] = ".ctex";
+	static constexpr uint32_t file_version = 1;
+	static constexpr uint32_t level_alignment = 16; // Keeps each level aligned for SIMD reads and block formats.
+
+private:
+
+	// == Constructors / Destructors ==
+	c_texture_cooker() = default;  // Static class.
+	~c_texture_cooker() = default;
+
+	// == Private Methods ==
+	/**
+	 * @brief Halves a linear, premultiplied RGBA float image with a 2x2 box filter.
+	 * @note Odd sizes clamp at the edge, a 1 pixel side stays 1 pixel.
+	 *
+	 * @param source The source pixels, 4 floats each.
+	 * @param width The width of the source.
+	 * @param height The height of the source.
+	 * @param destination The output, max(1, width / 2) x max(1, height / 2) pixels.
+	 */
+	static void downsample(const float* source, int width, int height, float* destination);
+};
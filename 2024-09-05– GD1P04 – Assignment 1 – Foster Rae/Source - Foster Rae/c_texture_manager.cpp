@@ -0,0 +1,424 @@
+﻿#include "c_texture_manager.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <span>
+#include <string>
+#include <system_error>
+#include <stb_image.h>
+#include "c_asset_pack.h"
+#include "c_block_encoder.h"
+#include "c_gl_state.h"
+#include "c_graphics_utils.h"
+#include "c_texture_cooker.h"
+
+/**
+ * @brief Checks if a storage format is one of the block compressed formats the cooker writes.
+ *
+ * @param internal_format The storage format.
+ * @return True for BC1 and BC3.
+ */
+static bool is_block_compressed(GLenum internal_format)
+{
+	return internal_format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || internal_format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+}
+
+c_texture_manager::c_texture_manager(size_t upload_budget)
+	: upload_budget_(upload_budget)
+{
+}
+
+c_texture_manager::~c_texture_manager()
+{
+	// Let the workers finish, they still write to their decodes.
+	decoder_.wait_idle();
+
+	// Delete the texture arrays and the upload buffer.
+	for (GLuint array : arrays_)
+	{
+		c_gl_state::forget_texture(array);
+	}
+	glDeleteTextures(static_cast<GLsizei>(arrays_.size()), arrays_.data());
+	glDeleteBuffers(1, &upload_pbo_);
+}
+
+int c_texture_manager::add(const char* file_path)
+{
+	// A cooked image already has its levels, nothing to decode.
+	const int cooked = add_cooked(file_path);
+	if (cooked >= 0)
+	{
+		return cooked;
+	}
+
+	// Only read the header here, the size is all build needs.
+	int width, height, components;
+	if (!c_graphics_utils::read_image_info(file_path, width, height, components))
+	{
+		std::cout << "Failed to load image: " << file_path << '\n';
+		return -1;
+	}
+	if (width <= 0 || height <= 0)
+	{
+		std::cerr << "Error: Invalid image dimensions." << '\n';
+		return -1;
+	}
+
+	// Decode and build the mips on a worker. The flip is thread local in stb, so set it on the worker to match the main thread.
+	std::shared_ptr<s_decode> decode = std::make_shared<s_decode>();
+	std::string path = file_path;
+	decoder_.submit([decode, path]()
+	{
+		int w, h, c;
+		stbi_set_flip_vertically_on_load_thread(1);
+		unsigned char* pixels = c_graphics_utils::decode_image(path.c_str(), w, h, c, 4);
+		if (pixels == nullptr)
+		{
+			std::cout << "Failed to load image: " << path << '\n';
+		}
+		else
+		{
+			decode->levels = c_texture_cooker::build_mip_chain(pixels, w, h);
+			stbi_image_free(pixels);
+		}
+		decode->done.store(true, std::memory_order_release);
+	});
+
+	s_entry entry = {};
+	entry.width = width;
+	entry.height = height;
+	entry.internal_format = GL_RGBA8;
+	entry.mip_count = static_cast<int>(std::floor(std::log2(std::max(width, height)))) + 1;
+	entry.decode = decode;
+	entries_.push_back(std::move(entry));
+	pending_count_++;
+	return static_cast<int>(entries_.size()) - 1;
+}
+
+void c_texture_manager::build()
+{
+	// Group the textures by size and format, each group becomes one array. Cooked textures never share an array with
+	// decoded ones, so the cooked levels are only ever written from their files.
+	std::vector<std::vector<s_entry*>> groups;
+	for (s_entry& entry : entries_)
+	{
+		// Skip textures that are already built.
+		if (entry.array_index >= 0)
+		{
+			continue;
+		}
+
+		auto group = std::find_if(groups.begin(), groups.end(), [&entry](const std::vector<s_entry*>& g)
+		{
+			return g.front()->width == entry.width && g.front()->height == entry.height
+				&& g.front()->internal_format == entry.internal_format && g.front()->mip_count == entry.mip_count
+				&& g.front()->is_cooked == entry.is_cooked;
+		});
+		if (group == groups.end())
+		{
+			groups.push_back({ &entry });
+		}
+		else
+		{
+			group->push_back(&entry);
+		}
+	}
+
+	// Create each array, the pixels are streamed in later by update.
+	for (const std::vector<s_entry*>& group : groups)
+	{
+		const int width = group.front()->width;
+		const int height = group.front()->height;
+		const GLsizei layer_count = static_cast<GLsizei>(group.size());
+		const GLsizei mip_levels = static_cast<GLsizei>(group.front()->mip_count);
+		const GLenum internal_format = group.front()->internal_format;
+
+		GLuint array;
+		glGenTextures(1, &array);
+		c_gl_state::bind_texture_for_update(GL_TEXTURE_2D_ARRAY, array);
+		glTexStorage3D(GL_TEXTURE_2D_ARRAY, mip_levels, internal_format, width, height, layer_count);
+
+		// Compressed storage can't be cleared, so it is filled with copies of a placeholder block.
+		std::vector<unsigned char> placeholder_block;
+		if (is_block_compressed(internal_format))
+		{
+			const std::vector<GLuint> placeholder_pixels(16, placeholder_colour);
+			placeholder_block = c_block_encoder::encode(reinterpret_cast<const unsigned char*>(placeholder_pixels.data()), 4, 4, internal_format);
+		}
+
+		// Fill every level with the placeholder so unloaded layers don't sample garbage.
+		for (GLsizei level = 0; level < mip_levels; level++)
+		{
+			const int level_width = std::max(1, width >> level);
+			const int level_height = std::max(1, height >> level);
+			if (!placeholder_block.empty())
+			{
+				const size_t block_count = static_cast<size_t>((level_width + 3) / 4) * ((level_height + 3) / 4) * layer_count;
+				std::vector<unsigned char> fill;
+				fill.reserve(block_count * placeholder_block.size());
+				for (size_t i = 0; i < block_count; i++)
+				{
+					fill.insert(fill.end(), placeholder_block.begin(), placeholder_block.end());
+				}
+				glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, level_width, level_height, layer_count, internal_format,
+					static_cast<GLsizei>(fill.size()), fill.data());
+			}
+			else if (GLEW_ARB_clear_texture)
+			{
+				glClearTexImage(array, level, GL_RGBA, GL_UNSIGNED_BYTE, &placeholder_colour);
+			}
+			else
+			{
+				const std::vector<GLuint> fill(static_cast<size_t>(level_width) * level_height * layer_count, placeholder_colour);
+				glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, level_width, level_height, layer_count, GL_RGBA, GL_UNSIGNED_BYTE, fill.data());
+			}
+		}
+
+		for (GLsizei layer = 0; layer < layer_count; layer++)
+		{
+			group[layer]->array_index = static_cast<int>(arrays_.size());
+			group[layer]->layer = layer;
+		}
+
+		// Same sampling as c_graphics_utils::load_image.
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		arrays_.push_back(array);
+	}
+
+	if (upload_pbo_ == 0)
+	{
+		glGenBuffers(1, &upload_pbo_);
+	}
+}
+
+void c_texture_manager::update()
+{
+	if (pending_count_ == 0)
+	{
+		return;
+	}
+
+	// Upload the decoded images in order until the budget runs out.
+	size_t budget = upload_budget_;
+	for (s_entry& entry : entries_)
+	{
+		// Cooked levels go up as they are.
+		if (entry.cooked_data != nullptr && entry.array_index >= 0)
+		{
+			if (!upload_levels(entry, budget))
+			{
+				break; // Out of budget, carry on next frame.
+			}
+			entry.cooked_data = nullptr;
+			entry.cooked_file.close();
+			pending_count_--;
+			if (budget == 0)
+			{
+				break;
+			}
+			continue;
+		}
+
+		if (!entry.decode || entry.array_index < 0 || !entry.decode->done.load(std::memory_order_acquire))
+		{
+			continue;
+		}
+
+		// A failed decode keeps the placeholder.
+		if (entry.decode->levels.empty())
+		{
+			entry.decode.reset();
+			pending_count_--;
+			continue;
+		}
+
+		if (!upload_rows(entry, budget))
+		{
+			break; // Out of budget, carry on next frame.
+		}
+
+		// Every level of the layer is in, free the CPU copy.
+		entry.decode.reset();
+		pending_count_--;
+		if (budget == 0)
+		{
+			break;
+		}
+	}
+}
+
+s_texture c_texture_manager::get_texture(int handle) const
+{
+	// Invalid or unbuilt textures get texture 0.
+	GLuint id = 0;
+	if (handle >= 0 && handle < static_cast<int>(entries_.size()) && entries_[handle].array_index >= 0)
+	{
+		id = arrays_[entries_[handle].array_index];
+	}
+	return { id, "texture_array", GL_TEXTURE_2D_ARRAY };
+}
+
+int c_texture_manager::get_layer(int handle) const
+{
+	if (handle < 0 || handle >= static_cast<int>(entries_.size()) || entries_[handle].layer < 0)
+	{
+		return 0;
+	}
+	return entries_[handle].layer;
+}
+
+// == Private Methods ==
+int c_texture_manager::add_cooked(const char* file_path)
+{
+	const std::string cooked_path = c_texture_cooker::get_cooked_path(file_path);
+	if (cooked_path.empty())
+	{
+		return -1;
+	}
+
+	// Read it from the asset pack, or map the loose file if it isn't older than the image it was cooked from.
+	s_entry entry = {};
+	std::span<const unsigned char> data = c_asset_pack::find_mounted(cooked_path);
+	if (data.empty())
+	{
+		std::error_code error;
+		const std::filesystem::file_time_type cooked_time = std::filesystem::last_write_time(cooked_path, error);
+		if (error)
+		{
+			return -1; // Not cooked.
+		}
+		const std::filesystem::file_time_type source_time = std::filesystem::last_write_time(file_path, error);
+		if (!error && source_time > cooked_time)
+		{
+			std::cout << "Cooked texture is older than its image, decoding the image instead: " << cooked_path << '\n';
+			return -1;
+		}
+		if (!entry.cooked_file.open(cooked_path.c_str()))
+		{
+			return -1;
+		}
+		data = { entry.cooked_file.get_data(), entry.cooked_file.get_size() };
+	}
+	const s_cooked_texture_header* header = c_texture_cooker::read_header(data.data(), data.size(), cooked_path.c_str());
+	if (header == nullptr)
+	{
+		return -1;
+	}
+	if (header->format == 0 && !is_block_compressed(header->internal_format))
+	{
+		std::cout << "Unknown compressed format, decoding the image instead: " << cooked_path << '\n';
+		return -1;
+	}
+
+	entry.width = static_cast<int>(header->width);
+	entry.height = static_cast<int>(header->height);
+	entry.internal_format = header->internal_format;
+	entry.mip_count = static_cast<int>(header->mip_count);
+	entry.cooked_data = data.data();
+	entry.is_cooked = true;
+	entries_.push_back(std::move(entry));
+	pending_count_++;
+	return static_cast<int>(entries_.size()) - 1;
+}
+
+bool c_texture_manager::upload_levels(s_entry& entry, size_t& budget)
+{
+	const s_cooked_texture_header* header = reinterpret_cast<const s_cooked_texture_header*>(entry.cooked_data);
+	const s_cooked_mip* mips = reinterpret_cast<const s_cooked_mip*>(header + 1);
+	while (entry.levels_uploaded < entry.mip_count)
+	{
+		// Whole levels only. A level bigger than the whole budget still goes on its own, like a row in upload_rows.
+		const s_cooked_mip& mip = mips[entry.levels_uploaded];
+		if (mip.size > budget && budget < upload_budget_)
+		{
+			return false;
+		}
+
+		// Same orphaned unpack buffer as upload_rows.
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload_pbo_);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(mip.size), nullptr, GL_STREAM_DRAW);
+		void* staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(mip.size), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		budget -= std::min<size_t>(budget, mip.size);
+		if (staging == nullptr)
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			return false;
+		}
+		std::memcpy(staging, entry.cooked_data + mip.offset, mip.size);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+		// Compressed blocks go to the GPU as they are.
+		c_gl_state::bind_texture_for_update(GL_TEXTURE_2D_ARRAY, arrays_[entry.array_index]);
+		if (header->format == 0)
+		{
+			glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, entry.levels_uploaded, 0, 0, entry.layer, static_cast<GLsizei>(mip.width), static_cast<GLsizei>(mip.height), 1,
+				header->internal_format, static_cast<GLsizei>(mip.size), nullptr);
+		}
+		else
+		{
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, entry.levels_uploaded, 0, 0, entry.layer, static_cast<GLsizei>(mip.width), static_cast<GLsizei>(mip.height), 1,
+				header->format, header->type, nullptr);
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		entry.levels_uploaded++;
+	}
+	return true;
+}
+
+bool c_texture_manager::upload_rows(s_entry& entry, size_t& budget)
+{
+	const std::vector<s_image_level>& levels = entry.decode->levels;
+	while (entry.levels_uploaded < static_cast<int>(levels.size()))
+	{
+		// Send whole rows of the current level that fit in the budget.
+		const s_image_level& level = levels[entry.levels_uploaded];
+		const size_t row_bytes = static_cast<size_t>(level.width) * 4;
+		const size_t rows_left = static_cast<size_t>(level.height - entry.rows_uploaded);
+		size_t rows = std::min(rows_left, budget / row_bytes);
+		if (rows == 0)
+		{
+			// A row wider than the whole budget still goes on its own, so a huge image makes progress.
+			if (budget < upload_budget_)
+			{
+				return false;
+			}
+			rows = 1;
+		}
+		const size_t bytes = row_bytes * rows;
+
+		// Orphan the buffer so the driver hands back fresh memory instead of waiting on last frame's copy.
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload_pbo_);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(bytes), nullptr, GL_STREAM_DRAW);
+		void* staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(bytes), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		budget -= std::min(budget, bytes);
+		if (staging == nullptr)
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			return false;
+		}
+		std::memcpy(staging, level.data.data() + row_bytes * entry.rows_uploaded, bytes);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+		// With a buffer bound the pixel pointer is an offset into it, so the copy happens on the GPU's timeline.
+		c_gl_state::bind_texture_for_update(GL_TEXTURE_2D_ARRAY, arrays_[entry.array_index]);
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, entry.levels_uploaded, 0, entry.rows_uploaded, entry.layer, level.width, static_cast<GLsizei>(rows), 1,
+			GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		entry.rows_uploaded += static_cast<int>(rows);
+
+		// Move on to the next level once this one is in.
+		if (entry.rows_uploaded < level.height)
+		{
+			return false;
+		}
+		entry.rows_uploaded = 0;
+		entry.levels_uploaded++;
+	}
+	return true;
+}
@@ -0,0 +1,160 @@
+﻿// /***********************************************************************
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+// (c) 2024 Media Design School
+// File Name : c_texture_manager.h
+// Description : Class that packs same-sized textures into texture arrays, decoding and uploading them in the background.
+// Author : Foster Rae
+// Mail : Foster.Rae@mds.ac.nz
+// ************************************************************************/
+#pragma once
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <glew.h>
+#include "c_mapped_file.h"
+#include "c_structs.h"
+#include "c_texture_cooker.h"
+#include "c_thread_pool.h"
+
+/**
+ * @class c_texture_manager
+ * @brief Loads textures and packs every texture of the same size into one GL_TEXTURE_2D_ARRAY.
+ * @note A mesh binds the array once and picks its texture with the layer index, no per-texture binds or shader branches.
+ *       Images are decoded and their mips built on a thread pool, then streamed in through a pixel unpack buffer by
+ *       update(), a few rows per frame. Until then a layer holds the placeholder colour, so handles can be used
+ *       straight away. glGenerateMipmap is never called, it would rebuild every layer of the array.
+ *       Images with a file cooked by c_texture_cooker skip the decode and the mip building, the cooked levels are
+ *       streamed in as they are, block compressed ones included. Only textures with the same size, format and level
+ *       count share an array, so an image only shares with others cooked the same way. Cooked and decoded images
+ *       never share one, so cooked levels are only ever written from their files.
+ */
+class c_texture_manager
+{
+public:
+
+	// == Constructors and Destructors ==
+	/**
+	 * @brief Starts the decode threads.
+	 * @param upload_budget The most pixel bytes update() streams to the GPU per frame.
+	 */
+	explicit c_texture_manager(size_t upload_budget = default_upload_budget);
+	~c_texture_manager(); // Waits for the decodes and deletes the texture arrays.
+	c_texture_manager(const c_texture_manager&) = delete;            // Owns GL objects, no copying.
+	c_texture_manager& operator=(const c_texture_manager&) = delete;
+
+	// == Public Methods ==
+	/**
+	 * @brief Reads the size of an image and queues it to be decoded on a worker, or maps its cooked file if there is one.
+	 * @note The image is decoded as RGBA so RGB and RGBA images of the same size share an array.
+	 *       The cooked file is used if c_texture_cooker::get_cooked_path finds one that isn't older than the image.
+	 *
+	 * @param file_path The file path to the image.
+	 * @return A handle to the texture, or -1 if the file can't be read.
+	 */
+	int add(const char* file_path);
+	/**
+	 * @brief Creates the texture arrays filled with the placeholder colour. The pixels arrive through update().
+	 * @note Call once after adding every texture.
+	 */
+	void build();
+	/**
+	 * @brief Streams decoded images into their layers until the frame's upload budget is spent. Call once a frame.
+	 * @note Each layer's levels are sent largest first, the smaller levels keep the placeholder until they arrive.
+	 */
+	void update();
+	/**
+	 * @brief Gets the texture array holding a texture, ready to add to a mesh.
+	 *
+	 * @param handle The handle returned by add.
+	 * @return The texture array with the type "texture_array".
+	 */
+	s_texture get_texture(int handle) const;
+	/**
+	 * @brief Gets the layer of a texture within its array. Use as the texture index when drawing.
+	 *
+	 * @param handle The handle returned by add.
+	 * @return The layer index, or 0 if the handle is invalid.
+	 */
+	int get_layer(int handle) const;
+
+	// == Accessors ==
+	int get_pending_count() const { return pending_count_; } // Textures still showing the placeholder.
+
+	// == Constants ==
+	static constexpr size_t default_upload_budget = 4 * 1024 * 1024; // 4 MB a frame, a 1024x1024 RGBA image.
+	static constexpr GLuint placeholder_colour = 0xFFFF00FFu;        // Opaque magenta (RGBA bytes FF 00 FF FF).
+
+private:
+
+	/**
+	 * @brief The output of a decode, written by a worker and read by the GL thread once done is set.
+	 * @param levels Every RGBA level, largest first, built with c_texture_cooker::build_mip_chain. Empty if the decode failed.
+	 * @param done Set by the worker when levels is ready.
+	 */
+	struct s_decode {
+		std::vector<s_image_level> levels;
+		std::atomic<bool> done{ false };
+	};
+	/**
+	 * @brief An added texture.
+	 * @param width The width of the image.
+	 * @param height The height of the image.
+	 * @param internal_format The storage format of the image's array.
+	 * @param mip_count The levels in the image's array.
+	 * @param array_index The index of the array the texture is packed into.
+	 * @param layer The layer of the texture within its array.
+	 * @param decode The decode in flight, released once the image is uploaded. Null for cooked images.
+	 * @param rows_uploaded The rows of the current decoded level streamed so far.
+	 * @param cooked_file The mapped .ctex file, empty if it came from the asset pack. Closed once uploaded.
+	 * @param cooked_data The start of the .ctex file, nullptr once uploaded or if the image is decoded.
+	 * @param levels_uploaded The levels streamed into the layer so far.
+	 * @param is_cooked True if the levels come from a .ctex file.
+	 */
+	struct s_entry {
+		int width;
+		int height;
+		GLenum internal_format;
+		int mip_count;
+		int array_index = -1;
+		int layer = -1;
+		std::shared_ptr<s_decode> decode;
+		int rows_uploaded = 0;
+		c_mapped_file cooked_file;
+		const unsigned char* cooked_data = nullptr;
+		int levels_uploaded = 0;
+		bool is_cooked = false;
+	};
+
+	// == Private Methods ==
+	/**
+	 * @brief Adds an image from its cooked file.
+	 * @param file_path The file path to the source image.
+	 * @return A handle to the texture, or -1 if there is no usable cooked file.
+	 */
+	int add_cooked(const char* file_path);
+	/**
+	 * @brief Streams whole levels of a cooked image through the unpack buffer into its layer.
+	 * @param entry The texture to upload.
+	 * @param budget The bytes left this frame, reduced by the bytes sent.
+	 * @return True if the last level was uploaded.
+	 */
+	bool upload_levels(s_entry& entry, size_t& budget);
+	/**
+	 * @brief Streams rows of a decoded image's levels through the unpack buffer into its layer.
+	 * @param entry The texture to upload.
+	 * @param budget The bytes left this frame, reduced by the bytes sent.
+	 * @return True if the last row of the last level was uploaded.
+	 */
+	bool upload_rows(s_entry& entry, size_t& budget);
+
+	// == Private Members ==
+	std::vector<s_entry> entries_; // Every added texture.
+	std::vector<GLuint> arrays_;   // One texture array per image size.
+	GLuint upload_pbo_ = 0;        // Pixel unpack buffer the rows are staged in.
+	size_t upload_budget_;
+	int pending_count_ = 0;
+	c_thread_pool decoder_;        // Decodes the images, workers only touch their s_decode.
+};
@@ -0,0 +1,75 @@
+﻿#include "c_thread_pool.h"
+#include <algorithm>
+
+c_thread_pool::c_thread_pool(int thread_count)
+{
+	// Leave a hardware thread for the main (GL) thread.
+	if (thread_count <= 0)
+	{
+		thread_count = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+	}
+	for (int i = 0; i < thread_count; i++)
+	{
+		threads_.emplace_back(&c_thread_pool::worker_loop, this);
+	}
+}
+
+c_thread_pool::~c_thread_pool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	job_available_.notify_all();
+	for (std::thread& thread : threads_)
+	{
+		thread.join();
+	}
+}
+
+void c_thread_pool::submit(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		jobs_.push(std::move(job));
+	}
+	job_available_.notify_one();
+}
+
+void c_thread_pool::wait_idle()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	idle_.wait(lock, [this] { return jobs_.empty() && active_jobs_ == 0; });
+}
+
+// == Private Methods ==
+void c_thread_pool::worker_loop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			job_available_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+			if (jobs_.empty())
+			{
+				return; // Stopping and nothing left to do.
+			}
+			job = std::move(jobs_.front());
+			jobs_.pop();
+			active_jobs_++;
+		}
+
+		// Run without the lock so other workers can take jobs.
+		job();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			active_jobs_--;
+			if (jobs_.empty() && active_jobs_ == 0)
+			{
+				idle_.notify_all();
+			}
+		}
+	}
+}
@@ -0,0 +1,69 @@
+﻿// /***********************************************************************
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+// (c) 2024 Media Design School
+// File Name : c_thread_pool.h
+// Description : Class that runs jobs on a fixed set of worker threads.
+// Author : Foster Rae
+// Mail : Foster.Rae@mds.ac.nz
+// ************************************************************************/
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/**
+ * @class c_thread_pool
+ * @brief A queue of jobs shared by a fixed number of worker threads.
+ * @note Jobs must not touch OpenGL, only the main thread has a context. Hand the results back and upload them there.
+ */
+class c_thread_pool
+{
+public:
+
+	// == Constructors and Destructors ==
+	/**
+	 * @brief Starts the worker threads.
+	 * @param thread_count The number of workers, 0 to use one less than the hardware threads (at least 1).
+	 */
+	explicit c_thread_pool(int thread_count = 0);
+	~c_thread_pool(); // Finishes the queued jobs and joins the workers.
+	c_thread_pool(const c_thread_pool&) = delete;            // Owns threads, no copying.
+	c_thread_pool& operator=(const c_thread_pool&) = delete;
+
+	// == Public Methods ==
+	/**
+	 * @brief Queues a job to run on a worker.
+	 * @param job The job to run.
+	 */
+	void submit(std::function<void()> job);
+	/**
+	 * @brief Blocks until every queued job has finished.
+	 */
+	void wait_idle();
+
+	// == Accessors ==
+	int get_thread_count() const { return static_cast<int>(threads_.size()); }
+
+private:
+
+	// == Private Methods ==
+	/**
+	 * @brief Runs jobs until the pool is destroyed and the queue is empty.
+	 */
+	void worker_loop();
+
+	// == Private Members ==
+	std::vector<std::thread> threads_;
+	std::queue<std::function<void()>> jobs_;
+	std::mutex mutex_;                       // Guards the queue, active_jobs_ and stopping_.
+	std::condition_variable job_available_;  // Wakes a worker when a job is queued or the pool stops.
+	std::condition_variable idle_;           // Wakes wait_idle when the last job finishes.
+	int active_jobs_ = 0;                    // Jobs being run right now.
+	bool stopping_ = false;
+};
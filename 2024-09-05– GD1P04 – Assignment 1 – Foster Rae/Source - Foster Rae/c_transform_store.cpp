@@ -0,0 +1,245 @@
+﻿#include "c_transform_store.h"
+#include <algorithm>
+#include <cmath>
+#include "c_instanced_renderer.h"
+
+// SSE is part of every x86 and x64 target the project builds for, other targets use the scalar loop.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define TRANSFORM_STORE_SSE
+#include <xmmintrin.h>
+#endif
+
+/**
+ * @brief Writes the model matrix T * Rz * S of one transform.
+ *
+ * @param px, py, pz The position.
+ * @param sin_r, cos_r The sine and cosine of the rotation.
+ * @param sx, sy, sz The scale.
+ * @param out The 16 floats of the column-major matrix.
+ */
+static void write_model_matrix(float px, float py, float pz, float sin_r, float cos_r, float sx, float sy, float sz, float* out)
+{
+	out[0] = cos_r * sx;  out[1] = sin_r * sx; out[2] = 0.0f;  out[3] = 0.0f;  // Column 0
+	out[4] = -sin_r * sy; out[5] = cos_r * sy; out[6] = 0.0f;  out[7] = 0.0f;  // Column 1
+	out[8] = 0.0f;        out[9] = 0.0f;       out[10] = sz;   out[11] = 0.0f; // Column 2
+	out[12] = px;         out[13] = py;        out[14] = pz;   out[15] = 1.0f; // Column 3
+}
+
+// == Public Methods ==
+int c_transform_store::add(glm::vec3 position, float rotation, glm::vec3 scale, glm::vec3 local_extents)
+{
+	position_x_.push_back(position.x);
+	position_y_.push_back(position.y);
+	position_z_.push_back(position.z);
+	rotation_.push_back(rotation);
+	sin_.push_back(std::sin(glm::radians(rotation)));
+	cos_.push_back(std::cos(glm::radians(rotation)));
+	scale_x_.push_back(scale.x);
+	scale_y_.push_back(scale.y);
+	scale_z_.push_back(scale.z);
+	local_extents_.push_back(local_extents);
+	extent_x_.push_back(0.0f);
+	extent_y_.push_back(0.0f);
+	extent_z_.push_back(0.0f);
+
+	const size_t handle = rotation_.size() - 1;
+	update_extents(handle);
+	mark_dirty(handle);
+	return static_cast<int>(handle);
+}
+
+int c_transform_store::append(size_t count, const float* position_x, const float* position_y, const float* position_z, const float* rotation,
+	const float* scale_x, const float* scale_y, const float* scale_z, glm::vec3 local_extents)
+{
+	const size_t first = rotation_.size();
+	if (count == 0)
+	{
+		return static_cast<int>(first);
+	}
+
+	// The stored components are straight copies.
+	position_x_.insert(position_x_.end(), position_x, position_x + count);
+	position_y_.insert(position_y_.end(), position_y, position_y + count);
+	position_z_.insert(position_z_.end(), position_z, position_z + count);
+	rotation_.insert(rotation_.end(), rotation, rotation + count);
+	scale_x_.insert(scale_x_.end(), scale_x, scale_x + count);
+	scale_y_.insert(scale_y_.end(), scale_y, scale_y + count);
+	scale_z_.insert(scale_z_.end(), scale_z, scale_z + count);
+	local_extents_.insert(local_extents_.end(), count, local_extents);
+
+	// Then the cached trig and the bounds in one pass.
+	sin_.resize(first + count);
+	cos_.resize(first + count);
+	extent_x_.resize(first + count);
+	extent_y_.resize(first + count);
+	extent_z_.resize(first + count);
+	for (size_t handle = first; handle < first + count; handle++)
+	{
+		sin_[handle] = std::sin(glm::radians(rotation_[handle]));
+		cos_[handle] = std::cos(glm::radians(rotation_[handle]));
+		update_extents(handle);
+	}
+
+	mark_dirty(first);
+	mark_dirty(first + count - 1);
+	return static_cast<int>(first);
+}
+
+void c_transform_store::reserve(size_t count)
+{
+	for (std::vector<float>* array : { &position_x_, &position_y_, &position_z_, &rotation_, &sin_, &cos_, &scale_x_, &scale_y_, &scale_z_, &extent_x_, &extent_y_, &extent_z_ })
+	{
+		array->reserve(count);
+	}
+	local_extents_.reserve(count);
+}
+
+void c_transform_store::compute_matrices(size_t first, size_t count, s_instance_data* destination) const
+{
+	size_t i = 0;
+#ifdef TRANSFORM_STORE_SSE
+	// Four transforms at a time. Each column is built across the four transforms then transposed into one matrix per transform.
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	for (; i + 4 <= count; i += 4)
+	{
+		const size_t t = first + i;
+		const __m128 sin_r = _mm_loadu_ps(&sin_[t]);
+		const __m128 cos_r = _mm_loadu_ps(&cos_[t]);
+		const __m128 sx = _mm_loadu_ps(&scale_x_[t]);
+		const __m128 sy = _mm_loadu_ps(&scale_y_[t]);
+
+		// Column 0 = (cos * sx, sin * sx, 0, 0)
+		__m128 c0_x = _mm_mul_ps(cos_r, sx);
+		__m128 c0_y = _mm_mul_ps(sin_r, sx);
+		__m128 c0_z = zero;
+		__m128 c0_w = zero;
+		_MM_TRANSPOSE4_PS(c0_x, c0_y, c0_z, c0_w);
+		// Column 1 = (-sin * sy, cos * sy, 0, 0)
+		__m128 c1_x = _mm_sub_ps(zero, _mm_mul_ps(sin_r, sy));
+		__m128 c1_y = _mm_mul_ps(cos_r, sy);
+		__m128 c1_z = zero;
+		__m128 c1_w = zero;
+		_MM_TRANSPOSE4_PS(c1_x, c1_y, c1_z, c1_w);
+		// Column 2 = (0, 0, sz, 0)
+		__m128 c2_x = zero;
+		__m128 c2_y = zero;
+		__m128 c2_z = _mm_loadu_ps(&scale_z_[t]);
+		__m128 c2_w = zero;
+		_MM_TRANSPOSE4_PS(c2_x, c2_y, c2_z, c2_w);
+		// Column 3 = (px, py, pz, 1)
+		__m128 c3_x = _mm_loadu_ps(&position_x_[t]);
+		__m128 c3_y = _mm_loadu_ps(&position_y_[t]);
+		__m128 c3_z = _mm_loadu_ps(&position_z_[t]);
+		__m128 c3_w = one;
+		_MM_TRANSPOSE4_PS(c3_x, c3_y, c3_z, c3_w);
+
+		// After the transposes the Nth register of each column belongs to transform N.
+		const __m128 columns[4][4] = {
+			{ c0_x, c1_x, c2_x, c3_x },
+			{ c0_y, c1_y, c2_y, c3_y },
+			{ c0_z, c1_z, c2_z, c3_z },
+			{ c0_w, c1_w, c2_w, c3_w }
+		};
+		for (int n = 0; n < 4; n++)
+		{
+			float* out = &destination[i + n].model_matrix[0][0];
+			_mm_storeu_ps(out, columns[n][0]);
+			_mm_storeu_ps(out + 4, columns[n][1]);
+			_mm_storeu_ps(out + 8, columns[n][2]);
+			_mm_storeu_ps(out + 12, columns[n][3]);
+		}
+	}
+#endif
+
+	// Remaining transforms one at a time.
+	for (; i < count; i++)
+	{
+		const size_t t = first + i;
+		write_model_matrix(position_x_[t], position_y_[t], position_z_[t], sin_[t], cos_[t],
+			scale_x_[t], scale_y_[t], scale_z_[t], &destination[i].model_matrix[0][0]);
+	}
+}
+
+void c_transform_store::update(c_instanced_renderer& renderer)
+{
+	// Nothing changed since the last update.
+	size_t begin, end;
+	if (!take_dirty_range(begin, end))
+	{
+		return;
+	}
+
+	// Build straight into the renderer's instance data, it uploads the same range on the next draw.
+	compute_matrices(begin, end - begin, renderer.write_instances(begin, end - begin));
+}
+
+bool c_transform_store::take_dirty_range(size_t& begin, size_t& end)
+{
+	begin = dirty_begin_;
+	end = dirty_end_;
+	dirty_begin_ = dirty_end_ = 0;
+	return begin != end;
+}
+
+glm::mat4 c_transform_store::get_model_matrix(int handle) const
+{
+	glm::mat4 model_matrix;
+	write_model_matrix(position_x_[handle], position_y_[handle], position_z_[handle], sin_[handle], cos_[handle],
+		scale_x_[handle], scale_y_[handle], scale_z_[handle], &model_matrix[0][0]);
+	return model_matrix;
+}
+
+// == Transformation Methods ==
+void c_transform_store::set_position(int handle, glm::vec3 position)
+{
+	position_x_[handle] = position.x;
+	position_y_[handle] = position.y;
+	position_z_[handle] = position.z;
+	mark_dirty(handle);
+}
+
+void c_transform_store::set_rotation(int handle, float rotation)
+{
+	rotation_[handle] = rotation;
+	sin_[handle] = std::sin(glm::radians(rotation));
+	cos_[handle] = std::cos(glm::radians(rotation));
+	update_extents(handle);
+	mark_dirty(handle);
+}
+
+void c_transform_store::set_scale(int handle, glm::vec3 scale)
+{
+	scale_x_[handle] = scale.x;
+	scale_y_[handle] = scale.y;
+	scale_z_[handle] = scale.z;
+	update_extents(handle);
+	mark_dirty(handle);
+}
+
+// == Private Methods ==
+void c_transform_store::mark_dirty(size_t handle)
+{
+	// Same contiguous range as the instance buffer, the batch kernel is cheap enough to rebuild clean transforms in between.
+	if (dirty_begin_ == dirty_end_)
+	{
+		dirty_begin_ = handle;
+		dirty_end_ = handle + 1;
+		return;
+	}
+	dirty_begin_ = std::min(dirty_begin_, handle);
+	dirty_end_ = std::max(dirty_end_, handle + 1);
+}
+
+void c_transform_store::update_extents(size_t handle)
+{
+	// Half extents of the rotated and scaled box, the absolute upper 3x3 of the model matrix times the local extents.
+	const glm::vec3& local = local_extents_[handle];
+	const float sin_r = std::abs(sin_[handle]);
+	const float cos_r = std::abs(cos_[handle]);
+	const float sx = std::abs(scale_x_[handle]);
+	const float sy = std::abs(scale_y_[handle]);
+	extent_x_[handle] = cos_r * sx * local.x + sin_r * sy * local.y;
+	extent_y_[handle] = sin_r * sx * local.x + cos_r * sy * local.y;
+	extent_z_[handle] = std::abs(scale_z_[handle]) * local.z;
+}
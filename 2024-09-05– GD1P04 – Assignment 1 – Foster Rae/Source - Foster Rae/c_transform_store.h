@@ -0,0 +1,140 @@
+﻿// /***********************************************************************
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+// (c) 2024 Media Design School
+// File Name : c_transform_store.h
+// Description : Class that stores object transforms as contiguous arrays and builds their model matrices in batches.
+// Author : Foster Rae
+// Mail : Foster.Rae@mds.ac.nz
+// ************************************************************************/
+#pragma once
+#include <vector>
+#include "Dependencies/GLM/glm.hpp"
+#include "c_structs.h"
+
+class c_instanced_renderer;
+
+/**
+ * @class c_transform_store
+ * @brief Keeps positions, rotations and scales in structure-of-arrays form and builds model matrices four at a time with SSE.
+ * @note Handles are indices. When a renderer's instance slots match the handles the matrices are written straight into its instance data.
+ *       Rotations are about the Z axis, the same as c_cube, and the sine and cosine are cached when the rotation is set.
+ *       A world-space AABB (centre and half extents) is kept per transform for culling.
+ */
+class c_transform_store
+{
+public:
+
+	// == Constructors and Destructors ==
+	c_transform_store() = default;
+	~c_transform_store() = default;
+
+	// == Public Methods ==
+	/**
+	 * @brief Adds a transform to the store.
+	 * @param position The position of the object.
+	 * @param rotation The rotation of the object in degrees.
+	 * @param scale The scale of the object.
+	 * @param local_extents The half extents of the object's bounding box before it is transformed. (0.5 for a unit cube)
+	 * @return A handle to the transform.
+	 */
+	int add(glm::vec3 position, float rotation, glm::vec3 scale, glm::vec3 local_extents = glm::vec3(0.5f));
+	/**
+	 * @brief Adds a run of transforms from arrays, copying each array in one go. Used to bulk load c_scene files.
+	 *
+	 * @param count The number of transforms.
+	 * @param position_x The X positions.
+	 * @param position_y The Y positions.
+	 * @param position_z The Z positions.
+	 * @param rotation The rotations in degrees.
+	 * @param scale_x The X scales.
+	 * @param scale_y The Y scales.
+	 * @param scale_z The Z scales.
+	 * @param local_extents The half extents of every object's bounding box before it is transformed.
+	 * @return The handle of the first transform, the rest follow it.
+	 */
+	int append(size_t count, const float* position_x, const float* position_y, const float* position_z, const float* rotation,
+		const float* scale_x, const float* scale_y, const float* scale_z, glm::vec3 local_extents = glm::vec3(0.5f));
+	/**
+	 * @brief Reserves memory for a number of transforms.
+	 * @param count The number of transforms.
+	 */
+	void reserve(size_t count);
+	/**
+	 * @brief Builds the model matrices of a range of transforms.
+	 * @note Writes only the model matrix of each destination element, the texture index is left alone.
+	 *
+	 * @param first The handle of the first transform.
+	 * @param count The number of transforms.
+	 * @param destination The instance data to write to, one element per transform.
+	 */
+	void compute_matrices(size_t first, size_t count, s_instance_data* destination) const;
+	/**
+	 * @brief Builds the model matrices of every transform that changed and writes them into the renderer's instance data.
+	 * @note The renderer's slots must match the handles. Does nothing if no transform changed.
+	 *
+	 * @param renderer The renderer to write to.
+	 */
+	void update(c_instanced_renderer& renderer);
+	/**
+	 * @brief Gets the range of transforms that changed since the last call and clears it.
+	 * @note For users other than the instanced renderer, e.g. c_static_batcher.
+	 *
+	 * @param begin Set to the first changed handle.
+	 * @param end Set to one past the last changed handle.
+	 * @return False if nothing changed.
+	 */
+	bool take_dirty_range(size_t& begin, size_t& end);
+	/**
+	 * @brief Builds the model matrix of one transform.
+	 * @param handle The handle returned by add.
+	 * @return The model matrix.
+	 */
+	glm::mat4 get_model_matrix(int handle) const;
+
+	// == Transformation Methods ==
+	// The setters mark the transform dirty, it is rebuilt on the next update.
+	void set_position(int handle, glm::vec3 position);
+	void set_rotation(int handle, float rotation);
+	void set_scale(int handle, glm::vec3 scale);
+
+	glm::vec3 get_position(int handle) const { return glm::vec3(position_x_[handle], position_y_[handle], position_z_[handle]); }
+	float get_rotation(int handle) const { return rotation_[handle]; }
+	glm::vec3 get_scale(int handle) const { return glm::vec3(scale_x_[handle], scale_y_[handle], scale_z_[handle]); }
+	size_t get_count() const { return rotation_.size(); }
+
+	// == Bounds ==
+	// World-space AABBs as arrays, the centre is the position. Read by c_frustum::cull.
+	const float* get_centers_x() const { return position_x_.data(); }
+	const float* get_centers_y() const { return position_y_.data(); }
+	const float* get_centers_z() const { return position_z_.data(); }
+	const float* get_extents_x() const { return extent_x_.data(); }
+	const float* get_extents_y() const { return extent_y_.data(); }
+	const float* get_extents_z() const { return extent_z_.data(); }
+
+private:
+
+	// == Private Methods ==
+	/**
+	 * @brief Adds a transform to the range that needs rebuilding.
+	 * @param handle The changed transform.
+	 */
+	void mark_dirty(size_t handle);
+	/**
+	 * @brief Recalculates the world-space half extents of a transform after its rotation or scale changed.
+	 * @param handle The transform.
+	 */
+	void update_extents(size_t handle);
+
+	// == Private Members ==
+	std::vector<float> position_x_, position_y_, position_z_;
+	std::vector<float> rotation_;              // Degrees, only read by get_rotation.
+	std::vector<float> sin_, cos_;             // Cached from the rotation so the batch kernel never calls trig functions.
+	std::vector<float> scale_x_, scale_y_, scale_z_;
+	std::vector<glm::vec3> local_extents_;     // Bounding box half extents before the transform.
+	std::vector<float> extent_x_, extent_y_, extent_z_; // World-space bounding box half extents.
+	size_t dirty_begin_ = 0;                   // First transform that needs rebuilding.
+	size_t dirty_end_ = 0;                     // One past the last transform that needs rebuilding, equal to dirty_begin_ if clean.
+};
@@ -0,0 +1,162 @@
+﻿#include "c_voxel_chunk.h"
+#include <algorithm>
+#include "c_voxel_world.h"
+
+c_voxel_chunk::c_voxel_chunk(const glm::ivec3& chunk_coord)
+	: chunk_coord_(chunk_coord), blocks_(size * size * size, 0)
+{}
+
+void c_voxel_chunk::set_block(const glm::ivec3& local, uint8_t block)
+{
+	uint8_t& current = blocks_[get_index(local)];
+	if (current == block)
+	{
+		return;
+	}
+
+	// Keep the count for the stats.
+	voxel_count_ += (block != 0) - (current != 0);
+	current = block;
+	dirty_ = true;
+}
+
+void c_voxel_chunk::build_mesh(const c_voxel_world& world, const std::vector<s_texture>& textures)
+{
+	dirty_ = false;
+	quad_count_ = 0;
+	std::vector<s_vertex> vertices;
+	std::vector<GLuint> indices;
+	const glm::vec3 origin = glm::vec3(chunk_coord_ * size) - glm::vec3(0.5f); // Cell centres are on the integers.
+
+	// One pass per axis and direction. u and v are the two axes in the face plane, u x v = the axis.
+	std::vector<uint8_t> mask(size * size);
+	for (int axis = 0; axis < 3; axis++)
+	{
+		const int u = (axis + 1) % 3;
+		const int v = (axis + 2) % 3;
+		for (int direction = -1; direction <= 1; direction += 2)
+		{
+			glm::ivec3 step(0);
+			step[axis] = direction;
+
+			for (int layer = 0; layer < size; layer++)
+			{
+				// Mask the faces in this layer that can be seen, a face is hidden if the cell in front of it is solid.
+				glm::ivec3 cell(0);
+				cell[axis] = layer;
+				for (int b = 0; b < size; b++)
+				{
+					cell[v] = b;
+					for (int a = 0; a < size; a++)
+					{
+						cell[u] = a;
+						const uint8_t block = blocks_[get_index(cell)];
+						mask[b * size + a] = (block != 0 && get_block_or_neighbour(world, cell + step) == 0) ? block : 0;
+					}
+				}
+
+				// Greedily merge the mask into rectangles, widest first then as tall as the whole row allows.
+				for (int b = 0; b < size; b++)
+				{
+					for (int a = 0; a < size;)
+					{
+						const uint8_t block = mask[b * size + a];
+						if (block == 0)
+						{
+							a++;
+							continue;
+						}
+
+						int width = 1;
+						while (a + width < size && mask[b * size + a + width] == block)
+						{
+							width++;
+						}
+						int height = 1;
+						bool row_matches = true;
+						while (b + height < size && row_matches)
+						{
+							for (int k = 0; k < width; k++)
+							{
+								if (mask[(b + height) * size + a + k] != block)
+								{
+									row_matches = false;
+									break;
+								}
+							}
+							if (row_matches)
+							{
+								height++;
+							}
+						}
+
+						// Clear the merged faces.
+						for (int h = 0; h < height; h++)
+						{
+							std::fill(&mask[(b + h) * size + a], &mask[(b + h) * size + a] + width, static_cast<uint8_t>(0));
+						}
+
+						// The quad lies on the near side of the layer for -axis faces and the far side for +axis faces.
+						glm::vec3 corner(0.0f);
+						corner[axis] = static_cast<float>(layer + (direction > 0 ? 1 : 0));
+						corner[u] = static_cast<float>(a);
+						corner[v] = static_cast<float>(b);
+						glm::vec3 du(0.0f);
+						glm::vec3 dv(0.0f);
+						du[u] = static_cast<float>(width);
+						dv[v] = static_cast<float>(height);
+						glm::vec3 normal(0.0f);
+						normal[axis] = static_cast<float>(direction);
+
+						// The texture repeats once per voxel across the merged quad.
+						const GLuint first = static_cast<GLuint>(vertices.size());
+						const float w = static_cast<float>(width);
+						const float h = static_cast<float>(height);
+						vertices.push_back({ origin + corner, normal, glm::vec2(0.0f, 0.0f) });
+						vertices.push_back({ origin + corner + du, normal, glm::vec2(w, 0.0f) });
+						vertices.push_back({ origin + corner + du + dv, normal, glm::vec2(w, h) });
+						vertices.push_back({ origin + corner + dv, normal, glm::vec2(0.0f, h) });
+
+						// Counter-clockwise seen from the front. u x v points along +axis, so flip for -axis faces.
+						if (direction > 0)
+						{
+							indices.insert(indices.end(), { first, first + 1, first + 2, first, first + 2, first + 3 });
+						}
+						else
+						{
+							indices.insert(indices.end(), { first, first + 2, first + 1, first, first + 3, first + 2 });
+						}
+						quad_count_++;
+						a += width;
+					}
+				}
+			}
+		}
+	}
+
+	// Replace the mesh, the old geometry is freed with it.
+	mesh_.reset();
+	if (!indices.empty())
+	{
+		mesh_ = std::make_unique<c_mesh>(vertices, indices, textures);
+	}
+}
+
+void c_voxel_chunk::draw(GLuint program_id, int texture_index) const
+{
+	if (mesh_)
+	{
+		mesh_->draw(program_id, texture_index);
+	}
+}
+
+// == Private Methods ==
+uint8_t c_voxel_chunk::get_block_or_neighbour(const c_voxel_world& world, const glm::ivec3& local) const
+{
+	// Inside the chunk, read directly.
+	if (local.x >= 0 && local.y >= 0 && local.z >= 0 && local.x < size && local.y < size && local.z < size)
+	{
+		return blocks_[get_index(local)];
+	}
+	return world.get_block(chunk_coord_ * size + local);
+}
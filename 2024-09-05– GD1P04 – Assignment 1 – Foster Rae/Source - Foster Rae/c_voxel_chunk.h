@@ -0,0 +1,98 @@
+﻿// /***********************************************************************
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+// (c) 2024 Media Design School
+// File Name : c_voxel_chunk.h
+// Description : Class that holds a 32x32x32 block of voxels and greedy meshes it.
+// Author : Foster Rae
+// Mail : Foster.Rae@mds.ac.nz
+// ************************************************************************/
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Dependencies/GLM/glm.hpp"
+#include "c_mesh.h"
+#include "c_structs.h"
+
+class c_voxel_world;
+
+/**
+ * @class c_voxel_chunk
+ * @brief A cube of voxels turned into one mesh, with hidden faces removed and coplanar faces merged into larger quads.
+ * @note A voxel at cell p covers p - 0.5 to p + 0.5, the same space as a unit c_cube at p.
+ */
+class c_voxel_chunk
+{
+public:
+
+	// == Constructors and Destructors ==
+	/**
+	 * @brief Construct an empty chunk.
+	 * @param chunk_coord The chunk's position in chunks. (cell / size)
+	 */
+	explicit c_voxel_chunk(const glm::ivec3& chunk_coord);
+
+	// == Public Methods ==
+	/**
+	 * @brief Sets a voxel and marks the chunk for remeshing.
+	 * @param local The cell within the chunk, 0 to size - 1 on each axis.
+	 * @param block The block type, 0 for empty.
+	 */
+	void set_block(const glm::ivec3& local, uint8_t block);
+	/**
+	 * @brief Gets a voxel.
+	 * @param local The cell within the chunk, 0 to size - 1 on each axis.
+	 * @return The block type, 0 for empty.
+	 */
+	uint8_t get_block(const glm::ivec3& local) const { return blocks_[get_index(local)]; }
+	/**
+	 * @brief Rebuilds the mesh from the voxels with greedy meshing.
+	 * @note Faces against a solid voxel, in this chunk or a neighbouring one, are skipped. Visible faces
+	 *       with the same block type and direction are merged into the largest rectangles that fit.
+	 *
+	 * @param world The world, used to look at voxels across the chunk border.
+	 * @param textures The material of the mesh.
+	 */
+	void build_mesh(const c_voxel_world& world, const std::vector<s_texture>& textures);
+	/**
+	 * @brief Draws the chunk mesh.
+	 * @param program_id The shader program to use.
+	 * @param texture_index The texture array layer to use.
+	 */
+	void draw(GLuint program_id, int texture_index) const;
+
+	// == Accessors ==
+	bool get_dirty() const { return dirty_; }
+	void set_dirty() { dirty_ = true; }
+	int get_voxel_count() const { return voxel_count_; }
+	int get_quad_count() const { return quad_count_; }
+	glm::vec3 get_bounds_min() const { return glm::vec3(chunk_coord_ * size) - glm::vec3(0.5f); }
+	glm::vec3 get_bounds_max() const { return get_bounds_min() + glm::vec3(static_cast<float>(size)); }
+
+	// == Constants ==
+	static constexpr int size = 32; // Cells per side.
+
+private:
+
+	// == Private Methods ==
+	static int get_index(const glm::ivec3& local) { return (local.y * size + local.z) * size + local.x; }
+	/**
+	 * @brief Gets a voxel that may be outside the chunk.
+	 *
+	 * @param world The world, used for cells outside the chunk.
+	 * @param local The cell relative to the chunk.
+	 * @return The block type, 0 for empty.
+	 */
+	uint8_t get_block_or_neighbour(const c_voxel_world& world, const glm::ivec3& local) const;
+
+	// == Private Members ==
+	glm::ivec3 chunk_coord_;
+	std::vector<uint8_t> blocks_;  // size^3 block types, 0 = empty.
+	std::unique_ptr<c_mesh> mesh_; // Null if the chunk has no visible faces.
+	bool dirty_ = true;            // The mesh is out of date.
+	int voxel_count_ = 0;
+	int quad_count_ = 0;
+};
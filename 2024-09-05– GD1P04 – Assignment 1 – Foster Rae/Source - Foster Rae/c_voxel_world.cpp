@@ -0,0 +1,133 @@
+﻿#include "c_voxel_world.h"
+
+c_voxel_world::c_voxel_world(const std::vector<s_texture>& textures)
+	: textures_(textures)
+{}
+
+void c_voxel_world::set_block(const glm::ivec3& cell, uint8_t block)
+{
+	glm::ivec3 local;
+	const glm::ivec3 chunk_coord = get_chunk_coord(cell, local);
+
+	// Create the chunk on first use, there is no point creating one to clear a voxel.
+	auto it = chunks_.find(get_key(chunk_coord));
+	if (it == chunks_.end())
+	{
+		if (block == 0)
+		{
+			return;
+		}
+		it = chunks_.emplace(get_key(chunk_coord), std::make_unique<c_voxel_chunk>(chunk_coord)).first;
+	}
+	if (it->second->get_block(local) == block)
+	{
+		return;
+	}
+	it->second->set_block(local, block);
+
+	// Faces of the neighbours touching this voxel may have changed.
+	for (int axis = 0; axis < 3; axis++)
+	{
+		glm::ivec3 offset(0);
+		if (local[axis] == 0)
+		{
+			offset[axis] = -1;
+			mark_dirty(chunk_coord + offset);
+		}
+		else if (local[axis] == c_voxel_chunk::size - 1)
+		{
+			offset[axis] = 1;
+			mark_dirty(chunk_coord + offset);
+		}
+	}
+}
+
+uint8_t c_voxel_world::get_block(const glm::ivec3& cell) const
+{
+	glm::ivec3 local;
+	const auto it = chunks_.find(get_key(get_chunk_coord(cell, local)));
+	return (it == chunks_.end()) ? 0 : it->second->get_block(local);
+}
+
+void c_voxel_world::update()
+{
+	for (auto& entry : chunks_)
+	{
+		if (entry.second->get_dirty())
+		{
+			entry.second->build_mesh(*this, textures_);
+		}
+	}
+}
+
+void c_voxel_world::draw(GLuint program_id, int texture_index, const c_frustum& frustum) const
+{
+	// Chunk vertices are already in world space, so the model matrix is the identity.
+	// The mesh VAOs have no instance buffer, so set the constant attribute value like c_cube does.
+	const glm::mat4 identity(1.0f);
+	for (GLuint i = 0; i < 4; i++)
+	{
+		glVertexAttrib4fv(c_mesh::instance_transform_location + i, &identity[i][0]);
+	}
+
+	for (const auto& entry : chunks_)
+	{
+		const c_voxel_chunk& chunk = *entry.second;
+		const glm::vec3 center = (chunk.get_bounds_min() + chunk.get_bounds_max()) * 0.5f;
+		if (frustum.is_box_visible(center, glm::vec3(c_voxel_chunk::size * 0.5f)))
+		{
+			chunk.draw(program_id, texture_index);
+		}
+	}
+}
+
+int c_voxel_world::get_voxel_count() const
+{
+	int count = 0;
+	for (const auto& entry : chunks_)
+	{
+		count += entry.second->get_voxel_count();
+	}
+	return count;
+}
+
+int c_voxel_world::get_quad_count() const
+{
+	int count = 0;
+	for (const auto& entry : chunks_)
+	{
+		count += entry.second->get_quad_count();
+	}
+	return count;
+}
+
+// == Private Methods ==
+uint64_t c_voxel_world::get_key(const glm::ivec3& chunk_coord)
+{
+	// 21 bits per axis, the mask keeps negative coordinates from spilling into the other axes.
+	const uint64_t mask = (1ull << 21) - 1;
+	return ((static_cast<uint64_t>(chunk_coord.x) & mask) << 42)
+		| ((static_cast<uint64_t>(chunk_coord.y) & mask) << 21)
+		| (static_cast<uint64_t>(chunk_coord.z) & mask);
+}
+
+glm::ivec3 c_voxel_world::get_chunk_coord(const glm::ivec3& cell, glm::ivec3& local)
+{
+	// Floor division so negative cells go to the chunk below, not towards zero.
+	glm::ivec3 chunk_coord;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		chunk_coord[axis] = (cell[axis] >= 0) ? cell[axis] / c_voxel_chunk::size : (cell[axis] + 1) / c_voxel_chunk::size - 1;
+		local[axis] = cell[axis] - chunk_coord[axis] * c_voxel_chunk::size;
+	}
+	return chunk_coord;
+}
+
+void c_voxel_world::mark_dirty(const glm::ivec3& chunk_coord)
+{
+	const auto it = chunks_.find(get_key(chunk_coord));
+	if (it != chunks_.end())
+	{
+		it->second->set_dirty();
+	}
+}
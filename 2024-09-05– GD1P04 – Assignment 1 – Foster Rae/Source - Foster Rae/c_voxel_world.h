@@ -0,0 +1,95 @@
+﻿// /***********************************************************************
+// Bachelor of Software Engineering
+// Media Design School
+// Auckland
+// New Zealand
+// (c) 2024 Media Design School
+// File Name : c_voxel_world.h
+// Description : Class that stores voxels in chunks and keeps the chunk meshes up to date.
+// Author : Foster Rae
+// Mail : Foster.Rae@mds.ac.nz
+// ************************************************************************/
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "Dependencies/GLM/glm.hpp"
+#include "c_voxel_chunk.h"
+#include "c_frustum.h"
+
+/**
+ * @class c_voxel_world
+ * @brief A sparse grid of c_voxel_chunk, each drawn as one greedy-meshed mesh.
+ * @note Chunks are created the first time a voxel in them is set. Changing a voxel on a chunk border
+ *       also remeshes the neighbour, whose faces against it may have appeared or disappeared.
+ */
+class c_voxel_world
+{
+public:
+
+	// == Constructors and Destructors ==
+	/**
+	 * @brief Construct an empty world.
+	 * @param textures The material every chunk mesh uses.
+	 */
+	explicit c_voxel_world(const std::vector<s_texture>& textures);
+
+	// == Public Methods ==
+	/**
+	 * @brief Sets a voxel.
+	 * @param cell The world cell, a unit cube centred on the point.
+	 * @param block The block type, 0 for empty.
+	 */
+	void set_block(const glm::ivec3& cell, uint8_t block);
+	/**
+	 * @brief Gets a voxel.
+	 * @param cell The world cell.
+	 * @return The block type, 0 for empty or if the chunk doesn't exist.
+	 */
+	uint8_t get_block(const glm::ivec3& cell) const;
+	/**
+	 * @brief Remeshes every chunk that changed since the last update. Call on the GL thread.
+	 */
+	void update();
+	/**
+	 * @brief Draws every chunk that is at least partly inside the frustum.
+	 *
+	 * @param program_id The shader program to use.
+	 * @param texture_index The texture array layer to use.
+	 * @param frustum The camera frustum.
+	 */
+	void draw(GLuint program_id, int texture_index, const c_frustum& frustum) const;
+
+	// == Accessors ==
+	size_t get_chunk_count() const { return chunks_.size(); }
+	int get_voxel_count() const;
+	int get_quad_count() const;
+
+private:
+
+	// == Private Methods ==
+	/**
+	 * @brief Packs a chunk coordinate into a map key.
+	 * @param chunk_coord The chunk coordinate, each axis must fit in 21 bits.
+	 * @return The key.
+	 */
+	static uint64_t get_key(const glm::ivec3& chunk_coord);
+	/**
+	 * @brief Splits a world cell into its chunk and the cell within the chunk.
+	 *
+	 * @param cell The world cell.
+	 * @param local Set to the cell within the chunk.
+	 * @return The chunk coordinate.
+	 */
+	static glm::ivec3 get_chunk_coord(const glm::ivec3& cell, glm::ivec3& local);
+	/**
+	 * @brief Marks a chunk for remeshing if it exists.
+	 * @param chunk_coord The chunk coordinate.
+	 */
+	void mark_dirty(const glm::ivec3& chunk_coord);
+
+	// == Private Members ==
+	std::vector<s_texture> textures_;
+	std::unordered_map<uint64_t, std::unique_ptr<c_voxel_chunk>> chunks_;
+};
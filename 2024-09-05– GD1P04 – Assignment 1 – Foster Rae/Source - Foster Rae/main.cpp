@@ -1,4 +1,4 @@
-/***********************************************************************
+﻿/***********************************************************************
 Bachelor of Software Engineering
 Media Design School
 Auckland
@@ -9,20 +9,59 @@ Description : Entrance point for the OpenGL pipeline.
 Author : Foster Rae
 Mail : Foster.Rae@mds.ac.nz
 ************************************************************************/
+#include <algorithm>
+#include <filesystem>
 #include <stb_image.h>
 #include <ext/matrix_clip_space.hpp> // For glm::ortho
 #include "c_graphics_utils.h"
+#include "c_asset_pack.h"
+#include "c_scene.h"
 #include "c_structs.h"
 #include "c_camera.h"
 #include "c_cube.h"
+#include "c_instanced_renderer.h"
+#include "c_benchmark.h"
+#include "c_texture_cooker.h"
+#include "c_mesh_optimizer.h"
+#include "c_frame_constants.h"
+#include "c_gl_state.h"
+#include "c_texture_manager.h"
+#include "c_texture_cache.h"
+#include "c_transform_store.h"
+#include "c_frustum.h"
+#include "c_bvh.h"
+#include "c_voxel_world.h"
+#include "c_static_batcher.h"
+#include "c_sprite_atlas.h"
+#include "c_sprite_animation.h"
+#include "c_sprite_batcher.h"
 
 // == Global Variables ==
 GLFWwindow* window;
 std::string window_title;
+c_asset_pack asset_pack;     // Every resource in one mapped file, read instead of the loose files if Assets.pak exists.
 c_camera camera;
 GLuint vao, vbo, ebo; 
-std::vector<c_cube*> cubes;  // Vector of cube objects.
+c_transform_store scene_transforms;  // Cube transforms, the handles match the cube renderer slots. Cubes are only their handle.
+c_transform_store ui_transforms;     // UI cube transform.
+c_bvh scene_bvh;                     // Tree over the cube bounds for culling and picking.
+c_transform_store static_transforms; // Transforms of the cubes drawn through the static batches.
+c_bvh static_bvh;                    // Tree over the static cube bounds for picking.
+c_static_batcher* static_batcher;    // Merges the static cubes into one mesh per region.
+c_cube* active_cube = nullptr;       // The cube controlled by the user, the only cube with a c_cube. Wraps a handle in either store.
+c_voxel_world* voxel_world;          // Terrain, meshed per chunk.
+std::vector<int> visible_cubes;      // Cubes that passed frustum culling this frame.
+int culled_cube_count = 0;           // Cubes outside the frustum this frame.
+c_instanced_renderer* cube_renderer; // Draws every cube in one instanced call.
 GLuint shader_program;
+GLuint sprite_program;               // Draws the batched 2D sprites.
+c_texture_cache* texture_cache;      // Shares the standalone 2D textures and atlases, evicts the unused ones over its budget.
+c_sprite_atlas* sprite_atlas;        // Coin and run animation frames packed into one texture.
+c_sprite_batcher* sprite_batcher;    // Draws the UI sprites.
+std::vector<c_sprite_animation> sprite_animations; // Coin spin and character run, they only change UVs.
+c_frame_constants* frame_constants; // Camera, time and resolution uniform buffer shared by every program.
+const int world_pass = 0;           // Frame constants pass for the 3D scene.
+const int ui_pass = 1;              // Frame constants pass for the orthographic UI.
 int frame_count = 0;         // Frame count for FPS calculation.
 double elapsed_time = 0.0;   // Elapsed time for FPS calculation.
 bool wireframe_mode = false; // Flag for wireframe mode on/off.
@@ -35,6 +74,11 @@ bool is_mouse_hovering_ui = false; // Flag for mouse hovering over the UI cube.
 bool is_mouse_clicked = false;     // Flag for mouse click.
 bool is_texture_changed = false;   // Flag for texture change on click.
 size_t active_texture_index = 0;   // Index of the active texture.
+c_texture_manager* texture_manager; // Packs the textures into texture arrays.
+std::vector<std::string> texture_paths; // Texture files of the cube material, indexed by active_texture_index.
+std::vector<int> texture_layers;    // Texture array layer of each texture, indexed by active_texture_index.
+int cube_texture_layer = 0;         // Texture layer currently in the cube instances.
+const char* scene_path = "Resources/Scenes/main.scene"; // Loaded instead of the built-in cubes if it exists.
 // Time variables.
 GLfloat current_time;
 GLfloat previous_time = 0.0f;
@@ -63,9 +107,60 @@ void render();
  * @brief Handles input processing.
  */
 void process_input(void* glfw_window);
+/**
+ * @brief Writes the cubes to a scene file that initial_setup can load instead of building them.
+ *
+ * @param file_path The file to write.
+ * @return True if the file was written.
+ */
+bool export_scene(const char* file_path);
 
-int main()
+int main(int argc, char* argv[])
 {
+	// Run a benchmark instead of the pipeline if asked. (e.g. --benchmark uniforms)
+	if (argc >= 3 && std::string(argv[1]) == "--benchmark")
+	{
+		return c_benchmark::run(argv[2]);
+	}
+	// Cook the textures instead of running the pipeline if asked. (e.g. --cook-textures Resources/Textures Resources/Cooked)
+	if (argc >= 2 && std::string(argv[1]) == "--cook-textures")
+	{
+		const char* source_dir = (argc >= 3) ? argv[2] : c_texture_cooker::default_source_dir;
+		const char* output_dir = (argc >= 4) ? argv[3] : c_texture_cooker::default_output_dir;
+		return (c_texture_cooker::cook_directory(source_dir, output_dir) < 0) ? -1 : 0;
+	}
+	// Write the scene out once it is set up, then quit. (e.g. --export-scene Resources/Scenes/main.scene)
+	const char* export_scene_path = nullptr;
+	if (argc >= 2 && std::string(argv[1]) == "--export-scene")
+	{
+		export_scene_path = (argc >= 3) ? argv[2] : scene_path;
+	}
+	// Pack the resources instead of running the pipeline if asked. (e.g. --pack-assets Assets.pak Resources test.vert)
+	if (argc >= 2 && std::string(argv[1]) == "--pack-assets")
+	{
+		const char* output_path = (argc >= 3) ? argv[2] : "Assets.pak";
+		std::vector<std::string> sources;
+		for (int i = 3; i < argc; i++)
+		{
+			sources.push_back(argv[i]);
+		}
+		if (sources.empty())
+		{
+			sources = { "Resources", "test.vert", "test.frag", "sprite.vert", "sprite.frag" };
+		}
+		return (c_asset_pack::build(sources, output_path) < 0) ? -1 : 0;
+	}
+	// Print the vertex cache statistics of the meshes before and after optimizing. (e.g. --mesh-report Resources/Models)
+	if (argc >= 2 && std::string(argv[1]) == "--mesh-report")
+	{
+		std::vector<std::string> sources(argv + 2, argv + argc);
+		if (sources.empty())
+		{
+			sources = { "Resources" };
+		}
+		return (c_mesh_optimizer::report(sources) < 0) ? -1 : 0;
+	}
+
 	// Initialize GLFW.
 	c_graphics_utils::initialize_glfw();
 
@@ -80,8 +175,22 @@ int main()
 	c_graphics_utils::initialize_glew();
 
 	// Set up the pipeline.
+	const double setup_start_time = glfwGetTime();
 	initial_setup();
 
+	// Print the startup metrics.
+	const s_program_cache_stats& cache_stats = c_shader_loader::get_cache_stats();
+	std::cout << "Startup: " << (glfwGetTime() - setup_start_time) * 1000.0 << " ms (programs: " << cache_stats.load_time_ms << " ms, "
+		<< cache_stats.hits << " cache hits, " << cache_stats.misses << " misses, " << cache_stats.rejected << " rejected)" << '\n';
+
+	// Export instead of running, the loop is skipped and everything is cleaned up as normal.
+	int exit_code = 0;
+	if (export_scene_path != nullptr)
+	{
+		exit_code = export_scene(export_scene_path) ? 0 : -1;
+		glfwSetWindowShouldClose(window, GLFW_TRUE);
+	}
+
 	// Main loop.
 	while (glfwWindowShouldClose(window) == false)
 	{
@@ -90,32 +199,45 @@ int main()
 	}
 
 	// Clean up.
+	// Delete the GL objects before the context is destroyed.
+	delete cube_renderer;
+	delete static_batcher; // Waits for any rebuild in flight.
+	delete voxel_world;
+	delete frame_constants;
+	// Delete the cube objects, the shared cube geometry is freed with the last cube.
+	delete active_cube;
+	delete ui_cube;
+	delete texture_manager;
+	delete sprite_batcher;
+	delete sprite_atlas;
+	delete texture_cache; // After everything holding a reference to its textures.
 	glfwTerminate();
-	// Delete the cube objects.
-	for (auto& cube : cubes)
-	{
-		delete cube;
-	}
 
-	return 0;
+	return exit_code;
 }
 
 void initial_setup()
 {
 	// Set Blending.
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); // Set to general blend.
+	c_gl_state::set_capability(GL_BLEND, true);
+	c_gl_state::set_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); // Set to general blend.
 	// Enable depth testing.
-	glEnable(GL_DEPTH_TEST);
-	glDepthFunc(GL_LESS);
+	c_gl_state::set_capability(GL_DEPTH_TEST, true);
+	c_gl_state::set_depth_func(GL_LESS);
 	// Enable face culling.
-	glEnable(GL_CULL_FACE);
-	glCullFace(GL_BACK);
-	glFrontFace(GL_CCW);
+	c_gl_state::set_capability(GL_CULL_FACE, true);
+	c_gl_state::set_cull_face(GL_BACK);
+	c_gl_state::set_front_face(GL_CCW);
 
 	// Flip images vertically.
 	stbi_set_flip_vertically_on_load(true);
 
+	// Read the resources from the asset pack if there is one, before anything starts loading.
+	if (std::filesystem::exists("Assets.pak") && asset_pack.open("Assets.pak"))
+	{
+		c_asset_pack::mount(&asset_pack);
+	}
+
 	// Hide & capture the cursor.
 	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 	glfwSetInputMode(window, GLFW_RAW_MOUSE_MOTION, GLFW_TRUE);
@@ -123,21 +245,78 @@ void initial_setup()
 	// Set the mouse callback function.
 	glfwSetCursorPosCallback(window, mouse_callback); // Look I found a reason to use the mouse pos callback.
 
-	// Create the shader program.
-	shader_program = c_shader_loader::create_program("test.vert", "test.frag");
+	// Start compiling the shader program, the driver works on it while the textures and scene are set up.
+	const int shader_handle = c_shader_loader::submit_program("test.vert", "test.frag");
+	const int sprite_shader_handle = c_shader_loader::submit_program("sprite.vert", "sprite.frag");
+
+	// Create the frame constants buffer, one block for the world pass and one for the UI pass.
+	frame_constants = new c_frame_constants(2);
+
+	// Open the scene file, it names the cube textures. Clicking the UI cube swaps between the first two.
+	c_scene scene;
+	const bool scene_loaded = (!c_asset_pack::find_mounted(scene_path).empty() || std::filesystem::exists(scene_path)) && scene.open(scene_path);
+	const std::vector<std::string> built_in_texture_paths = { "Resources/Textures/texture_diffuse1.png", "Resources/Textures/texture_diffuse2.png" };
+	texture_paths = built_in_texture_paths;
+	if (scene_loaded && scene.get_texture_paths().size() >= 2)
+	{
+		texture_paths = scene.get_texture_paths();
+	}
 
 	// === LOAD TEXTURES HERE ===
-	std::vector<s_texture> textures;
-	// Texture 1
-	s_texture texture1;
-	texture1.id = c_graphics_utils::load_image("Resources/Textures/texture_diffuse1.png");
-	texture1.type = "texture_diffuse";
-	textures.push_back(texture1);
-	// Texture 2
-	s_texture texture2;
-	texture2.id = c_graphics_utils::load_image("Resources/Textures/texture_diffuse2.png");
-	texture2.type = "texture_diffuse";
-	textures.push_back(texture2);
+	// The material only binds one array, so every texture has to land in the same one. Scene textures that don't (one
+	// failed to load, or they differ in size or format) are swapped for the built-in ones, which match.
+	std::vector<int> texture_handles;
+	while (true)
+	{
+		texture_manager = new c_texture_manager();
+		texture_handles.clear();
+		for (const std::string& path : texture_paths)
+		{
+			texture_handles.push_back(texture_manager->add(path.c_str()));
+		}
+		texture_manager->build(); // Only reads the image headers, the pixels are decoded in the background and streamed in by update.
+
+		const GLuint array = texture_manager->get_texture(texture_handles[0]).id;
+		const bool one_array = std::all_of(texture_handles.begin(), texture_handles.end(), [array](int handle)
+		{
+			return handle >= 0 && texture_manager->get_texture(handle).id == array;
+		});
+		if (one_array || texture_paths == built_in_texture_paths)
+		{
+			break;
+		}
+		std::cout << "Scene textures don't share one texture array, using the built-in textures." << '\n';
+		delete texture_manager;
+		texture_paths = built_in_texture_paths;
+	}
+	std::vector<s_texture> textures = { texture_manager->get_texture(texture_handles[0]) };
+	for (int handle : texture_handles)
+	{
+		texture_layers.push_back(texture_manager->get_layer(handle));
+	}
+
+	// Sprite animation frames, packed into one atlas so every sprite shares a texture bind.
+	texture_cache = new c_texture_cache();
+	sprite_atlas = new c_sprite_atlas(texture_cache);
+	std::vector<std::string> coin_frames;
+	for (int i = 0; i <= 14; i++)
+	{
+		const std::string number = std::to_string(i);
+		coin_frames.push_back("Resources/Textures/coin/tile" + std::string(3 - number.size(), '0') + number + ".png");
+	}
+	std::vector<std::string> run_frames;
+	for (int i = 1; i <= 10; i++)
+	{
+		run_frames.push_back("Resources/Textures/Run (" + std::to_string(i) + ").png");
+	}
+	const int coin_sequence = sprite_atlas->add_sequence(coin_frames);
+	const int run_sequence = sprite_atlas->add_sequence(run_frames);
+	if (sprite_atlas->build())
+	{
+		sprite_animations.emplace_back(*sprite_atlas, coin_sequence, 15.0f);
+		sprite_animations.emplace_back(*sprite_atlas, run_sequence, 12.0f);
+	}
+	sprite_batcher = new c_sprite_batcher();
 
 	// === CREATE OBJECTS HERE ===
 	// Cubes.
@@ -146,35 +325,92 @@ void initial_setup()
 	float z_offset = -5.0f;
 	float x_offset = -2.0f;
 
-	cubes.push_back(new c_cube(textures, glm::vec3(-1.0f, -1.0f, -2.0f), 0.0f, glm::vec3(1.0f, 1.0f, 1.0f)));
-	// First layer of cubes.
+	// Terrain. The grid layers are voxels, so the faces between them are never drawn.
+	voxel_world = new c_voxel_world(textures);
+	// First layer of voxels.
 	for (int x = 0; x < grid_size; ++x)
 	{
 		for (int z = 0; z < grid_size; ++z)
 		{
 			glm::vec3 position((static_cast<float>(x) * spacing) + x_offset, -2.0f, (static_cast<float>(z) * spacing) + z_offset);
-			cubes.push_back(new c_cube(textures, position, 0.0f, glm::vec3(1.0f, 1.0f, 1.0f)));
+			voxel_world->set_block(glm::ivec3(glm::round(position)), 1);
 		}
 	}
-	// Second layer of cubes.
+	// Second layer of voxels.
 	for (int x = 0; x < grid_size - 2; ++x)
 	{
 		for (int z = 0; z < grid_size - 2; ++z)
 		{
 			glm::vec3 position((static_cast<float>(x) * spacing) + x_offset + 1, -3.0f, (static_cast<float>(z) * spacing) + z_offset + 1);
-			cubes.push_back(new c_cube(textures, position, 0.0f, glm::vec3(1.0f, 1.0f, 1.0f)));
+			voxel_world->set_block(glm::ivec3(glm::round(position)), 1);
 		}
 	}
-	// Decor cubes.
-	cubes.push_back(new c_cube(textures, glm::vec3(-1.0f, -3.0f, -1.0f), 0.0f, glm::vec3(1.0f, 1.0f, 1.0f)));
-	cubes.push_back(new c_cube(textures, glm::vec3(-1.0f, -4.0f, -2.0f), 0.0f, glm::vec3(1.0f, 1.0f, 1.0f)));
-	cubes.push_back(new c_cube(textures, glm::vec3(-1.0f, -4.0f, -3.0f), 0.0f, glm::vec3(1.0f, 1.0f, 1.0f)));
-	cubes.push_back(new c_cube(textures, glm::vec3(0.0f, -4.0f, -3.0f), 0.0f, glm::vec3(1.0f, 1.0f, 1.0f)));
-	cubes.push_back(new c_cube(textures, glm::vec3(-1.0f, -4.0f, -4.0f), 0.0f, glm::vec3(1.0f, 1.0f, 1.0f)));
-	cubes.push_back(new c_cube(textures, glm::vec3(-2.0f, -3.0f, -2.0f), 0.0f, glm::vec3(1.0f, 1.0f, 1.0f)));
-	cubes.push_back(new c_cube(textures, glm::vec3(-2.0f, -3.0f, -3.0f), 0.0f, glm::vec3(1.0f, 1.0f, 1.0f)));
-	// Set the active cube.
-	cubes[0]->set_active_cube(true);
+	voxel_world->update();
+	std::cout << "Voxel terrain: " << voxel_world->get_voxel_count() << " voxels in " << voxel_world->get_chunk_count()
+		<< " chunks, " << voxel_world->get_quad_count() << " quads (" << voxel_world->get_voxel_count() * 6 << " as cubes)" << '\n';
+	if (scene_loaded)
+	{
+		// Each group is bulk loaded into its store, no object is created per cube.
+		for (size_t i = 0; i < scene.get_groups().size(); i++)
+		{
+			const s_scene_group& group = scene.get_groups()[i];
+			if (scene.get_mesh_names()[group.mesh] != "cube")
+			{
+				std::cout << "Skipping scene group with unknown mesh: " << scene.get_mesh_names()[group.mesh] << '\n';
+				continue;
+			}
+			const bool is_static = (group.flags & c_scene::static_flag) != 0;
+			scene.load_group(i, is_static ? static_transforms : scene_transforms);
+		}
+	}
+	else
+	{
+		// Built-in scene, --export-scene writes it out as the scene file.
+		scene_transforms.add(glm::vec3(-1.0f, -1.0f, -2.0f), 0.0f, glm::vec3(1.0f, 1.0f, 1.0f));
+		// Decor cubes, these never move unless picked so they are drawn through the static batches.
+		const glm::vec3 decor_positions[] = {
+			glm::vec3(-1.0f, -3.0f, -1.0f), glm::vec3(-1.0f, -4.0f, -2.0f), glm::vec3(-1.0f, -4.0f, -3.0f), glm::vec3(0.0f, -4.0f, -3.0f),
+			glm::vec3(-1.0f, -4.0f, -4.0f), glm::vec3(-2.0f, -3.0f, -2.0f), glm::vec3(-2.0f, -3.0f, -3.0f)
+		};
+		for (const glm::vec3& position : decor_positions)
+		{
+			static_transforms.add(position, 0.0f, glm::vec3(1.0f, 1.0f, 1.0f));
+		}
+	}
+	// There must be a cube for the user to control.
+	if (scene_transforms.get_count() == 0)
+	{
+		scene_transforms.add(glm::vec3(-1.0f, -1.0f, -2.0f), 0.0f, glm::vec3(1.0f, 1.0f, 1.0f));
+	}
+	// Set the active cube. Picking moves the wrapper to another handle.
+	active_cube = new c_cube(scene_transforms, textures, 0);
+	active_cube->set_active_cube(true);
+
+	// Build the trees over the cube bounds, the items are the transform handles.
+	scene_bvh.build(scene_transforms);
+	static_bvh.build(static_transforms);
+
+	// Batch the static cubes by region, the first batches are built on the worker while setup carries on.
+	static_batcher = new c_static_batcher(*active_cube->get_mesh().get_geometry(), textures);
+	for (int handle = 0; handle < static_cast<int>(static_transforms.get_count()); handle++)
+	{
+		static_batcher->add(static_transforms, handle);
+	}
+	static_batcher->update(static_transforms);
+
+	// Collect the shader program, only blocks if the driver is still compiling.
+	shader_program = c_shader_loader::finish_program(shader_handle);
+	sprite_program = c_shader_loader::finish_program(sprite_shader_handle);
+
+	// Every cube shares the cached cube geometry and the same textures, so batch them on the active cube's mesh.
+	cube_renderer = new c_instanced_renderer(active_cube->get_mesh());
+	// Each cube's instance slot matches its transform handle, the store fills in the matrices.
+	cube_texture_layer = texture_layers[active_texture_index];
+	for (size_t i = 0; i < scene_transforms.get_count(); i++)
+	{
+		cube_renderer->add_instance(glm::mat4(1.0f), cube_texture_layer);
+	}
+	scene_transforms.update(*cube_renderer);
 
 	// UI Cube.
 	float window_width = static_cast<float>(camera.get_window_width());
@@ -184,7 +420,7 @@ void initial_setup()
 	ui_cube_position = glm::vec3(window_width - 100.0f, window_height - 100.0f, 0.0f);
 	ui_cube_scale = glm::vec3(150.0f, 150.0f, 1.0f);
 
-	ui_cube = new c_cube(textures, ui_cube_position, 0.0f, ui_cube_scale);
+	ui_cube = new c_cube(ui_transforms, textures, ui_cube_position, 0.0f, ui_cube_scale);
 
 	// Prepare the window.
 	glClearColor(0.56f, 0.57f, 0.60f, 1.0f); // Set the clear color to a light grey.
@@ -205,6 +441,20 @@ void update()
 	// Process input.
 	process_input(window);
 
+	// Rebuild the model matrices of the cubes that moved straight into the instance data.
+	scene_transforms.update(*cube_renderer);
+	// Remesh any terrain chunks that changed.
+	voxel_world->update();
+	// Rebuild the static batches of moved cubes in the background and swap in the finished ones.
+	static_batcher->update(static_transforms);
+	// Stream in the textures that have finished decoding, they show the placeholder until then.
+	texture_manager->update();
+	// Step the sprite animations.
+	for (c_sprite_animation& animation : sprite_animations)
+	{
+		animation.update(delta_time);
+	}
+
 	// Only update the camera if the cursor is hidden.
 	if (!cursor_visible)			   
 	{
@@ -241,17 +491,64 @@ void update()
 
 	// Check for mouse click on the UI cube.
 	if (is_hovering && is_mouse_clicked) {
-		// Change the texture permanently.
-		cubes[0]->get_textures()[0] = cubes[0]->get_textures()[1];
+		// Change the texture permanently, the material is one texture array so only the layer changes.
 		is_texture_changed = true; // Set the flag to indicate texture change.
 		is_mouse_clicked = false; // Reset the click flag.
 	}
 
+	// Check for mouse click on a cube, pick the closest one under the cursor as the active cube.
+	if (!is_hovering && is_mouse_clicked && cursor_visible) {
+		// Unproject the cursor onto the near and far planes to get the ray.
+		const glm::mat4 inverse_view_projection = glm::inverse(camera.get_projection_matrix() * camera.get_view_matrix());
+		const float ndc_x = static_cast<float>(x_pos) / camera.get_window_width() * 2.0f - 1.0f;
+		const float ndc_y = 1.0f - static_cast<float>(y_pos) / camera.get_window_height() * 2.0f;
+		glm::vec4 near_point = inverse_view_projection * glm::vec4(ndc_x, ndc_y, -1.0f, 1.0f);
+		glm::vec4 far_point = inverse_view_projection * glm::vec4(ndc_x, ndc_y, 1.0f, 1.0f);
+		near_point /= near_point.w;
+		far_point /= far_point.w;
+
+		// The ray covers near to far in one direction length. Static cubes can be picked too, moving one rebuilds its batch.
+		const glm::vec3 ray_origin(near_point);
+		const glm::vec3 ray_direction(far_point - near_point);
+		float hit_distance = 1.0f;
+		c_transform_store* hit_transforms = nullptr;
+		int hit_handle = scene_bvh.ray_cast(ray_origin, ray_direction, hit_distance, &hit_distance);
+		if (hit_handle >= 0)
+		{
+			hit_transforms = &scene_transforms;
+		}
+		const int static_hit = static_bvh.ray_cast(ray_origin, ray_direction, hit_distance);
+		if (static_hit >= 0)
+		{
+			hit_transforms = &static_transforms;
+			hit_handle = static_hit;
+		}
+		// Only the picked cube gets a c_cube, the rest stay plain transforms.
+		if (hit_transforms != nullptr && (hit_transforms != &active_cube->get_transforms() || hit_handle != active_cube->get_transform_handle()))
+		{
+			c_cube* picked_cube = new c_cube(*hit_transforms, active_cube->get_textures(), hit_handle);
+			picked_cube->set_active_cube(true);
+			delete active_cube;
+			active_cube = picked_cube;
+		}
+		is_mouse_clicked = false; // Reset the click flag.
+	}
+
 	// Force texture change.
 	if (is_texture_changed) {
 		active_texture_index = 1;
 	}
 
+	// Update the cube texture layers, only when the layer actually changes.
+	if (cube_texture_layer != texture_layers[active_texture_index])
+	{
+		cube_texture_layer = texture_layers[active_texture_index];
+		for (size_t i = 0; i < scene_transforms.get_count(); i++)
+		{
+			cube_renderer->set_instance_texture(static_cast<int>(i), cube_texture_layer);
+		}
+	}
+
 	// Poll for events.
 	glfwPollEvents();
 
@@ -261,7 +558,10 @@ void update()
 	if (elapsed_time >= 0.5) // Update every half second.
 	{
 		double fps = frame_count / elapsed_time;
-		window_title = "Foster's Pipeline - FPS: " + std::to_string(fps);
+		window_title = "Foster's Pipeline - FPS: " + std::to_string(fps)
+			+ " - GL calls: " + std::to_string(c_gl_state::get_issued_count())
+			+ " issued / " + std::to_string(c_gl_state::get_elided_count()) + " elided"
+			+ " - Cubes: " + std::to_string(visible_cubes.size()) + " visible / " + std::to_string(culled_cube_count) + " culled";
 		glfwSetWindowTitle(window, window_title.c_str());
 		frame_count = 0;
 		elapsed_time = 0.0;
@@ -269,56 +569,67 @@ void update()
 }
 void render()
 {
+	// Start counting the state changes for this frame.
+	c_gl_state::begin_frame();
+
 	// Clear the colour buffer and depth buffer.
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	// Send the current time to the shader.
-	glUniform1f(glGetUniformLocation(shader_program, "time"), current_time);
 	// ========== START OF RENDERING PIPELINE ==========
 
+	// Fill the frame constants for both passes and upload them once.
+	glm::mat4 orthographic_projection = glm::ortho(0.0f, static_cast<float>(camera.get_window_width()),
+		0.0f, static_cast<float>(camera.get_window_height()), -1.0f, 1.0f);
+	frame_constants->set_frame(current_time, delta_time, camera.get_window_width(), camera.get_window_height());
+	frame_constants->set_pass(world_pass, camera);
+	frame_constants->set_pass(ui_pass, orthographic_projection, glm::mat4(1.0f)); // UI uses an identity view matrix.
+	frame_constants->upload();
+
 	// Use the shader program.
-	glUseProgram(shader_program);
+	c_gl_state::use_program(shader_program);
 
-	// Pass camera matrices to the shader.
-	c_shader_loader::set_mat_4(shader_program, "projection", camera.get_projection_matrix());
-	c_shader_loader::set_mat_4(shader_program, "view", camera.get_view_matrix());
+	// Use the camera for the 3D scene.
+	frame_constants->bind_pass(world_pass);
 
-	// Set wireframe mode if enabled
-	if (wireframe_mode)
-	{
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-	}
-	else
-	{
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-	}
+	// Set wireframe mode if enabled, only reaches the driver when it is toggled.
+	c_gl_state::set_polygon_mode(wireframe_mode ? GL_LINE : GL_FILL);
 
 	// == DRAW OBJECTS HERE ==;
 
-	// Draw the cubes.
-	for (auto& cube : cubes)
-	{
-		cube->draw(shader_program, active_texture_index);
-	}
+	// Cull the cubes against the camera frustum through the BVH and draw the visible ones in one instanced draw call.
+	// The instances were updated in update().
+	const c_frustum frustum(camera.get_projection_matrix() * camera.get_view_matrix());
+	culled_cube_count = static_cast<int>(scene_transforms.get_count()) - scene_bvh.query_frustum(frustum, visible_cubes);
+	cube_renderer->draw(shader_program, visible_cubes);
+
+	// Draw the static cubes, one draw per visible region.
+	static_batcher->draw(shader_program, texture_layers[active_texture_index], frustum);
+
+	// Draw the terrain, one draw per visible chunk.
+	voxel_world->draw(shader_program, texture_layers[active_texture_index], frustum);
 
 	// Disable depth testing for UI rendering.
-	glDisable(GL_DEPTH_TEST);
+	c_gl_state::set_capability(GL_DEPTH_TEST, false);
 
 	// Draw UI cube with orthographic projection.
-	glm::mat4 orthographic_projection = glm::ortho(0.0f, static_cast<float>(camera.get_window_width()),
-		0.0f, static_cast<float>(camera.get_window_height()), -1.0f, 1.0f);
+	frame_constants->bind_pass(ui_pass);
 
-	c_shader_loader::set_mat_4(shader_program, "projection", orthographic_projection);
-	c_shader_loader::set_mat_4(shader_program, "view", glm::mat4(1.0f));      // Set the view matrix to the identity matrix.
+	ui_cube->draw(shader_program, texture_layers[active_texture_index]);
 
-	ui_cube->draw(shader_program, active_texture_index);
+	// Draw the UI sprites, they share the atlas so it is one draw call.
+	sprite_batcher->begin();
+	if (!sprite_animations.empty())
+	{
+		sprite_batcher->submit(sprite_atlas->get_texture_id(), glm::vec2(ui_cube_position.x - 150.0f, ui_cube_position.y), glm::vec2(64.0f), sprite_animations[0].get_uv_rect());
+		sprite_batcher->submit(sprite_atlas->get_texture_id(), glm::vec2(100.0f, 100.0f), glm::vec2(117.0f, 141.0f), sprite_animations[1].get_uv_rect());
+	}
+	sprite_batcher->end(sprite_program);
 
 	// Re-enable depth testing.
-	glEnable(GL_DEPTH_TEST);
+	c_gl_state::set_capability(GL_DEPTH_TEST, true);
 
 	// ========== END OF RENDERING PIPELINE ==========
-	glBindVertexArray(0); // Unbind the vao.
-	glUseProgram(0); // Stop using the program object. Deactivate the program object.
+	// The program and VAO are left bound, next frame's binds are skipped if nothing changed.
 	glfwSwapBuffers(window); // Swap the front and back buffers. End of the rendering pipeline.
 }
 
@@ -377,35 +688,64 @@ void process_input(void* glfw_window)
 	}
 
 	// Cube movement.
-	for (auto& cube : cubes)
+	if (active_cube != nullptr)
 	{
-		if (cube->get_active_cube())
+		// Move the cube.
+		const glm::vec3 old_position = active_cube->get_position();
+		if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
 		{
-			// Move the cube.
-			if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-			{
-				cube->move(camera, glm::vec3(0.0f, 0.0f, 1.0f));
-			}
-			if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-			{
-				cube->move(camera, glm::vec3(0.0f, 0.0f, -1.0f));
-			}
-			if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-			{
-				cube->move(camera, glm::vec3(-1.0f, 0.0f, 0.0f));
-			}
-			if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-			{
-				cube->move(camera, glm::vec3(1.0f, 0.0f, 0.0f));
-			}
-			if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS)
-			{
-				cube->move(camera, glm::vec3(0.0f, -1.0f, 0.0f));
-			}
-			if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS)
-			{
-				cube->move(camera, glm::vec3(0.0f, 1.0f, 0.0f));
-			}
+			active_cube->move(camera, glm::vec3(0.0f, 0.0f, 1.0f));
+		}
+		if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+		{
+			active_cube->move(camera, glm::vec3(0.0f, 0.0f, -1.0f));
+		}
+		if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+		{
+			active_cube->move(camera, glm::vec3(-1.0f, 0.0f, 0.0f));
+		}
+		if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+		{
+			active_cube->move(camera, glm::vec3(1.0f, 0.0f, 0.0f));
+		}
+		if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS)
+		{
+			active_cube->move(camera, glm::vec3(0.0f, -1.0f, 0.0f));
+		}
+		if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS)
+		{
+			active_cube->move(camera, glm::vec3(0.0f, 1.0f, 0.0f));
+		}
+
+		// Refit the tree from the cube's leaf up if it moved.
+		if (active_cube->get_position() != old_position)
+		{
+			c_bvh& bvh = (&active_cube->get_transforms() == &static_transforms) ? static_bvh : scene_bvh;
+			bvh.refit(active_cube->get_transforms(), active_cube->get_transform_handle());
 		}
 	}
-}
\ No newline at end of file
+}
+
+bool export_scene(const char* file_path)
+{
+	// One group for the moving cubes and one for the static ones, both use the cube material.
+	std::vector<s_scene_export_group> groups(2);
+	groups[0] = { &scene_transforms, {}, 0, 0, 0 };
+	groups[1] = { &static_transforms, {}, 0, 0, c_scene::static_flag };
+	for (s_scene_export_group& group : groups)
+	{
+		for (int handle = 0; handle < static_cast<int>(group.transforms->get_count()); handle++)
+		{
+			group.handles.push_back(handle);
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(file_path).parent_path(), error);
+	if (!c_scene::write(file_path, groups, { "cube" }, texture_paths))
+	{
+		return false;
+	}
+	std::cout << "Exported " << scene_transforms.get_count() + static_transforms.get_count() << " cubes to " << file_path << '\n';
+	return true;
+}
@@ -0,0 +1,15 @@
+#version 460 core
+// Output.
+out vec4 FragColor;
+
+// Input from vertex shader.
+in vec2 TexCoord;
+in vec4 Tint;
+
+// Inputs from application.
+uniform sampler2D sprite_texture; // The atlas the sprite's frame is in.
+
+void main()
+{
+	FragColor = texture(sprite_texture, TexCoord) * Tint;
+}
@@ -0,0 +1,31 @@
+#version 460 core
+
+// Per-sprite data, there is no vertex buffer. (see c_sprite_batcher)
+layout (location = 0) in vec2 aPosition; // Centre of the sprite.
+layout (location = 1) in vec2 aSize;
+layout (location = 2) in vec4 aUVRect;   // Min UV in xy, max UV in zw.
+layout (location = 3) in vec4 aTint;
+
+// Outputs to fragment shader.
+out vec2 TexCoord;
+out vec4 Tint;
+
+// Per-frame constants, uploaded once per frame and shared by every program. (see c_frame_constants)
+layout (std140, binding = 0) uniform frame_constants
+{
+    mat4 projection;
+    mat4 view;
+    mat4 view_projection;
+    vec2 resolution;
+    float time;
+    float delta_time;
+};
+
+void main()
+{
+    // Corner of the quad from the vertex index, drawn as a 4 vertex triangle strip.
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    gl_Position = view_projection * vec4(aPosition + (corner - 0.5) * aSize, 0.0, 1.0);
+    TexCoord = mix(aUVRect.xy, aUVRect.zw, corner);
+    Tint = aTint;
+}
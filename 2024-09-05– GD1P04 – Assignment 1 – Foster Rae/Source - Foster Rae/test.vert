@@ -4,19 +4,34 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoord;
+// Per-instance data.
+layout (location = 3) in mat4 aTransform;    // Model matrix, uses locations 3 - 6.
+layout (location = 7) in int aTextureIndex;  // Layer of the texture array to use.
+// Per-mesh constants that rebuild packed positions, 1 and 0 for full float meshes. (see c_geometry)
+layout (location = 8) in vec3 aPositionScale;
+layout (location = 9) in vec3 aPositionOffset;
 
 // Outputs to fragment shader.
 out vec2 TexCoord;
+flat out int TextureIndex;
 
-// Inputs from application.
-uniform mat4 transform;
-uniform mat4 projection;
-uniform mat4 view;
+// Per-frame constants, uploaded once per frame and shared by every program. (see c_frame_constants)
+layout (std140, binding = 0) uniform frame_constants
+{
+    mat4 projection;
+    mat4 view;
+    mat4 view_projection;
+    vec2 resolution;
+    float time;
+    float delta_time;
+};
 
 void main()
 {
     // Apply the transformations to the vertex position.
-    gl_Position = projection * view * transform * vec4(aPos, 1.0);
-    // Pass the texture coordinates to the fragment shader.
+    vec3 position = aPos * aPositionScale + aPositionOffset;
+    gl_Position = view_projection * aTransform * vec4(position, 1.0);
+    // Pass the texture coordinates and texture index to the fragment shader.
     TexCoord = aTexCoord;
+    TextureIndex = aTextureIndex;
 }
\ No newline at end of file